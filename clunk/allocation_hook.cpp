@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/allocation_hook.h>
+
+#ifdef CLUNK_ALLOCATION_HOOK
+#	include <atomic>
+#	include <new>
+#	include <stdio.h>
+#	include <stdlib.h>
+#endif
+
+using namespace clunk;
+
+#ifdef CLUNK_ALLOCATION_HOOK
+
+namespace {
+	thread_local bool rendering = false;
+	std::atomic<size_t> allocations(0);
+	std::atomic<bool> abort_on_allocation(false);
+}
+
+bool AllocationHook::enabled() { return true; }
+size_t AllocationHook::count() { return allocations.load(); }
+void AllocationHook::reset() { allocations = 0; }
+void AllocationHook::set_abort(bool abort) { abort_on_allocation = abort; }
+
+void AllocationHook::allocation(size_t size) {
+	if (!rendering)
+		return;
+	++allocations;
+	if (abort_on_allocation.load()) {
+		fprintf(stderr, "clunk: heap allocation of %u bytes inside Context::process\n", (unsigned)size);
+		abort();
+	}
+}
+
+AllocationHook::Scope::Scope(): _rendering(rendering) { rendering = true; }
+AllocationHook::Scope::~Scope() { rendering = _rendering; }
+
+void *operator new(size_t size) {
+	AllocationHook::allocation(size);
+	void *ptr = malloc(size > 0? size: 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+#else
+
+bool AllocationHook::enabled() { return false; }
+size_t AllocationHook::count() { return 0; }
+void AllocationHook::reset() {}
+void AllocationHook::set_abort(bool) {}
+void AllocationHook::allocation(size_t) {}
+
+AllocationHook::Scope::Scope(): _rendering(false) {}
+AllocationHook::Scope::~Scope() {}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_ALLOCATION_HOOK_H__
+#define CLUNK_ALLOCATION_HOOK_H__
+
+#include <clunk/export_clunk.h>
+#include <stddef.h>
+
+namespace clunk {
+
+/*!
+	\brief Debug counter of the heap allocations made by the audio threads inside Context::process.
+	Counting works only if the library is built with WITH_ALLOCATION_HOOK option: 
+	it replaces global operator new/delete for the whole process, so do not use it in release builds.
+	Without the option all methods are no-op and count() always returns 0.
+*/
+struct CLUNKAPI AllocationHook {
+	///returns true if library was built with the hook
+	static bool enabled();
+	///returns number of the allocations made by the rendering threads since the last reset
+	static size_t count();
+	///resets counter
+	static void reset();
+	///aborts on the first allocation made by the rendering thread
+	static void set_abort(bool abort);
+
+	///internal: reports allocation made by clunk's own allocators (Buffer)
+	static void allocation(size_t size);
+
+	//!Marks current thread as rendering one while alive
+	struct CLUNKAPI Scope {
+		Scope();
+		~Scope();
+	private:
+		bool _rendering;
+	};
+};
+
+}
+
+#endif
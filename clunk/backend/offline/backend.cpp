@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/backend/offline/backend.h>
+#include <clunk/wav_file.h>
+#include <clunk/clunk_ex.h>
+#include <clunk/logger.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits>
+
+namespace clunk { namespace offline {
+
+Backend::Backend(int sample_rate, const u8 channels, int period_size, AudioSpec::Format format): _period(period_size), _frames(0) {
+	LOG_DEBUG(("initializing offline backend %d %u %d", sample_rate, channels, period_size));
+	if (sample_rate <= 0 || channels == 0 || period_size <= 0)
+		throw_ex(("invalid offline backend configuration: %d %u %d", sample_rate, channels, period_size));
+
+	AudioSpec spec(format, sample_rate, channels);
+	_buffer.resize(_period * spec.channels * spec.bytes_per_sample());
+	_context.init(spec, _period);
+}
+
+Backend::~Backend() {
+	LOG_DEBUG(("shutting down offline backend, rendered %g seconds", get_time()));
+}
+
+Sample* Backend::load(const std::string &file, Sample::Storage storage) {
+	return WavFile::load(_context, file, storage);
+}
+
+const Buffer & Backend::render() {
+	_context.process(_buffer.get_ptr(), _buffer.get_size());
+	_frames += _period;
+	return _buffer;
+}
+
+unsigned Backend::periods(float seconds) const {
+	if (seconds <= 0)
+		return 0;
+	const double n = ceil((double)seconds * _context.get_spec().sample_rate / _period);
+	if (n > std::numeric_limits<unsigned>::max())
+		throw_ex(("%g seconds is too long to render", seconds));
+	return (unsigned)n;
+}
+
+void Backend::render(Buffer &data, float seconds) {
+	unsigned n = periods(seconds);
+	size_t offset = data.get_size();
+	//Buffer::reserve takes int, long renders go through resize
+	const size_t period = _buffer.get_size();
+	if (n > (std::numeric_limits<size_t>::max() - offset) / period)
+		throw_ex(("%g seconds do not fit into the memory", seconds));
+	data.resize(offset + n * period);
+	for(unsigned i = 0; i < n; ++i) {
+		_context.process(static_cast<u8 *>(data.get_ptr()) + offset, period);
+		_frames += _period;
+		offset += period;
+	}
+}
+
+void Backend::render_wav(const std::string &fname, float seconds) {
+	Buffer data;
+	render(data, seconds);
+	WavFile wav(_context.get_spec(), data);
+	wav.save(fname);
+}
+
+void Backend::render_raw(const std::string &fname, float seconds) {
+	FILE *f = fopen(fname.c_str(), "wb");
+	if (f == NULL)
+		throw_io(("fopen(%s)", fname.c_str()));
+
+	unsigned n = periods(seconds);
+	TRY {
+		for(unsigned i = 0; i < n; ++i) {
+			const Buffer &data = render();
+			if (fwrite(data.get_ptr(), data.get_size(), 1, f) != 1)
+				throw_io(("fwrite(%s)", fname.c_str()));
+		}
+	} CATCH("render_raw", {
+		fclose(f);
+		throw;
+	})
+	fclose(f);
+}
+
+}}
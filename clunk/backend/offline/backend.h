@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_BACKEND_OFFLINE_H
+#define CLUNK_BACKEND_OFFLINE_H
+
+#include <clunk/export_clunk.h>
+#include <clunk/buffer.h>
+#include <clunk/sample.h>
+#include <clunk/context.h>
+#include <string>
+
+namespace clunk { namespace offline {
+
+/*!
+	\brief Offline (headless) backend.
+	Drives clunk::Context::process from the caller's thread as fast as CPU allows. It does not need any sound hardware. 
+	Clock is driven by the caller: time advances only when you render next period, 
+	so you could update objects between periods exactly like you do it from your game loop.
+*/
+
+class CLUNKAPI Backend {
+	Context _context;
+public:
+	/*! 
+		\brief Initializes clunk context. 
+		\param[in] sample_rate sample rate of the audio output
+		\param[in] channels audio output channels number, supported values 1 or 2 for now. 
+		\param[in] period_size minimal processing unit (samples). 
+	*/
+	Backend(int sample_rate, const u8 channels, int period_size, AudioSpec::Format format = AudioSpec::S16);
+	~Backend();
+
+	/*!
+		\brief loads sample from wav file
+		\param[in] storage storage of the converted data, see Sample::Storage
+	*/
+	Sample *load(const std::string &fname, Sample::Storage storage = Sample::Int16);
+
+	///gets context
+	Context &get_context() { return _context; }
+
+	///renders exactly one period, returned buffer is valid till the next call
+	const Buffer & render();
+	/*!
+		\brief renders given number of seconds (rounded up to the period size) and appends it to data
+		\param[out] data destination buffer
+		\param[in] seconds length of the rendered audio
+	*/
+	void render(Buffer &data, float seconds);
+	///renders given number of seconds into the wav file
+	void render_wav(const std::string &fname, float seconds);
+	///renders given number of seconds into the raw file (native endianess, interleaved)
+	void render_raw(const std::string &fname, float seconds);
+
+	///returns number of frames rendered so far
+	u64 get_frames() const { return _frames; }
+	///returns time rendered so far (seconds)
+	double get_time() const { return 1.0 * _frames / _context.get_spec().sample_rate; }
+	///returns period size in frames
+	unsigned get_period() const { return _period; }
+
+private:
+	unsigned periods(float seconds) const;
+
+	unsigned	_period;
+	Buffer		_buffer;
+	u64			_frames;
+};
+
+}}
+
+#endif
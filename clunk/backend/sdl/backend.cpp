@@ -57,7 +57,7 @@ Backend::Backend(int sample_rate, const u8 channels, int period_size) {
 		LOG_ERROR(("Could not operate on %d channels", _spec.channels));
 
 	LOG_DEBUG(("opened audio device, sample rate: %d, period: %d, channels: %d", _spec.freq, _spec.samples, _spec.channels));
-	_context.init(convert(_spec));
+	_context.init(convert(_spec), _spec.samples);
 }
 void Backend::start()
 {
@@ -91,7 +91,7 @@ void Backend::callback(void *userdata, u8 *stream, int len) {
 }
 
 
-Sample* Backend::load(const std::string &file) {
+Sample* Backend::load(const std::string &file, Sample::Storage storage) {
 	Uint8 *buf;
 	Uint32 len;
 	SDL_AudioSpec spec;
@@ -101,7 +101,7 @@ Sample* Backend::load(const std::string &file) {
 	clunk::Buffer wav;
 	wav.set_data(buf, len, true);
 	Sample *sample = _context.create_sample();
-	sample->init(wav, convert(spec));
+	sample->init(wav, convert(spec), storage);
 	sample->name = file;
 	return sample;
 }
@@ -52,8 +52,9 @@ public:
 
 	/*!
 		\brief loads sample from file
+		\param[in] storage storage of the converted data, see Sample::Storage
 	*/
-	Sample *load(const std::string &fname);
+	Sample *load(const std::string &fname, Sample::Storage storage = Sample::Int16);
 	void start();
 	void stop();
 
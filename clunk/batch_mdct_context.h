@@ -0,0 +1,180 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef CLUNK_BATCH_MDCT_CONTEXT_H__
+#define CLUNK_BATCH_MDCT_CONTEXT_H__
+
+#include <clunk/mdct_context.h>
+#include <complex>
+#include <math.h>
+
+namespace clunk {
+
+/*!
+	\brief MDCT of LANES independent windows at once.
+	Data is stored as structure of arrays: data[i][lane], every step loops over the lanes innermost, 
+	so the compiler turns each step into the vector operations for all the lanes. 
+	Math is the same as in mdct_context, the fft is iterative radix-2 over the lanes.
+*/
+template<int BITS, int LANES, template <int, typename> class window_func_type, typename T = float>
+class batch_mdct_context {
+public:
+	enum { N = 1 << BITS , M = N / 2, N4 = N / 4 };
+	typedef T value_type;
+	typedef T lanes_type[LANES];
+
+	alignas(32) lanes_type data[N];
+
+	batch_mdct_context() : data(), window_func(), sqrt_N((T)sqrt((T)N)) {
+		for(unsigned t = 0; t < N4; ++t)
+			angle_cache[t] = std::polar<T>(1, 2 * T(M_PI) * (t + T(0.125)) / N);
+		for(unsigned t = 0; t < N4 / 2; ++t)
+			twiddle[t] = std::polar<T>(1, -2 * T(M_PI) * t / N4);
+		for(unsigned i = 0, j = 0; i < N4; ++i) {
+			reversed[i] = j;
+			unsigned m = N4 / 2;
+			while(m >= 1 && (j & m)) {
+				j ^= m;
+				m >>= 1;
+			}
+			j |= m;
+		}
+	}
+
+	void mdct() {
+		for(unsigned t = 0; t < N4; ++t)
+			for(int l = 0; l < LANES; ++l)
+				rotate[t][l] = -data[t + 3 * N4][l];
+		for(unsigned t = N4; t < N; ++t)
+			for(int l = 0; l < LANES; ++l)
+				rotate[t][l] = data[t - N4][l];
+
+		for(unsigned t = 0; t < N4; ++t) {
+			const std::complex<T> & a = angle_cache[t];
+			for(int l = 0; l < LANES; ++l) {
+				T re = (rotate[t * 2][l] - rotate[N - 1 - t * 2][l]) / 2;
+				T im = (rotate[M + t * 2][l] - rotate[M - 1 - t * 2][l]) / -2;
+				fft_re[t][l] = re * a.real() + im * a.imag();
+				fft_im[t][l] = -re * a.imag() + im * a.real();
+			}
+		}
+		fft();
+
+		const T scale = 2 / sqrt_N;
+		for(unsigned t = 0; t < N4; ++t) {
+			const std::complex<T>& a = angle_cache[t];
+			for(int l = 0; l < LANES; ++l) {
+				T re = fft_re[t][l], im = fft_im[t][l];
+				data[2 * t][l] = scale * (re * a.real() + im * a.imag());
+				data[M - 2 * t - 1][l] = -scale * (-re * a.imag() + im * a.real());
+			}
+		}
+	}
+
+	void imdct() {
+		for(unsigned t = 0; t < N4; ++t) {
+			const std::complex<T> & a = angle_cache[t];
+			for(int l = 0; l < LANES; ++l) {
+				T re = data[t * 2][l] / 2, im = data[M - 1 - t * 2][l] / 2;
+				fft_re[t][l] = re * a.real() + im * a.imag();
+				fft_im[t][l] = - re * a.imag() + im * a.real();
+			}
+		}
+
+		fft();
+
+		const T scale = 8 / sqrt_N;
+		for(unsigned t = 0; t < N4; ++t) {
+			const std::complex<T>& a = angle_cache[t];
+			for(int l = 0; l < LANES; ++l) {
+				T re = fft_re[t][l], im = fft_im[t][l];
+				rotate[2 * t][l] = scale * (re * a.real() + im * a.imag());
+				rotate[M + 2 * t][l] = scale * (-re * a.imag() + im * a.real());
+			}
+		}
+		for(unsigned t = 1; t < N; t += 2)
+			for(int l = 0; l < LANES; ++l)
+				rotate[t][l] = - rotate[N - t - 1][l];
+
+		//shift
+		for(unsigned t = 0; t < 3 * N4; ++t)
+			for(int l = 0; l < LANES; ++l)
+				data[t][l] = rotate[t + N4][l];
+		for(unsigned t = 3 * N4; t < N; ++t)
+			for(int l = 0; l < LANES; ++l)
+				data[t][l] = -rotate[t - 3 * N4][l];
+	}
+
+	void apply_window() {
+		for(int i = 0; i < N; ++i) {
+			const T w = window_func.cache[i];
+			for(int l = 0; l < LANES; ++l)
+				data[i][l] *= w;
+		}
+	}
+
+private:
+	void fft() {
+		for(unsigned i = 0; i < N4; ++i) {
+			const unsigned j = reversed[i];
+			if (i < j) {
+				for(int l = 0; l < LANES; ++l) {
+					std::swap(fft_re[i][l], fft_re[j][l]);
+					std::swap(fft_im[i][l], fft_im[j][l]);
+				}
+			}
+		}
+		for(unsigned len = 2; len <= N4; len <<= 1) {
+			const unsigned half = len / 2, step = N4 / len;
+			for(unsigned start = 0; start < N4; start += len) {
+				for(unsigned k = 0; k < half; ++k) {
+					const std::complex<T> &w = twiddle[k * step];
+					T *a_re = fft_re[start + k], *a_im = fft_im[start + k];
+					T *b_re = fft_re[start + k + half], *b_im = fft_im[start + k + half];
+					for(int l = 0; l < LANES; ++l) {
+						T re = b_re[l] * w.real() - b_im[l] * w.imag();
+						T im = b_re[l] * w.imag() + b_im[l] * w.real();
+						b_re[l] = a_re[l] - re;
+						b_im[l] = a_im[l] - im;
+						a_re[l] += re;
+						a_im[l] += im;
+					}
+				}
+			}
+		}
+	}
+
+	const window_func_type<N, T> window_func;
+	std::complex<T> angle_cache[N4];
+	std::complex<T> twiddle[N4 / 2];
+	unsigned reversed[N4];
+	T sqrt_N;
+
+	alignas(32) lanes_type rotate[N];
+	alignas(32) lanes_type fft_re[N4];
+	alignas(32) lanes_type fft_im[N4];
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #include <clunk/buffer.h>
 #include <clunk/clunk_ex.h>
+#include <clunk/allocation_hook.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -60,6 +61,9 @@ void Buffer::resize(size_t s) {
 		return;
 	}
 
+#ifdef CLUNK_ALLOCATION_HOOK
+	AllocationHook::allocation(s);
+#endif
 	void * x = realloc(_ptr, s);
 	if (x == NULL) 
 		throw_io(("realloc (%p, %u)", _ptr, (unsigned)s));
@@ -71,6 +75,9 @@ void Buffer::set_data(const void *p, const size_t s) {
 	if (p == NULL || s == 0)
 		throw_ex(("calling set_data(%p, %u) is invalid", p, (unsigned)s));
 
+#ifdef CLUNK_ALLOCATION_HOOK
+	AllocationHook::allocation(s);
+#endif
 	void *x = realloc(_ptr, s);
 
 	if (x == NULL) 
@@ -28,6 +28,7 @@ SOFTWARE.
 #include <clunk/types.h>
 #include <clunk/export_clunk.h>
 #include <string>
+#include <utility>
 
 namespace clunk {
 
@@ -70,6 +71,8 @@ namespace clunk {
 				Useful for exception-safe passing of malloc'ed memory to some library function which later deallocates it.
 		*/
 		std::pair<void *, size_t> unlink() { auto r = std::make_pair(_ptr, _size); _ptr = nullptr; _size = 0; return r; }
+		//! Exchanges contents with the other buffer, no allocations.
+		void swap(Buffer &other) { std::swap(_ptr, other._ptr); std::swap(_size, other._size); }
 
 		//! Default operator=
 		const Buffer& operator=(const Buffer& c);
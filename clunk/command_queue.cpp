@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/command_queue.h>
+#include <stddef.h>
+
+using namespace clunk;
+
+CommandQueue::CommandQueue(size_t capacity): _mask(0), _head(0), _tail(0) {
+	reset(capacity);
+}
+
+void CommandQueue::reset(size_t capacity) {
+	size_t size = 2;
+	while(size < capacity)
+		size <<= 1;
+
+	std::vector<Cell> cells(size);
+	_cells.swap(cells);
+	for(size_t i = 0; i < size; ++i)
+		_cells[i].sequence.store(i, std::memory_order_relaxed);
+	_mask = size - 1;
+	_head.store(0, std::memory_order_relaxed);
+	_tail = 0;
+}
+
+bool CommandQueue::push(const Command &cmd) {
+	size_t pos = _head.load(std::memory_order_relaxed);
+	Cell *cell;
+	while(true) {
+		cell = &_cells[pos & _mask];
+		size_t seq = cell->sequence.load(std::memory_order_acquire);
+		ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+		if (diff == 0) {
+			if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else
+			pos = _head.load(std::memory_order_relaxed);
+	}
+	cell->command = cmd;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+Command *CommandQueue::front() {
+	Cell &cell = _cells[_tail & _mask];
+	if (cell.sequence.load(std::memory_order_acquire) != _tail + 1)
+		return NULL;
+	return &cell.command;
+}
+
+void CommandQueue::pop() {
+	Cell &cell = _cells[_tail & _mask];
+	cell.command.source = NULL;
+	cell.command.stream = NULL;
+	cell.sequence.store(_tail + _mask + 1, std::memory_order_release);
+	++_tail;
+}
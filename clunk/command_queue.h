@@ -0,0 +1,107 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_COMMAND_QUEUE_H__
+#define CLUNK_COMMAND_QUEUE_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/v3.h>
+#include <atomic>
+#include <vector>
+
+namespace clunk {
+class Object;
+class Source;
+class StreamBuffer;
+
+//!Deferred call of the Object or Context setter, executed by the audio thread.
+struct CLUNKAPI Command {
+	enum Type {
+		Update, SetPosition, SetVelocity,
+		PlayNamed, PlayIndexed,
+		CancelNamed, CancelIndexed, CancelAll,
+		FadeOutNamed, FadeOutIndexed,
+		SetLoopNamed, SetLoopIndexed,
+		Autodelete,
+		PlayStream, PauseStream, StopStream, SetStreamVolume
+	};
+
+	Type type;
+	///target object, NULL for the context commands
+	Object *object;
+	Source *source;
+	StreamBuffer *stream;
+	v3f position, velocity;
+	///source index, interned source name (Context::source_name) or stream id
+	int index;
+	///fadeout or volume
+	float value;
+	///loop or force flag
+	bool flag;
+
+	Command(Type type = Update, Object *object = NULL): 
+		type(type), object(object), source(NULL), stream(NULL), index(0), value(0), flag(false) {}
+};
+
+/*!
+	\brief Bounded lock-free multiple producers / single consumer queue of commands.
+	Any thread could push commands, audio thread pops them at the beginning of the period.
+	Slots are preallocated and reused, so consumer never allocates or frees memory.
+*/
+
+class CLUNKAPI CommandQueue {
+public:
+	///creates queue with given capacity, rounded up to the power of two
+	CommandQueue(size_t capacity = 4096);
+
+	///reallocates queue. Not thread safe: queue must be empty and not used by other threads.
+	void reset(size_t capacity);
+	size_t capacity() const { return _cells.size(); }
+
+	///pushes command, returns false if queue is full
+	bool push(const Command &cmd);
+
+	///consumer: returns oldest command or NULL if queue is empty
+	Command *front();
+	///consumer: releases command returned by front()
+	void pop();
+
+private:
+	CommandQueue(const CommandQueue &);
+	const CommandQueue& operator=(const CommandQueue &);
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		Command command;
+		Cell(): sequence(0) {}
+	};
+	std::vector<Cell> _cells;
+	size_t _mask;
+	std::atomic<size_t> _head;
+	size_t _tail;
+};
+
+}
+
+#endif
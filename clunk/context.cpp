@@ -31,7 +31,8 @@ SOFTWARE.
 #include <clunk/object.h>
 #include <clunk/clunk_ex.h>
 #include <clunk/mixer.h>
-#include <clunk/resample.h>
+#include <clunk/resampler.h>
+#include <clunk/allocation_hook.h>
 #include <string.h>
 #include <assert.h>
 #include <map>
@@ -41,13 +42,16 @@ SOFTWARE.
 
 using namespace clunk;
 
-Context::Context() : _listener(NULL), max_sources(8), fx_volume(1), distance_model(DistanceModel::Exponent, false), _fdump(NULL) {
+Context::Context() : command_mode(Queued), _clock(0), _sweep(0), streams(NULL), stream_depth(0.25f), stream_low(0.05f), stream_high(0.2f), resample_quality(Resampler::Medium), decoder(NULL), _listener(NULL), max_sources(8), fx_volume(1), master_volume(1), 
+	voice_fade(0.02f), voice_hysteresis(0.5f), voice_gain_bound(1), voice_priority_bound(1), 
+	distance_model(DistanceModel::Exponent, false), hrtf_precision(HrtfBank::Float16), hrtf_engine(Hrtf::MdctFilter), hrtf_partition(128), hrtf_batch(4), hrtf_window(Hrtf::WINDOW_SIZE), _fdump(NULL), _period(0), _profile(NULL), partitions(1), partition_n(0) {
 }
 
 template<class Sources>
-bool Context::process_object(Object *o, Sources &sset, std::vector<source_t> &lsources, unsigned n) {
-	typedef typename std::map<typename Sources::key_type, unsigned> stats_type;
-	stats_type sources_stats;
+bool Context::process_object(Object *o, Sources &sset, unsigned n) {
+	//sources are sorted by name id, so same sounds are counted as runs of equal keys
+	const typename Sources::key_type *last_name = NULL;
+	unsigned same_sounds_n = 0;
 	
 	for(typename Sources::iterator j = sset.begin(); j != sset.end(); ) {
 		const typename Sources::key_type &name = j->first;
@@ -59,16 +63,28 @@ bool Context::process_object(Object *o, Sources &sset, std::vector<source_t> &ls
 			continue;
 		}
 		
-		typename stats_type::iterator s_i = sources_stats.find(name);
-		unsigned same_sounds_n = (s_i != sources_stats.end())? s_i->second: 0;
-		if (lsources.size() < max_sources && same_sounds_n < distance_model.same_sounds_limit) {
-			lsources.push_back(source_t(s, _listener->transform(o->_position + s->delta_position), o->_velocity, _listener->_velocity));
-			if (same_sounds_n == 0) {
-				sources_stats.insert(typename stats_type::value_type(name, 1));
-			} else {
-				++s_i->second;
-			}
-			//LOG_DEBUG(("%u: source: %s", (unsigned)lsources.size(), name.c_str()));
+		add_source(s);
+		const float weight = s->gain * s->sample->gain;
+
+		v3f s_pos = _listener->transform(o->_position + s->delta_position);
+		const float audibility = fx_volume * distance_model.gain(s_pos.length()) * weight;
+
+		if (last_name == NULL || *last_name != name)
+			same_sounds_n = 0;
+		last_name = &name;
+
+		if (audibility >= MinMixVolume && same_sounds_n < distance_model.same_sounds_limit) {
+			float score = audibility * s->priority;
+			if (s->_voiced())
+				score *= 1 + voice_hysteresis;
+			voices.push_back(source_t(s, s_pos, o->_velocity, _listener->_velocity, o, score, (unsigned)voices.size()));
+			if (score > 0)
+				add_voice_score(score);
+			++same_sounds_n;
+			//LOG_DEBUG(("%u: source: %s", (unsigned)voices.size(), name.c_str()));
+		} else if (s->_voiced()) {
+			//lost its place: still rendered until faded out
+			voices.push_back(source_t(s, s_pos, o->_velocity, _listener->_velocity, o, 0, (unsigned)voices.size()));
 		} else {
 			s->_update_position(n);
 		}
@@ -81,110 +97,277 @@ bool Context::process_object(Object *o, Sources &sset, std::vector<source_t> &ls
 	return true;
 }
 
-void Context::process(void *stream, size_t size) {
-	//TIMESPY(("total"));
+void Context::add_voice_score(float score) {
+	//min-heap of the max_sources best scores
+	if (voice_scores.size() < max_sources) {
+		voice_scores.push_back(score);
+		std::push_heap(voice_scores.begin(), voice_scores.end(), std::greater<float>());
+	} else if (!voice_scores.empty() && score > voice_scores.front()) {
+		std::pop_heap(voice_scores.begin(), voice_scores.end(), std::greater<float>());
+		voice_scores.back() = score;
+		std::push_heap(voice_scores.begin(), voice_scores.end(), std::greater<float>());
+	}
+}
 
-	{
-		//TIMESPY(("sorting objects"));
-		std::sort(objects.begin(), objects.end(), Object::DistanceOrder(_listener->_position));
+void Context::add_source(const Source *s) {
+	const float weight = s->gain * s->sample->gain;
+	if (weight > voice_gain_bound)
+		voice_gain_bound = weight;
+	if (s->priority > voice_priority_bound)
+		voice_priority_bound = s->priority;
+}
+
+void Context::visit_object(Object *o, unsigned n) {
+	o->sync();
+	bool ok_1 = process_object<Object::NamedSources>(o, o->named_sources, n),
+		ok_2 = process_object<Object::IndexedSources>(o, o->indexed_sources, n);
+	o->_clock = _clock + n;
+	if (!ok_1 && !ok_2) {
+		objects.erase(std::find(objects.begin(), objects.end(), o));
+		destroy_object(o);
 	}
-	//LOG_DEBUG(("sorted %u objects", (unsigned)objects.size()));
-	
-	std::vector<source_t> lsources;
-	size_t n = size / 2 / _spec.channels;
-
-	for(objects_type::iterator i = objects.begin(); i != objects.end(); ) {
-		Object *o = *i;
-		//bool _process_object(Object *o, Sources &sset, std::vector<source_t> &lsources, unsigned max_sources, const DistanceModel &distance_model, Object *listener, unsigned n) {
-		bool ok_1 = process_object<Object::NamedSources>(o, o->named_sources, lsources, n),
-			ok_2 = process_object<Object::IndexedSources>(o, o->indexed_sources, lsources, n);
-		if (ok_1 || ok_2) 
-			++i;
-		else {
-			delete o;
-			i = objects.erase(i);
+}
+
+void Context::destroy_object(Object *o) {
+	_index.remove(o);
+	voiced_objects.erase(std::remove(voiced_objects.begin(), voiced_objects.end(), o), voiced_objects.end());
+	delete o;
+}
+
+void Context::sweep_objects() {
+	//objects far from the listener are never visited by the mixer, collect dead ones a few per period
+	static const size_t sweep_objects_n = 32;
+	for(size_t k = 0; k < sweep_objects_n && !objects.empty(); ++k) {
+		if (_sweep >= objects.size())
+			_sweep = 0;
+		Object *o = objects[_sweep];
+		o->sync();
+		if (o->dead && o->named_sources.empty() && o->indexed_sources.empty()) {
+			objects.erase(objects.begin() + _sweep);
+			destroy_object(o);
+		} else 
+			++_sweep;
+	}
+}
+
+namespace {
+	struct ScoreOrder {
+		template<typename T>
+		inline bool operator()(const T &a, const T &b) const {
+			return a.score != b.score? a.score > b.score: a.order < b.order;
+		}
+	};
+}
+
+void Context::select_voices(unsigned n) {
+	voices.clear();
+	voice_scores.clear();
+	{
+		//walk objects nearest first until even the loudest possible source could not be heard or could not beat selected ones.
+		//delta positions of the sources are not taken into account here.
+		SpatialIndex::Query query(_index, _listener->_position, query_storage);
+		Object *o;
+		while((o = query.next()) != NULL) {
+			if (o->named_sources.empty() && o->indexed_sources.empty())
+				continue;
+
+			const float bound = fx_volume * distance_model.gain((o->_position - _listener->_position).length()) * voice_gain_bound;
+			if (bound < MinMixVolume)
+				break;
+			if (voice_scores.size() >= max_sources && bound * voice_priority_bound * (1 + voice_hysteresis) < voice_scores.front())
+				break;
+
+			visit_object(o, n);
 		}
 	}
 
-	memset(stream, 0, size);
+	//voices from the previous period left behind by the walk still need their fade out
+	previous_voiced_objects.swap(voiced_objects);
+	voiced_objects.clear();
+	for(size_t i = 0; i < previous_voiced_objects.size(); ++i) {
+		Object *o = previous_voiced_objects[i];
+		if (o->_clock != _clock + n)
+			visit_object(o, n);
+	}
+	previous_voiced_objects.clear();
 
-	for(streams_type::iterator i = streams.begin(); i != streams.end();) {
-		//LOG_DEBUG(("processing stream %d", i->first));
-		stream_info &stream_info = i->second;
-		while (stream_info.buffer.get_size() < size) {
-			clunk::Buffer data;
-			bool eos = !stream_info.stream->read(data, size);
-			if (!data.empty() && stream_info.stream->_spec.sample_rate != _spec.sample_rate) {
-				Resample::resample(_spec, data, stream_info.stream->_spec, data);
-			}
-			stream_info.buffer.append(data);
-			//LOG_DEBUG(("read %u bytes", (unsigned)data.get_size()));
-			if (eos) {
-				if (stream_info.loop) {
-					stream_info.stream->rewind();
-				} else {
-					break;
-				}
-			}
+	std::sort(voices.begin(), voices.end(), ScoreOrder());
+
+	const float step = voice_fade > 0? 1.0f / (voice_fade * _spec.sample_rate): 1.0f;
+	lsources.clear();
+	for(size_t i = 0; i < voices.size(); ++i) {
+		const source_t &voice = voices[i];
+		Source *s = voice.source;
+		s->_set_voice(i < max_sources && voice.score > 0, step);
+		if (!s->_voiced()) {
+			s->_update_position(n);
+			continue;
 		}
-		size_t buf_size = stream_info.buffer.get_size();
-		//LOG_DEBUG(("buffered %d bytes", buf_size));
-		if (buf_size == 0) {
-			//all data buffered. continue;
-			LOG_DEBUG(("stream %d finished. dropping.", i->first));
-			TRY {
-				delete stream_info.stream;
-			} CATCH("mixing stream", {});
-			streams.erase(i++);
+		lsources.push_back(voice);
+		if (std::find(voiced_objects.begin(), voiced_objects.end(), voice.object) == voiced_objects.end())
+			voiced_objects.push_back(voice.object);
+	}
+}
+
+void Context::release_stream(StreamBuffer *buffer) {
+	if (buffer->decoder != NULL) {
+		buffer->decoder->retire(buffer);
+	} else {
+		TRY {
+			delete buffer;
+		} CATCH("deleting stream", {});
+	}
+}
+
+StreamBuffer **Context::find_stream(const int id) {
+	StreamBuffer **link = &streams;
+	while(*link != NULL && (*link)->id < id)
+		link = &(*link)->next_stream;
+	return link;
+}
+
+void Context::profile_stage(ProfileRecord::Stage stage, Profiler::clock_type::time_point &start) {
+	if (_profile == NULL)
+		return;
+	Profiler::clock_type::time_point now = Profiler::clock_type::now();
+	_profile->stage[stage] = std::chrono::duration<float>(now - start).count();
+	start = now;
+}
+
+void Context::process(void *stream, size_t size) {
+	AllocationHook::Scope allocation_scope;
+
+	const unsigned frame_size = _spec.bytes_per_sample() * _spec.channels;
+	size_t n = size / frame_size;
+
+	_profile = profiler.begin(_clock, (unsigned)n, _spec.sample_rate);
+	Profiler::clock_type::time_point started, stage_started;
+	if (_profile != NULL)
+		started = stage_started = Profiler::clock_type::now();
+
+	flush();
+	sweep_objects();
+	select_voices(n);
+	profile_stage(ProfileRecord::Selection, stage_started);
+
+	bus_data.resize(n * _spec.channels);
+	std::fill(bus_data.begin(), bus_data.end(), 0.0f);
+	bus.resize(_spec.channels);
+	for(unsigned c = 0; c < _spec.channels; ++c)
+		bus[c] = bus_data.data() + c * n;
+
+	stream_bus.resize(_spec.channels);
+	for(StreamBuffer **link = &streams; *link != NULL;) {
+		StreamBuffer *buffer = *link;
+		//LOG_DEBUG(("processing stream %d", buffer->id));
+		if (buffer->paused) {
+			link = &buffer->next_stream;
 			continue;
 		}
-		
-		if (buf_size >= size)
-			buf_size = size;
 
-		int sdl_v = (int)floor(MaxMixVolume * stream_info.gain + 0.5f);
-		Mixer::mix(_spec.format, stream, stream_info.buffer.get_ptr(), buf_size, sdl_v);
-		
-		if (stream_info.buffer.get_size() > size) {
-			memmove(stream_info.buffer.get_ptr(), static_cast<u8 *>(stream_info.buffer.get_ptr()) + size, stream_info.buffer.get_size() - size);
-			stream_info.buffer.resize(stream_info.buffer.get_size() - size);
-		} else {
-			stream_info.buffer.free();
+		if (buffer->decoder == NULL)
+			buffer->fill(size);
+		const bool done = buffer->done();
+		if (done && buffer->ring.empty()) {
+			//all data played. continue;
+			LOG_DEBUG(("stream %d finished. dropping.", buffer->id));
+			*link = buffer->next_stream;
+			release_stream(buffer);
+			continue;
 		}
+		if (!done && buffer->ring.size() < size)
+			buffer->underruns->fetch_add(1, std::memory_order_relaxed);
+
+		//mixing straight from the ring segments
+		const void *segment[2];
+		size_t segment_size[2];
+		buffer->ring.peek(size, segment[0], segment_size[0], segment[1], segment_size[1]);
+		size_t offset = 0;
+		for(int s = 0; s < 2; ++s) {
+			const size_t frames = segment_size[s] / frame_size;
+			if (frames == 0)
+				continue;
+			for(unsigned c = 0; c < _spec.channels; ++c)
+				stream_bus[c] = bus[c] + offset;
+			Mixer::mix(_spec.format, stream_bus.data(), _spec.channels, segment[s], frames, buffer->gain);
+			offset += frames;
+		}
+		buffer->ring.consume(segment_size[0] + segment_size[1]);
+		if (buffer->decoder != NULL && buffer->starving(size))
+			buffer->decoder->wake();
 		
-		++i;
+		link = &buffer->next_stream;
 	}
+	profile_stage(ProfileRecord::Streams, stage_started);
 	
-	clunk::Buffer buf;
-	buf.resize(size);
-	
-	//TIMESPY(("mixing sources"));
 	//LOG_DEBUG(("mixing %u sources", (unsigned)lsources.size()));
+	size_t audible = 0;
 	for(unsigned i = 0; i < lsources.size(); ++i ) {
-		const source_t& source_info = lsources[i];
-		Source * source = source_info.source;
+		source_t source_info = lsources[i];
 				
-		float dpitch = 1.0f;
+		source_info.pitch = 1.0f;
 		if (distance_model.doppler_factor > 0) {
-			dpitch = distance_model.doppler_pitch(-source_info.s_pos, source_info.s_vel, source_info.l_vel);
+			source_info.pitch = distance_model.doppler_pitch(-source_info.s_pos, source_info.s_vel, source_info.l_vel);
 		}
 
-		float volume = fx_volume * distance_model.gain(source_info.s_pos.length());
-		int sdl_v = (int)floor(MaxMixVolume * volume + 0.5f);
-		if (sdl_v <= 0)
-			continue;
-		//check for 0
-		volume = source->_process(buf, _spec.channels, source_info.s_pos, volume, dpitch);
-		assert(buf.get_size() == size);
-		sdl_v = (int)floor(MaxMixVolume * volume + 0.5f);
-		//LOG_DEBUG(("%u: %s: mixing source with volume %g (%d)", i, source->sample->name.c_str(), volume, sdl_v));
-		if (sdl_v <= 0)
+		const float distance = source_info.s_pos.length();
+		source_info.volume = fx_volume * distance_model.gain(distance);
+		if (source_info.volume < MinMixVolume) {
+			source_info.source->_update_position(n);
 			continue;
-		if (sdl_v > MaxMixVolume)
-			sdl_v = MaxMixVolume;
-		
-		Mixer::mix(_spec.format, stream, buf.get_ptr(), size, sdl_v);
+		}
+		source_info.tier = distance_model.tier(distance);
+
+		lsources[audible++] = source_info;
+	}
+	lsources.erase(lsources.begin() + audible, lsources.end());
+
+	partitions = std::min<unsigned>(workers.size(), (unsigned)lsources.size());
+	partition_n = n;
+	if (partitions > 1) {
+		partition_data.resize((partitions - 1) * _spec.channels * n);
+		partition_bus.resize(partitions * _spec.channels);
+		std::copy(bus.begin(), bus.end(), partition_bus.begin());
+		for(size_t c = _spec.channels; c < partition_bus.size(); ++c)
+			partition_bus[c] = partition_data.data() + (c - _spec.channels) * n;
+		workers.run(&Context::render_partition, this, partitions);
+	} else if (partitions == 1) {
+		partition_bus = bus;
+		render_partition(this, 0);
+	}
+	profile_stage(ProfileRecord::Sources, stage_started);
+
+	if (partitions > 1) {
+		const float *src = partition_data.data();
+		for(unsigned p = 1; p < partitions; ++p) {
+			for(unsigned c = 0; c < _spec.channels; ++c, src += n) {
+				float *dst = bus[c];
+				for(size_t i = 0; i < n; ++i)
+					dst[i] += src[i];
+			}
+		}
 	}
+
+	limiter.process(bus.data(), _spec.channels, n, _spec.sample_rate, master_volume);
+	Mixer::convert(_spec.format, stream, bus.data(), _spec.channels, n);
+	profile_stage(ProfileRecord::Mixing, stage_started);
+
+	if (_profile != NULL) {
+		profile_stage(ProfileRecord::Total, started);
+		const size_t sources = std::min<size_t>(lsources.size(), ProfileRecord::MaxSources);
+		for(size_t i = 0; i < sources; ++i) {
+			const source_t &source_info = lsources[i];
+			ProfileRecord::SourceCost &cost = _profile->source[i];
+			strncpy(cost.sample, source_info.source->sample->name.c_str(), ProfileRecord::NameLength);
+			cost.object = source_info.object;
+			cost.time = source_info.cost;
+		}
+		_profile->sources = (unsigned)sources;
+		profiler.end();
+		_profile = NULL;
+	}
+
+	_clock += n;
 	
 	if (_fdump != NULL) {
 		if (fwrite(stream, size, 1, _fdump) != 1) {
@@ -195,10 +378,87 @@ void Context::process(void *stream, size_t size) {
 }
 
 
+void Context::render_partition(void *context, unsigned partition) {
+	AllocationHook::Scope allocation_scope;
+	Context *self = static_cast<Context *>(context);
+	const unsigned channels = self->_spec.channels, n = self->partition_n;
+	Buffer *scratch = self->partition_scratch.data() + partition * Hrtf::MaxBatch;
+
+	float * const * partition_bus = self->partition_bus.data() + partition * channels;
+	if (partition > 0) {
+		float *data = partition_bus[0];
+		std::fill(data, data + channels * n, 0.0f);
+	}
+
+	//sources are mixed in batches sharing the transforms
+	const unsigned lanes = std::max(1u, std::min<unsigned>(self->hrtf_batch, Hrtf::MaxBatch));
+	Source *batch[Hrtf::MaxBatch];
+	Hrtf *hrtf[Hrtf::MaxBatch];
+	const Buffer *src[Hrtf::MaxBatch];
+	unsigned sample_rate[Hrtf::MaxBatch], used[Hrtf::MaxBatch];
+	v3f position[Hrtf::MaxBatch];
+	float volume[Hrtf::MaxBatch], volume_end[Hrtf::MaxBatch], pitch[Hrtf::MaxBatch], cost[Hrtf::MaxBatch];
+	size_t index[Hrtf::MaxBatch];
+	const bool profile = self->_profile != NULL;
+
+	//interleaved assignment keeps the nearest (the most expensive) sources spread across the partitions
+	for(size_t i = partition; i < self->lsources.size(); ) {
+		unsigned count = 0;
+		for(; i < self->lsources.size() && count < lanes; i += self->partitions) {
+			source_t& source_info = self->lsources[i];
+			//LOG_DEBUG(("%u: %s: mixing source with volume %g", i, source_info.source->sample->name.c_str(), source_info.volume));
+			Profiler::clock_type::time_point start;
+			if (profile)
+				start = Profiler::clock_type::now();
+			Source *source = source_info.source;
+			Hrtf &source_hrtf = source->_get_hrtf();
+			source_hrtf.set_tier(self->hrtf_bank.empty()? std::max(source_info.tier, DistanceModel::ItdIld): source_info.tier);
+			source_hrtf.set_window(source->get_hrtf_window() != 0? source->get_hrtf_window(): self->hrtf_window);
+			pitch[count] = source_info.pitch;
+			const bool prepared = source->_prepare(channels, n, source_info.volume, pitch[count], scratch[count], volume[count], volume_end[count]);
+			if (profile)
+				source_info.cost = Profiler::elapsed(start);
+			if (!prepared)
+				continue;
+			batch[count] = source;
+			hrtf[count] = &source_hrtf;
+			src[count] = &scratch[count];
+			sample_rate[count] = source->sample->get_spec().sample_rate;
+			position[count] = source_info.s_pos;
+			index[count] = i;
+			++count;
+		}
+
+		//shared transforms are charged to the sources by their windows, the rest is timed per source
+		Hrtf::process(lanes, hrtf, self->hrtf_bank, sample_rate, partition_bus, channels, n, src, channels, position, volume, volume_end, used, count, profile? cost: NULL);
+		for(unsigned l = 0; l < count; ++l) {
+			Profiler::clock_type::time_point start;
+			if (profile)
+				start = Profiler::clock_type::now();
+			batch[l]->_advance(used[l], pitch[l]);
+			if (profile)
+				self->lsources[index[l]].cost += cost[l] + Profiler::elapsed(start);
+		}
+	}
+}
+
+int Context::source_name(const std::string &name, bool add) {
+	std::lock_guard<std::mutex> lock(source_names_lock);
+	source_names_type::const_iterator i = source_names.find(name);
+	if (i != source_names.end())
+		return i->second;
+	if (!add)
+		return -1;
+	const int id = (int)source_names.size();
+	source_names.insert(source_names_type::value_type(name, id));
+	return id;
+}
+
 Object *Context::create_object() {
 	AudioLocker l;
 	Object *o = new Object(this);
 	objects.push_back(o);
+	_index.insert(o);
 	return o;
 }
 
@@ -219,15 +479,50 @@ void Context::save(const std::string &file) {
 	_fdump = fopen(file.c_str(), "wb");
 }
 
-void Context::init(const AudioSpec &spec) {
+void Context::init(const AudioSpec &spec, unsigned period) {
 	AudioLocker l;
 	_spec = spec;
+	_period = period;
+	if (!hrtf_dataset && HrtfDataset::has_builtin())
+		hrtf_dataset = HrtfDataset::builtin();
+	//without any dataset 3d sources are panned with idt until set_hrtf_dataset() is called
+	if (hrtf_dataset) {
+		hrtf_bank.init(hrtf_dataset, spec.sample_rate, Hrtf::MaxWindow / 2, hrtf_precision);
+		hrtf_bank.init_convolution(spec.sample_rate, hrtf_engine == Hrtf::Convolution? hrtf_partition: 0);
+	}
 	_listener = new ListenerObject(this);
 	objects.push_back(_listener);
+	_index.insert(_listener);
+	reserve();
+}
+
+void Context::reserve() {
+	const unsigned threads = workers.size(), channels = _spec.channels;
+	voices.reserve(max_sources * 4);
+	lsources.reserve(max_sources * 4);
+	voice_scores.reserve(max_sources);
+	voiced_objects.reserve(max_sources * 2);
+	previous_voiced_objects.reserve(max_sources * 2);
+	query_storage.reserve(256);
+	partition_bus.reserve(threads * channels);
+	stream_bus.resize(channels);
+	if (partition_scratch.size() < threads * Hrtf::MaxBatch)
+		partition_scratch.resize(threads * Hrtf::MaxBatch);
+
+	if (_period == 0)
+		return;
+
+	bus_data.resize(_period * channels);
+	bus.resize(channels);
+	partition_data.reserve((threads - 1) * channels * _period);
+	for(unsigned i = 0; i < threads * Hrtf::MaxBatch; ++i)
+		partition_scratch[i].resize((_period + Hrtf::MaxWindow) * channels * sizeof(float));
 }
 
 void Context::delete_object(Object *o) {
 	AudioLocker l;
+	_index.remove(o);
+	voiced_objects.erase(std::remove(voiced_objects.begin(), voiced_objects.end(), o), voiced_objects.end());
 	objects_type::iterator i = std::find(objects.begin(), objects.end(), o);
 	while(i != objects.end() && *i == o)
 		i = objects.erase(i); //just for fun
@@ -235,6 +530,16 @@ void Context::delete_object(Object *o) {
 
 void Context::deinit() {
 	AudioLocker l;
+	workers.stop();
+	if (decoder != NULL) {
+		decoder->stop();
+		for(StreamBuffer *buffer = streams; buffer != NULL; buffer = buffer->next_stream) {
+			decoder->remove(buffer);
+			buffer->decoder = NULL;
+		}
+		delete decoder;
+		decoder = NULL;
+	}
 	delete _listener;
 	_listener = NULL;
 	
@@ -249,46 +554,233 @@ Context::~Context() {
 }
 
 
+void Context::submit(const Command &cmd) {
+	if (command_mode == Queued && commands.push(cmd))
+		return;
+
+	//locking mode or full queue: apply in place after the queued commands to keep the order
+	AudioLocker l;
+	flush();
+	execute(cmd);
+}
+
+void Context::flush() {
+	for(Command *cmd; (cmd = commands.front()) != NULL; commands.pop()) {
+		TRY {
+			execute(*cmd);
+		} CATCH("executing command", {});
+	}
+}
+
+void Context::execute(const Command &cmd) {
+	if (cmd.object != NULL) {
+		cmd.object->execute(cmd);
+		return;
+	}
+
+	switch(cmd.type) {
+	case Command::PlayStream: {
+			//buffer carries its own list link and underrun counter, nothing is allocated here
+			StreamBuffer **link = find_stream(cmd.index);
+			StreamBuffer *buffer = cmd.stream;
+			if (*link != NULL && (*link)->id == cmd.index) {
+				StreamBuffer *old = *link;
+				buffer->next_stream = old->next_stream;
+				release_stream(old);
+			} else 
+				buffer->next_stream = *link;
+			*link = buffer;
+			buffer->decoder = decoder;
+			if (decoder != NULL)
+				decoder->add(buffer);
+		}
+		break;
+
+	case Command::PauseStream: {
+			StreamBuffer *buffer = *find_stream(cmd.index);
+			if (buffer != NULL && buffer->id == cmd.index)
+				buffer->paused = !buffer->paused;
+		}
+		break;
+
+	case Command::StopStream: {
+			StreamBuffer **link = find_stream(cmd.index);
+			StreamBuffer *buffer = *link;
+			if (buffer == NULL || buffer->id != cmd.index)
+				break;
+			
+			*link = buffer->next_stream;
+			release_stream(buffer);
+		}
+		break;
+
+	case Command::SetStreamVolume: {
+			StreamBuffer *buffer = *find_stream(cmd.index);
+			if (buffer != NULL && buffer->id == cmd.index)
+				buffer->gain = cmd.value;
+		}
+		break;
+
+	default: 
+		throw_ex(("invalid context command %d", (int)cmd.type));
+	}
+}
+
 //MUSIC MIXER: 
 
 void Context::play(const int id, Stream *stream, bool loop) {
 	LOG_DEBUG(("play(%d, %p, %s)", id, (const void *)stream, loop?"'loop'":"'once'"));
-	AudioLocker l;
-	stream_info & stream_info = streams[id];
-	delete stream_info.stream;
-	stream_info.stream = stream;
-	stream_info.loop = loop;
-	stream_info.paused = false;
-	stream_info.gain = 1.0f;
+	const unsigned frame_size = _spec.bytes_per_sample() * _spec.channels;
+	const size_t depth = std::max<size_t>((size_t)(stream_depth * _spec.sample_rate), 2 * _period) * frame_size;
+	const size_t low = std::max<size_t>((size_t)(stream_low * _spec.sample_rate), _period) * frame_size;
+	const size_t high = (size_t)(stream_high * _spec.sample_rate) * frame_size;
+	StreamBuffer *buffer = new StreamBuffer(_spec, stream, loop, depth, low, high, resample_quality);
+	buffer->id = id;
+	{
+		std::lock_guard<std::mutex> lock(underruns_lock);
+		buffer->underruns = &underruns[id];
+	}
+	//first chunk is decoded by the calling thread
+	TRY {
+		buffer->fill(_period * frame_size);
+	} CATCH(clunk::format_string("play(%d)", id).c_str(), {
+		delete buffer;
+		throw;
+	});
+
+	Command cmd(Command::PlayStream);
+	cmd.index = id;
+	cmd.stream = buffer;
+	submit(cmd);
 }
 
 bool Context::playing(const int id) const {
 	AudioLocker l;
-	return streams.find(id) != streams.end();
+	const_cast<Context *>(this)->flush();
+	const StreamBuffer *buffer = *const_cast<Context *>(this)->find_stream(id);
+	return buffer != NULL && buffer->id == id;
 }
 
 void Context::pause(const int id) {
-	AudioLocker l;
-	streams_type::iterator i = streams.find(id);
-	if (i == streams.end())
-		return;
-	
-	i->second.paused = !i->second.paused;
+	Command cmd(Command::PauseStream);
+	cmd.index = id;
+	submit(cmd);
 }
 
 void Context::stop(const int id) {
+	Command cmd(Command::StopStream);
+	cmd.index = id;
+	submit(cmd);
+}
+
+void Context::set_hrtf_engine(Hrtf::Engine engine, unsigned partition) {
+	AudioLocker l;
+	if (engine == Hrtf::Convolution && partition != 64 && partition != 128 && partition != 256)
+		throw_ex(("invalid partition size %u, use 64, 128 or 256", partition));
+	hrtf_engine = engine;
+	hrtf_partition = partition;
+	if (!hrtf_bank.empty())
+		hrtf_bank.init_convolution(_spec.sample_rate, engine == Hrtf::Convolution? partition: 0);
+}
+
+void Context::set_hrtf_dataset(const std::string &fname) {
+	set_hrtf_dataset(fname.empty()? std::shared_ptr<const HrtfDataset>(): HrtfDataset::load(fname));
+}
+
+void Context::set_hrtf_dataset(const std::shared_ptr<const HrtfDataset> &dataset) {
+	const std::shared_ptr<const HrtfDataset> data = dataset? dataset: HrtfDataset::builtin();
+	//responses are prepared outside of the lock, audio thread keeps using the old ones meanwhile. Both are changed by the calling thread only.
+	HrtfBank bank;
+	if (_spec.sample_rate != 0) {
+		bank.init(data, _spec.sample_rate, Hrtf::MaxWindow / 2, hrtf_precision);
+		bank.init_convolution(_spec.sample_rate, hrtf_engine == Hrtf::Convolution? hrtf_partition: 0);
+	}
+	{
+		AudioLocker l;
+		hrtf_dataset = data;
+		if (!bank.empty())
+			std::swap(hrtf_bank, bank);
+	}
+}
+
+void Context::set_hrtf_precision(HrtfBank::Precision precision) {
+	if (precision != HrtfBank::Float32 && precision != HrtfBank::Float16 && precision != HrtfBank::Log8)
+		throw_ex(("invalid hrtf precision %d", (int)precision));
+	//only the calling thread reads it
+	hrtf_precision = precision;
+	if (hrtf_dataset)
+		set_hrtf_dataset(hrtf_dataset);
+}
+
+void Context::set_hrtf_batch(unsigned lanes) {
+	AudioLocker l;
+	hrtf_batch = lanes;
+}
+
+void Context::set_hrtf_window(unsigned size) {
+	Hrtf::window_bits(size);
 	AudioLocker l;
-	streams_type::iterator i = streams.find(id);
-	if (i == streams.end())
+	hrtf_window = size;
+}
+
+void Context::set_stream_buffering(float depth, float low, float high) {
+	AudioLocker l;
+	stream_depth = depth;
+	stream_low = low;
+	stream_high = high;
+}
+
+void Context::set_resample_quality(Resampler::Quality quality) {
+	if (quality != Resampler::Fast && quality != Resampler::Medium && quality != Resampler::Best)
+		throw_ex(("invalid resample quality %d", (int)quality));
+	resample_quality = quality;
+}
+
+void Context::set_stream_threads(unsigned threads) {
+	//threads are started and joined without the audio lock, buffered data keeps the streams playing meanwhile
+	StreamDecoder *fresh = NULL;
+	if (threads > 0) {
+		fresh = new StreamDecoder;
+		fresh->start(threads);
+	}
+	StreamDecoder *old;
+	{
+		AudioLocker l;
+		old = decoder;
+		decoder = fresh;
+	}
+	if (old == NULL && fresh == NULL)
 		return;
-	
-	TRY {
-		delete i->second.stream;
-	} CATCH(clunk::format_string("stop(%d)", id).c_str(), {
-		streams.erase(i);
-		throw;
-	})
-	streams.erase(i);
+
+	//streams of the old decoder are released to it until its threads are gone, then they're handed over
+	if (old != NULL)
+		old->stop();
+	{
+		AudioLocker l;
+		for(StreamBuffer *buffer = streams; buffer != NULL; buffer = buffer->next_stream) {
+			if (buffer->decoder != old)
+				continue;
+			if (old != NULL)
+				old->remove(buffer);
+			buffer->decoder = fresh;
+			if (fresh != NULL)
+				fresh->add(buffer);
+		}
+	}
+	//deletes streams retired after it has stopped
+	delete old;
+}
+
+unsigned Context::get_stream_underruns(const int id) const {
+	std::lock_guard<std::mutex> lock(underruns_lock);
+	underruns_type::const_iterator i = underruns.find(id);
+	return i != underruns.end()? i->second.load(std::memory_order_relaxed): 0;
+}
+
+void Context::reset_stream_underruns() {
+	std::lock_guard<std::mutex> lock(underruns_lock);
+	for(underruns_type::iterator i = underruns.begin(); i != underruns.end(); ++i)
+		i->second.store(0, std::memory_order_relaxed);
 }
 
 void Context::set_volume(const int id, float volume) {
@@ -297,10 +789,10 @@ void Context::set_volume(const int id, float volume) {
 	if (volume > 1)
 		volume = 1;
 		
-	streams_type::iterator i = streams.find(id);
-	if (i == streams.end())
-		return;
-	i->second.gain = volume;
+	Command cmd(Command::SetStreamVolume);
+	cmd.index = id;
+	cmd.value = volume;
+	submit(cmd);
 }
 
 void Context::set_fx_volume(float volume) {
@@ -313,17 +805,59 @@ void Context::set_fx_volume(float volume) {
 		fx_volume = volume;
 }
 
+void Context::set_master_volume(float volume) {
+	if (volume < 0)
+		master_volume = 0;
+	else
+		master_volume = volume;
+}
+
 void Context::stop_all() {
 	AudioLocker l;
-	for(streams_type::iterator i = streams.begin(); i != streams.end(); ++i) {
-		delete i->second.stream;
+	flush();
+	while(streams != NULL) {
+		StreamBuffer *buffer = streams;
+		streams = buffer->next_stream;
+		release_stream(buffer);
 	}
-	streams.clear();
 }
 
 void Context::set_max_sources(int sources) {
 	AudioLocker l;
 	max_sources = sources;
+	reserve();
+}
+
+void Context::set_voice_fade(float seconds, float hysteresis) {
+	AudioLocker l;
+	voice_fade = seconds > 0? seconds: 0;
+	voice_hysteresis = hysteresis > 0? hysteresis: 0;
+}
+
+void Context::set_profiling(bool enabled, size_t capacity) {
+	AudioLocker l;
+	profiler.set_enabled(enabled, capacity);
+}
+
+void Context::set_command_mode(CommandMode mode, size_t capacity) {
+	AudioLocker l;
+	flush();
+	command_mode = mode;
+	if (capacity != commands.capacity())
+		commands.reset(capacity);
+}
+
+void Context::set_spatial_cell_size(float size) {
+	AudioLocker l;
+	_index.set_cell_size(size);
+}
+
+void Context::set_threads(unsigned threads, bool pin, unsigned spin) {
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	AudioLocker l;
+	workers.start(threads, pin, spin);
+	reserve();
 }
 
 /*!
@@ -445,6 +979,9 @@ void Context::set_max_sources(int sources) {
 		context.play(0, new FooStream("data/background_music.ogg"), false); //do not loop music, look below for details.
 		context.play(1, new FooStream("data/ambience_city.ogg"), true); //loops ambient
 	\endcode
+	Streams are read in the audio callback by default. Slow disk or decoder could make it miss the deadline, 
+	use Context::set_stream_threads(1) to read them on the background thread. 
+	Context::get_stream_underruns tells how many periods the stream failed to deliver in time.
 
 	There's no magic numbers here. I've chosen 0 and 1 just for fun. You could use any integer id. 42 for example. 
 	Why don't I use loop == true for music ? We need it to change various tunes. Let's periodically test if music ends and restart with new tune: 
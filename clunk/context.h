@@ -25,8 +25,11 @@ SOFTWARE.
 #ifndef CLUNK_CONTEXT_H__
 #define CLUNK_CONTEXT_H__
 
+#include <atomic>
 #include <map>
 #include <deque>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <stdio.h>
 
@@ -35,6 +38,15 @@ SOFTWARE.
 #include <clunk/sample.h>
 #include <clunk/buffer.h>
 #include <clunk/distance_model.h>
+#include <clunk/limiter.h>
+#include <clunk/worker_pool.h>
+#include <clunk/spatial_index.h>
+#include <clunk/command_queue.h>
+#include <clunk/hrtf.h>
+#include <clunk/hrtf_bank.h>
+#include <clunk/profiler.h>
+#include <clunk/resampler.h>
+#include <clunk/stream_decoder.h>
 
 namespace clunk {
 
@@ -48,19 +60,58 @@ class Stream;
 
 class CLUNKAPI Context {
 public: 
+	//!How setters of the objects and streams reach the audio thread
+	enum CommandMode {
+		///every setter takes the audio lock and applies changes immediately
+		Locking,
+		///setters push commands into the lock-free queue drained at the beginning of the period. Queries still lock and flush the queue.
+		Queued
+	};
+
 	Context();
 	
 	/*! 
 		\brief Initializes clunk context. 
 		\param[in] spec specification of audio format
+		\param[in] period period size in frames. All scratch memory used by process() is allocated here, so audio thread does not allocate in steady state. 0 - allocate on the first use.
 	*/
-	void init(const AudioSpec &spec);
+	void init(const AudioSpec &spec, unsigned period = 0);
 	/*! 
 		\brief Sets maximum simultaneous sources number. 
 		Do not use values that are too high. Use reasonable default such as 8 or 16 
+		Sources are ranked by estimated gain (distance model * source and sample gain * priority), 
+		best ones are mixed, the rest are virtual: they only advance their position.
 		\param[in] sources maximum simultaneous sources
 	*/
 	void set_max_sources(int sources);
+	/*!
+		\brief Sets virtual voices parameters.
+		\param[in] seconds fade in/out time of the voices promoted to or demoted from the mixed ones
+		\param[in] hysteresis score bonus of the currently mixed voices, 0.5 means a new voice must be 1.5 times louder to replace it
+	*/
+	void set_voice_fade(float seconds, float hysteresis = 0.5f);
+	/*!
+		\brief Sets number of threads rendering sources.
+		Sources are split into fixed partitions, each one mixed into its own accumulator, 
+		accumulators are summed in partition order, so output does not depend on the thread timings.
+		\param[in] threads total number of threads including audio one, 0 - use all available cores, 1 - render everything in the audio thread (default)
+		\param[in] pin pin worker threads to the cpu cores
+		\param[in] spin time in microseconds workers spin waiting for the next period before going to sleep
+	*/
+	void set_threads(unsigned threads, bool pin = false, unsigned spin = 500);
+	/*!
+		\brief Sets cell size of the spatial grid used to find the nearest objects.
+		Only cells around the listener are visited each period, so pick the size where a cell holds a few emitters.
+		\param[in] size cell size in world units
+	*/
+	void set_spatial_cell_size(float size);
+	/*!
+		\brief Selects the way setters are passed to the audio thread. Default is Queued.
+		Call it before objects are used from the other threads: queue is reallocated if capacity changes.
+		\param[in] mode command mode
+		\param[in] capacity queue capacity, setters fall back to locking when the queue is full
+	*/
+	void set_command_mode(CommandMode mode, size_t capacity = 4096);
 	
 	//saves raw stream into file. use save(std::string()) to stop this madness.
 	void save(const std::string &file);
@@ -103,6 +154,62 @@ public:
 	void pause(int id);
 	///stops stream with given id
 	void stop(int id);
+	/*!
+		\brief selects hrtf engine
+		\param[in] engine Hrtf::MdctFilter (default) or Hrtf::Convolution: uniformly partitioned overlap-save convolution with the complex responses
+		\param[in] partition convolution partition size: 64, 128 or 256 samples. CPU cost per voice is one forward and one inverse fft of twice that size plus 512 / partition complex multiplications per bin per ear.
+	*/
+	void set_hrtf_engine(Hrtf::Engine engine, unsigned partition = 128);
+	/*!
+		\brief sets number of sources sharing forward and inverse MDCTs of MdctFilter engine
+		\param[in] lanes 4 (default) or 8 sources are transformed together, 0 or 1 disables batching
+	*/
+	void set_hrtf_batch(unsigned lanes);
+	/*!
+		\brief sets MDCT window size of the MdctFilter engine, sources may override it with Source::set_hrtf_window
+		\param[in] size power of two from 128 to 2048 samples, 512 by default. Smaller windows lower the latency and the CPU cost per sample but smear the responses in frequency, larger ones are sharper in frequency but smear transients.
+	*/
+	void set_hrtf_window(unsigned size);
+	///returns MDCT window size
+	unsigned get_hrtf_window() const { return hrtf_window; }
+	/*!
+		\brief replaces hrtf dataset, new responses are prepared before the audio thread is locked
+		\param[in] fname binary dataset written by kemar/import.py, it's memory mapped. Empty name restores the builtin KEMAR set.
+	*/
+	void set_hrtf_dataset(const std::string &fname);
+	/*!
+		\brief replaces hrtf dataset
+		\param[in] dataset dataset to use, NULL restores the builtin KEMAR set
+	*/
+	void set_hrtf_dataset(const std::shared_ptr<const HrtfDataset> &dataset);
+	/*!
+		\brief sets storage of the hrtf magnitudes, rebuilds the responses if context is initialized
+		\param[in] precision HrtfBank::Float16 (default), HrtfBank::Float32 or HrtfBank::Log8
+	*/
+	void set_hrtf_precision(HrtfBank::Precision precision);
+	///returns responses of the current dataset, e.g. to check their memory footprint
+	const HrtfBank &get_hrtf_bank() const { return hrtf_bank; }
+	/*!
+		\brief sets buffering of the streams started after this call
+		\param[in] depth ring buffer size, seconds. It's never less than two periods.
+		\param[in] low stream is decoded when buffered data drops below this level or below one period, seconds
+		\param[in] high decoding stops when buffered data reaches this level, seconds
+	*/
+	void set_stream_buffering(float depth, float low, float high);
+	/*!
+		\brief sets filter used to convert sample rate of the samples initialized and the streams started after this call
+		\param[in] quality Resampler::Medium (default), Resampler::Fast or Resampler::Best
+	*/
+	void set_resample_quality(Resampler::Quality quality);
+	Resampler::Quality get_resample_quality() const { return resample_quality; }
+	/*!
+		\brief decodes streams on the background threads
+		\param[in] threads number of decoding threads, 0 reads streams in the audio callback (default)
+	*/
+	void set_stream_threads(unsigned threads);
+	///returns number of periods the stream with given id could not fill since the last reset_stream_underruns()
+	unsigned get_stream_underruns(int id) const;
+	void reset_stream_underruns();
 	/*!
 		\brief sets volume for stream
 		\param[in] id stream id
@@ -115,6 +222,11 @@ public:
 		\param[in] volume volume of the 3d-sounds (global fx volume, 0.0 - 1.0)
 	*/
 	void set_fx_volume(float volume);
+	/*!
+		\brief sets master volume, the final gain stage applied right before the limiter
+		\param[in] volume master volume, values above 1.0 are allowed and handled by the limiter
+	*/
+	void set_master_volume(float volume);
 	/*!
 		\brief stops all sources.
 	*/
@@ -127,34 +239,99 @@ public:
 	inline void set_distance_model(const DistanceModel &model) { distance_model = model; }
 	DistanceModel &get_distance_model() { return distance_model; }
 
+	///returns output limiter
+	Limiter &get_limiter() { return limiter; }
+
+	/*!
+		\brief enables callback profiling
+		\param[in] enabled enable profiling
+		\param[in] capacity number of records in the ring, records are dropped if game thread does not pop them in time
+	*/
+	void set_profiling(bool enabled, size_t capacity = 256);
+	///returns profiler, pop records from it and aggregate them with ProfileStats
+	Profiler &get_profiler() { return profiler; }
+
 private:
 	AudioSpec _spec;
 
 	void delete_object(Object *o);
 
-	friend clunk::Object::~Object();
+	friend class clunk::Object;
 	friend clunk::Sample::~Sample();
 	
 	typedef std::deque<Object *> objects_type;
 	objects_type objects;
+	//nodes of the source maps of the objects, setters add one per played source
+	NodePool source_nodes;
+	//interned source names, used by the api threads only
+	typedef std::map<const std::string, int> source_names_type;
+	source_names_type source_names;
+	std::mutex source_names_lock;
+	//returns id of the source name, adds it if add is true, returns -1 otherwise
+	int source_name(const std::string &name, bool add);
+	SpatialIndex _index;
+
+	CommandMode command_mode;
+	CommandQueue commands;
+	//executes command or pushes it into the queue
+	void submit(const Command &cmd);
+	void execute(const Command &cmd);
+	//executes all queued commands, audio lock must be held
+	void flush();
+	//frames generated so far
+	u64 _clock;
+	//round-robin position of the dead objects collector
+	size_t _sweep;
+	void sweep_objects();
 	
-	struct stream_info {
-		stream_info() : stream(nullptr), loop(false), gain(1.0f), paused(false), buffer() {}
-		Stream *stream;
-		bool loop;
-		float gain;
-		bool paused;
-		clunk::Buffer buffer;
-	};
-	
-	typedef std::map<const int, stream_info> streams_type;
-	streams_type streams;
+	//playing streams sorted by id, linked through StreamBuffer::next_stream
+	StreamBuffer *streams;
+	//returns link pointing to the stream with given id or to the place it goes to
+	StreamBuffer **find_stream(int id);
+
+	//stream buffering levels, seconds
+	float stream_depth, stream_low, stream_high;
+	//only the calling thread reads it
+	Resampler::Quality resample_quality;
+	//deletes stream buffer or hands it to the decoder
+	void release_stream(StreamBuffer *buffer);
+	std::vector<float *> stream_bus;
+	//decoder of the streams played from now on, NULL if they're filled in the callback
+	StreamDecoder *decoder;
+	//underruns per stream id, created by play() on the calling thread, audio thread counts through StreamBuffer::underruns
+	typedef std::map<const int, std::atomic<unsigned> > underruns_type;
+	underruns_type underruns;
+	mutable std::mutex underruns_lock;
 
 	ListenerObject *_listener;
 	unsigned max_sources;
 	float fx_volume;
+	float master_volume;
+
+	float voice_fade, voice_hysteresis;
+	//maximum of the gain and priority among the sources, used to stop the objects walk early
+	float voice_gain_bound, voice_priority_bound;
 	
 	DistanceModel distance_model;
+	Limiter limiter;
+	//hrtf responses at the output sample rate, built by init()
+	HrtfBank hrtf_bank;
+	//dataset of the bank, NULL until init() or set_hrtf_dataset()
+	std::shared_ptr<const HrtfDataset> hrtf_dataset;
+	HrtfBank::Precision hrtf_precision;
+	Hrtf::Engine hrtf_engine;
+	unsigned hrtf_partition;
+	unsigned hrtf_batch;
+	unsigned hrtf_window;
+
+	//planar float mix bus, channels * period samples
+	std::vector<float> bus_data;
+	std::vector<float *> bus;
+
+	WorkerPool workers;
+	//accumulators for the partitions 1..N, partition 0 is mixed into the bus directly
+	std::vector<float> partition_data;
+	std::vector<float *> partition_bus;
 	
 	FILE * _fdump;
 
@@ -165,11 +342,49 @@ private:
 		v3f s_vel;
 		v3f l_vel;
 
-		inline source_t(Source *source, const v3f &s_pos, const v3f &s_vel, const v3f& l_vel):
-		source(source), s_pos(s_pos), s_vel(s_vel), l_vel(l_vel) {}
+		Object *object;
+		float score;
+		unsigned order;
+
+		float volume;
+		float pitch;
+		DistanceModel::Tier tier;
+		//render time, seconds. filled only when profiling
+		float cost;
+
+		inline source_t(Source *source, const v3f &s_pos, const v3f &s_vel, const v3f& l_vel, Object *object, float score, unsigned order):
+		source(source), s_pos(s_pos), s_vel(s_vel), l_vel(l_vel), object(object), score(score), order(order), volume(0), pitch(1), tier(DistanceModel::FullHrtf), cost(0) {}
 	};
 	template<class Sources>
-	bool process_object(Object *o, Sources &sset, std::vector<source_t> &lsources, unsigned n);
+	bool process_object(Object *o, Sources &sset, unsigned n);
+	void visit_object(Object *o, unsigned n);
+	void destroy_object(Object *o);
+	void select_voices(unsigned n);
+	void add_voice_score(float score);
+	void add_source(const Source *s);
+
+	//candidates for the voices, lsources - mixed ones
+	std::vector<source_t> voices;
+	std::vector<float> voice_scores;
+	//objects having real or fading voices, visited each period even if walk stopped before them
+	std::vector<Object *> voiced_objects, previous_voiced_objects;
+	std::vector<source_t> lsources;
+	SpatialIndex::Query::storage_type query_storage;
+
+	//period size in frames passed to init, scratch memory is sized for it
+	unsigned _period;
+	void reserve();
+
+	Profiler profiler;
+	//record of the current period, NULL if profiling is disabled
+	ProfileRecord *_profile;
+	void profile_stage(ProfileRecord::Stage stage, Profiler::clock_type::time_point &start);
+
+	//source rendering scratch, Hrtf::MaxBatch per partition
+	std::vector<Buffer> partition_scratch;
+	unsigned partitions;
+	unsigned partition_n;
+	static void render_partition(void *context, unsigned partition);
 };
 }
 
@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/cpu_features.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+#	include <intrin.h>
+#	define CLUNK_CPUID_X86
+#elif (defined __GNUC__ || defined __clang__) && (defined __x86_64__ || defined __i386__)
+#	include <cpuid.h>
+#	define CLUNK_CPUID_X86
+#endif
+
+using namespace clunk;
+
+#ifdef CLUNK_CPUID_X86
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subleaf);
+	for(int i = 0; i < 4; ++i)
+		regs[i] = (unsigned)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//register state enabled by the os
+static unsigned long long xgetbv() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static CpuFeatures::Level detect_cpu() {
+	unsigned regs[4];
+	cpuid(0, 0, regs);
+	const unsigned max_leaf = regs[0];
+	if (max_leaf < 1)
+		return CpuFeatures::Scalar;
+
+	cpuid(1, 0, regs);
+	const unsigned ecx1 = regs[2], edx1 = regs[3];
+	if (!(edx1 & (1u << 26))) //sse2
+		return CpuFeatures::Scalar;
+
+	const bool osxsave = (ecx1 & (1u << 27)) != 0, avx = (ecx1 & (1u << 28)) != 0, fma = (ecx1 & (1u << 12)) != 0;
+	if (!osxsave || !avx || !fma || max_leaf < 7)
+		return CpuFeatures::SSE;
+
+	const unsigned long long xcr0 = xgetbv();
+	//xmm and ymm state
+	if ((xcr0 & 0x6) != 0x6)
+		return CpuFeatures::SSE;
+
+	cpuid(7, 0, regs);
+	const unsigned ebx7 = regs[1];
+	if (!(ebx7 & (1u << 5))) //avx2
+		return CpuFeatures::SSE;
+
+	//avx512f and opmask, zmm0-15 upper halves, zmm16-31 state
+	if ((ebx7 & (1u << 16)) && (xcr0 & 0xe6) == 0xe6)
+		return CpuFeatures::AVX512;
+	return CpuFeatures::AVX2;
+}
+#else
+static CpuFeatures::Level detect_cpu() {
+	return CpuFeatures::Scalar;
+}
+#endif
+
+static CpuFeatures::Level detect_level() {
+	CpuFeatures::Level level = detect_cpu();
+	const char *env = getenv("CLUNK_SIMD");
+	if (env != NULL) {
+		for(int l = CpuFeatures::Scalar; l < (int)level; ++l) {
+			if (strcmp(env, CpuFeatures::name((CpuFeatures::Level)l)) == 0)
+				return (CpuFeatures::Level)l;
+		}
+	}
+	return level;
+}
+
+static std::atomic<int> & current_level() {
+	static std::atomic<int> level(detect_level());
+	return level;
+}
+
+CpuFeatures::Level CpuFeatures::detect() {
+	static const Level level = detect_level();
+	return level;
+}
+
+CpuFeatures::Level CpuFeatures::get() {
+	return (Level)current_level().load(std::memory_order_relaxed);
+}
+
+void CpuFeatures::set(Level level) {
+	current_level().store(level < detect()? level: detect(), std::memory_order_relaxed);
+}
+
+const char * CpuFeatures::name(Level level) {
+	switch(level) {
+	case Scalar:	return "scalar";
+	case SSE:	return "sse";
+	case AVX2:	return "avx2";
+	case AVX512:	return "avx512";
+	default: 	return "unknown";
+	}
+}
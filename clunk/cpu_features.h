@@ -0,0 +1,48 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_CPU_FEATURES_H__
+#define CLUNK_CPU_FEATURES_H__
+
+#include <clunk/export_clunk.h>
+
+namespace clunk {
+
+//!SIMD instruction sets of the runtime dispatched FFT kernels
+struct CLUNKAPI CpuFeatures {
+	enum Level { Scalar, SSE, AVX2, AVX512, Levels };
+
+	///returns best level supported by both the cpu and the os. CLUNK_SIMD environment variable (scalar, sse, avx2, avx512) lowers it.
+	static Level detect();
+	///returns level used by the kernels
+	static Level get();
+	///forces kernel level, e.g. to compare results of all the paths. It's clamped to detect(). Do not call it while context is running.
+	static void set(Level level);
+	///returns lowercase level name
+	static const char * name(Level level);
+};
+
+}
+
+#endif
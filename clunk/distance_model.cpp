@@ -69,6 +69,14 @@ float clunk::DistanceModel::gain(float distance) const {
 	return gain;
 }
 
+clunk::DistanceModel::Tier clunk::DistanceModel::tier(float distance) const {
+	distance /= distance_divisor;
+	if (hrtf_distance <= 0 || distance < hrtf_distance)
+		return FullHrtf;
+	if (itd_distance <= 0 || distance < itd_distance)
+		return ItdIld;
+	return GainPanning;
+}
 
 float clunk::DistanceModel::doppler_pitch(const v3f &sl, const v3f &s_vel, const v3f &l_vel) const {
 	if (doppler_factor <= 0)
@@ -35,6 +35,8 @@ namespace clunk {
 struct CLUNKAPI DistanceModel {
 	//!Type of the distance model: inversed, linear or exponent.
 	enum Type { Inverse, Linear, Exponent };
+	//!Spatialization quality tier: full HRTF, interaural time and level differences only or plain gain panning.
+	enum Tier { FullHrtf, ItdIld, GainPanning };
 
 	//!Type of the distance model
 	Type type;
@@ -60,6 +62,11 @@ struct CLUNKAPI DistanceModel {
 	
 	//! limit same sounds near you
 	unsigned same_sounds_limit;
+
+	//! Voices closer than hrtf_distance get full HRTF, 0 (default) means no limit.
+	float hrtf_distance;
+	//! Voices closer than itd_distance (but not closer than hrtf_distance) get ITD+ILD panning, the rest gets gain panning. 0 (default) means no limit.
+	float itd_distance;
 	
 	/*!
 		\brief Constructor
@@ -69,11 +76,13 @@ struct CLUNKAPI DistanceModel {
 	*/ 
 	DistanceModel(Type type, bool clamped, float max_distance = 0): type(type), clamped(clamped), 
 	reference_distance(1), max_distance(max_distance), rolloff_factor(1), doppler_factor(0), 
-	speed_of_sound(343.3f), distance_divisor(1), same_sounds_limit(2)
+	speed_of_sound(343.3f), distance_divisor(1), same_sounds_limit(2), hrtf_distance(0), itd_distance(0)
 	{}
 	
 	//! Computes gain by distance. Return values is in [0-1] range.
 	float gain(float distance) const;
+	//! Returns spatialization tier for the distance.
+	Tier tier(float distance) const;
 	//! Computes doppler pitch.
 	float doppler_pitch(const v3f &sl, const v3f &s_vel, const v3f &l_vel) const;
 };
@@ -25,160 +25,136 @@ SOFTWARE.
 #ifndef FFT_CONTEXT_H__
 #define FFT_CONTEXT_H__
 
+#include <clunk/config.h>
+
+#ifndef _USE_MATH_DEFINES
+#	define _USE_MATH_DEFINES
+#endif
+
 #include <complex>
 #include <assert.h>
+#include <math.h>
 
 namespace clunk {
 
-template<int N, typename T>
-class danielson_lanczos {
-	typedef danielson_lanczos<N / 2, T> next_type;
-	next_type _next;
-
-	T _sin_a, _sin_a2;
-
-public:
-	danielson_lanczos()
-	{
-		T a = (T)(-2 * M_PI / N);
-		_sin_a = sin(a);
-		_sin_a2 = -sin(a / 2);
-	}
-
-	template<int SIGN>
-	void apply(std::complex<T>* data) {
-		_next.template apply<SIGN>(data);
-		_next.template apply<SIGN>(data + N / 2);
-		
-		std::complex<T> wp(-2 * _sin_a2 * _sin_a2, _sin_a * SIGN), w(1, 0);
-
-		for (unsigned i = 0; i < N / 2 ; ++i) {
-			int j = i + N / 2;
-
-			std::complex<T> temp = data[j] * w;
-
-			data[j] = data[i] - temp;
-			data[i] += temp;
-
-			w += w * wp;
+//!Twiddles and bit reversal permutation shared by all fft contexts of the same size
+/*!
+	Radix-4 pass combining sub transforms of size q keeps w^k, w^2k and w^3k (w = exp(-2 pi i / 4q), k < q) as three blocks of q values 
+	starting at q - first_q(). Odd BITS start with radix-2 pass, so first_q() is 2 for them and 1 for even BITS.
+*/
+template<int BITS, typename T>
+struct fft_tables {
+	enum { N = 1 << BITS };
+	T w_re[N], w_im[N];
+	unsigned reversed[N];
+
+	static inline unsigned first_q() { return (BITS & 1)? 2: 1; }
+
+	fft_tables() : w_re(), w_im() {
+		for(unsigned q = first_q(); 4 * q <= N; q *= 4) {
+			T *re = w_re + q - first_q(), *im = w_im + q - first_q();
+			for(unsigned m = 1; m <= 3; ++m) {
+				for(unsigned k = 0; k < q; ++k) {
+					double a = -2 * M_PI * m * k / (4 * q);
+					re[(m - 1) * q + k] = (T)cos(a);
+					im[(m - 1) * q + k] = (T)sin(a);
+				}
+			}
+		}
+		for(unsigned i = 0; i < N; ++i) {
+			unsigned r = 0;
+			for(int b = 0; b < BITS; ++b)
+				r |= ((i >> b) & 1) << (BITS - 1 - b);
+			reversed[i] = r;
 		}
 	}
-};
-
-template<typename T>
-struct danielson_lanczos<4, T> {
-	typedef danielson_lanczos<2, T> next_type;
-
-	template<int SIGN>
-	static inline void apply(std::complex<T>* data) {
-		next_type::template apply<SIGN>(data);
-		next_type::template apply<SIGN>(data + 2);
-		
-		std::complex<T> temp = data[2];
-		data[2] = data[0] - temp;
-		data[0] += temp;
-
-		temp = data[3] * std::complex<T>(0, -SIGN);
-		data[3] = data[1] - temp;
-		data[1] += temp;
-	}
-};
-
-
-template<typename T>
-struct danielson_lanczos<8, T> {
-	typedef danielson_lanczos<4, T> next_type;
-	next_type _next;
-
-	static inline void rotate(std::complex<T>* data, int i, const std::complex<T>& w) {
-		int j = i + 4;
-
-		std::complex<T> temp = data[j] * w;
-
-		data[j] = data[i] - temp;
-		data[i] += temp;
-	}
-
-	template<int SIGN>
-	inline void apply(std::complex<T>* data) {
-		_next.template apply<SIGN>(data);
-		_next.template apply<SIGN>(data + 4);
-		
-		rotate(data, 0, std::complex<T>(1, 0));
-		rotate(data, 1, std::complex<T>(float(M_SQRT1_2), -float(M_SQRT1_2) * SIGN));
-		rotate(data, 2, std::complex<T>(0, -1));
-		rotate(data, 3, std::complex<T>(-float(M_SQRT1_2), -float(M_SQRT1_2) * SIGN));
-	}
-};
-
 
-template<typename T>
-struct danielson_lanczos<2, T> {
-	template<int SIGN>
-	static inline void apply(std::complex<T>* data) {
-		std::complex<T> temp = data[1];
-
-		data[1] = data[0] - temp;
-		data[0] += temp;
+	static const fft_tables & get() {
+		static const fft_tables tables;
+		return tables;
 	}
 };
 
-
-template<typename T>
-struct danielson_lanczos<1, T> {
-	template<int SIGN>
-	static inline void apply(std::complex<T>*) {}
-};
-
-
+//!Iterative radix-4 FFT, bit reversal is folded into the first pass
 template<int BITS, typename T = float>
-class fft_context : private danielson_lanczos<1 << BITS, T> {
+class fft_context {
 public: 
 	enum { N = 1 << BITS };
 
-private:
-	typedef danielson_lanczos<N, T> next_type;
-
-public:
 	typedef std::complex<T> value_type;
 	value_type data[N];
 
-	fft_context(): data() { }
+	fft_context(): data(), _work() { }
 	
 	inline void fft() {
-		scramble(data);
-		next_type::template apply<1>(data);
+		transform(1);
 	}
 
 	inline void ifft() {
-		scramble(data);
-		next_type::template apply<-1>(data);
-		for(unsigned i = 0; i < N; ++i) {
-			data[i] /= N;
-		}
+		transform(-1);
 	}
 	
 private:
-	static inline void scramble(std::complex<T> * data) {
-		int j = 0;
-		for(int i = 0; i < N; ++i) {
-			if (i > j) {
-				std::swap(data[i], data[j]);
+	typedef fft_tables<BITS, T> tables_type;
+	value_type _work[N];
+
+	static inline value_type mul(const value_type &x, T w_re, T w_im) {
+		return value_type(x.real() * w_re - x.imag() * w_im, x.real() * w_im + x.imag() * w_re);
+	}
+
+	//b is the sub transform of samples 4n + 2, c of 4n + 1 and d of 4n + 3, all of them are already rotated
+	static inline void butterfly(const value_type &a, const value_type &b, const value_type &c, const value_type &d, value_type *x, unsigned q) {
+		value_type t0 = a + b, t1 = a - b, t2 = c + d, t3 = c - d;
+		value_type r3(t3.imag(), -t3.real()); //-i * t3
+		x[0] = t0 + t2;
+		x[q] = t1 + r3;
+		x[2 * q] = t0 - t2;
+		x[3 * q] = t1 - r3;
+	}
+
+	//inverse transform is conj(fft(conj(x))) / N
+	void transform(T sign) {
+		const tables_type &tables = tables_type::get();
+		const unsigned *reversed = tables.reversed;
+		if (N == 1) {
+			return;
+		} else if (BITS & 1) {
+			for(unsigned i = 0; i < N; i += 2) {
+				const value_type &a = data[reversed[i]], &b = data[reversed[i + 1]];
+				_work[i] = value_type(a.real() + b.real(), sign * (a.imag() + b.imag()));
+				_work[i + 1] = value_type(a.real() - b.real(), sign * (a.imag() - b.imag()));
+			}
+		} else {
+			for(unsigned i = 0; i < N; i += 4) {
+				const value_type *x[4] = { data + reversed[i], data + reversed[i + 1], data + reversed[i + 2], data + reversed[i + 3] };
+				value_type v[4];
+				for(unsigned j = 0; j < 4; ++j)
+					v[j] = value_type(x[j]->real(), sign * x[j]->imag());
+				butterfly(v[0], v[1], v[2], v[3], _work + i, 1);
 			}
-			int m = N / 2;
-			while(j >= m && m >= 2) {
-				j -= m;
-				m >>= 1;
+		}
+
+		for(unsigned q = (BITS & 1)? 2: 4; q < N; q *= 4) {
+			const T *w_re = tables.w_re + q - tables_type::first_q(), *w_im = tables.w_im + q - tables_type::first_q();
+			for(unsigned base = 0; base < N; base += 4 * q) {
+				value_type *x = _work + base;
+				for(unsigned k = 0; k < q; ++k) {
+					butterfly(x[k], mul(x[k + q], w_re[q + k], w_im[q + k]), 
+						mul(x[k + 2 * q], w_re[k], w_im[k]), mul(x[k + 3 * q], w_re[2 * q + k], w_im[2 * q + k]), x + k, q);
+				}
 			}
-			j += m;
 		}
+
+		const T scale = sign > 0? T(1): T(1) / N;
+		for(unsigned i = 0; i < N; ++i)
+			data[i] = value_type(_work[i].real() * scale, sign * _work[i].imag() * scale);
 	}
 };
 
 }
 
-#ifdef CLUNK_USES_SSE
-#	include "sse_fft_context.h"
+#ifdef CLUNK_USES_SIMD
+#	include "simd_fft_context.h"
 #endif
 
 #endif
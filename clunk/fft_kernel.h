@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_FFT_KERNEL_H__
+#define CLUNK_FFT_KERNEL_H__
+
+//radix-4 passes shared by the kernels. Every kernel translation unit is compiled with its own instruction set, 
+//so everything here has internal linkage: the linker must not merge avx512 copy into the scalar kernel.
+
+namespace clunk {
+
+void fft_kernel_scalar(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im);
+void fft_kernel_sse(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im);
+void fft_kernel_avx2(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im);
+void fft_kernel_avx512(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im);
+
+namespace {
+
+//radix-2 pass for odd bits and radix-4 pass without twiddles for even ones, returns sub transform size q of the next pass
+inline unsigned fft_first_pass(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits) {
+	const unsigned n = 1u << bits;
+	if (n == 1) {
+		re[0] = src[0];
+		im[0] = sign * src[1];
+		return 1;
+	} else if (bits & 1) {
+		for(unsigned i = 0; i < n; i += 2) {
+			const float *a = src + 2 * reversed[i], *b = src + 2 * reversed[i + 1];
+			re[i] = a[0] + b[0];
+			im[i] = sign * (a[1] + b[1]);
+			re[i + 1] = a[0] - b[0];
+			im[i + 1] = sign * (a[1] - b[1]);
+		}
+		return 2;
+	} else {
+		for(unsigned i = 0; i < n; i += 4) {
+			const float *a = src + 2 * reversed[i], *b = src + 2 * reversed[i + 1], *c = src + 2 * reversed[i + 2], *d = src + 2 * reversed[i + 3];
+			float t0r = a[0] + b[0], t0i = sign * (a[1] + b[1]), t1r = a[0] - b[0], t1i = sign * (a[1] - b[1]);
+			float t2r = c[0] + d[0], t2i = sign * (c[1] + d[1]), t3r = c[0] - d[0], t3i = sign * (c[1] - d[1]);
+			re[i] = t0r + t2r;
+			im[i] = t0i + t2i;
+			re[i + 1] = t1r + t3i;
+			im[i + 1] = t1i - t3r;
+			re[i + 2] = t0r - t2r;
+			im[i + 2] = t0i - t2i;
+			re[i + 3] = t1r - t3i;
+			im[i + 3] = t1i + t3r;
+		}
+		return 4;
+	}
+}
+
+//twiddles of the pass with sub transform size q
+inline unsigned fft_stage_offset(unsigned bits, unsigned q) {
+	return q - ((bits & 1)? 2: 1);
+}
+
+inline void fft_pass(float *re, float *im, unsigned n, unsigned q, const float *w_re, const float *w_im) {
+	for(unsigned base = 0; base < n; base += 4 * q) {
+		float *xr = re + base, *xi = im + base;
+		for(unsigned k = 0; k < q; ++k) {
+			float ar = xr[k], ai = xi[k];
+			float br = xr[k + q] * w_re[q + k] - xi[k + q] * w_im[q + k], bi = xr[k + q] * w_im[q + k] + xi[k + q] * w_re[q + k];
+			float cr = xr[k + 2 * q] * w_re[k] - xi[k + 2 * q] * w_im[k], ci = xr[k + 2 * q] * w_im[k] + xi[k + 2 * q] * w_re[k];
+			float dr = xr[k + 3 * q] * w_re[2 * q + k] - xi[k + 3 * q] * w_im[2 * q + k], di = xr[k + 3 * q] * w_im[2 * q + k] + xi[k + 3 * q] * w_re[2 * q + k];
+			float t0r = ar + br, t0i = ai + bi, t1r = ar - br, t1i = ai - bi;
+			float t2r = cr + dr, t2i = ci + di, t3r = cr - dr, t3i = ci - di;
+			xr[k] = t0r + t2r;
+			xi[k] = t0i + t2i;
+			xr[k + q] = t1r + t3i;
+			xi[k + q] = t1i - t3r;
+			xr[k + 2 * q] = t0r - t2r;
+			xi[k + 2 * q] = t0i - t2i;
+			xr[k + 3 * q] = t1r - t3i;
+			xi[k + 3 * q] = t1i + t3r;
+		}
+	}
+}
+
+//V::Width butterflies at once, q must be multiple of V::Width
+template<typename V>
+inline void fft_pass(float *re, float *im, unsigned n, unsigned q, const float *w_re, const float *w_im) {
+	typedef typename V::type type;
+	for(unsigned base = 0; base < n; base += 4 * q) {
+		float *xr = re + base, *xi = im + base;
+		for(unsigned k = 0; k < q; k += V::Width) {
+			type w1r = V::load(w_re + k), w1i = V::load(w_im + k);
+			type w2r = V::load(w_re + q + k), w2i = V::load(w_im + q + k);
+			type w3r = V::load(w_re + 2 * q + k), w3i = V::load(w_im + 2 * q + k);
+
+			type ar = V::load(xr + k), ai = V::load(xi + k);
+			type yr = V::load(xr + k + q), yi = V::load(xi + k + q);
+			type br = V::fmsub(yr, w2r, V::mul(yi, w2i)), bi = V::fmadd(yr, w2i, V::mul(yi, w2r));
+			yr = V::load(xr + k + 2 * q);
+			yi = V::load(xi + k + 2 * q);
+			type cr = V::fmsub(yr, w1r, V::mul(yi, w1i)), ci = V::fmadd(yr, w1i, V::mul(yi, w1r));
+			yr = V::load(xr + k + 3 * q);
+			yi = V::load(xi + k + 3 * q);
+			type dr = V::fmsub(yr, w3r, V::mul(yi, w3i)), di = V::fmadd(yr, w3i, V::mul(yi, w3r));
+
+			type t0r = V::add(ar, br), t0i = V::add(ai, bi), t1r = V::sub(ar, br), t1i = V::sub(ai, bi);
+			type t2r = V::add(cr, dr), t2i = V::add(ci, di), t3r = V::sub(cr, dr), t3i = V::sub(ci, di);
+			V::store(xr + k, V::add(t0r, t2r));
+			V::store(xi + k, V::add(t0i, t2i));
+			V::store(xr + k + q, V::add(t1r, t3i));
+			V::store(xi + k + q, V::sub(t1i, t3r));
+			V::store(xr + k + 2 * q, V::sub(t0r, t2r));
+			V::store(xi + k + 2 * q, V::sub(t0i, t2i));
+			V::store(xr + k + 3 * q, V::sub(t1r, t3i));
+			V::store(xi + k + 3 * q, V::add(t1i, t3r));
+		}
+	}
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/fft_kernel.h>
+#include <immintrin.h>
+
+namespace clunk {
+namespace {
+
+struct sse_vector {
+	typedef __m128 type;
+	enum { Width = 4 };
+	static inline type load(const float *p) { return _mm_loadu_ps(p); }
+	static inline void store(float *p, type v) { _mm_storeu_ps(p, v); }
+	static inline type add(type a, type b) { return _mm_add_ps(a, b); }
+	static inline type sub(type a, type b) { return _mm_sub_ps(a, b); }
+	static inline type mul(type a, type b) { return _mm_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) { return _mm_fmadd_ps(a, b, c); }
+	static inline type fmsub(type a, type b, type c) { return _mm_fmsub_ps(a, b, c); }
+};
+
+struct avx_vector {
+	typedef __m256 type;
+	enum { Width = 8 };
+	static inline type load(const float *p) { return _mm256_loadu_ps(p); }
+	static inline void store(float *p, type v) { _mm256_storeu_ps(p, v); }
+	static inline type add(type a, type b) { return _mm256_add_ps(a, b); }
+	static inline type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+	static inline type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+	static inline type fmsub(type a, type b, type c) { return _mm256_fmsub_ps(a, b, c); }
+};
+
+struct avx512_vector {
+	typedef __m512 type;
+	enum { Width = 16 };
+	static inline type load(const float *p) { return _mm512_loadu_ps(p); }
+	static inline void store(float *p, type v) { _mm512_storeu_ps(p, v); }
+	static inline type add(type a, type b) { return _mm512_add_ps(a, b); }
+	static inline type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+	static inline type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+	static inline type fmadd(type a, type b, type c) { return _mm512_fmadd_ps(a, b, c); }
+	static inline type fmsub(type a, type b, type c) { return _mm512_fmsub_ps(a, b, c); }
+};
+
+}
+
+void fft_kernel_avx512(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im) {
+	const unsigned n = 1u << bits;
+	for(unsigned q = fft_first_pass(src, reversed, sign, re, im, bits); q < n; q *= 4) {
+		const unsigned offset = fft_stage_offset(bits, q);
+		if (q < 4)
+			fft_pass(re, im, n, q, w_re + offset, w_im + offset);
+		else if (q < 8)
+			fft_pass<sse_vector>(re, im, n, q, w_re + offset, w_im + offset);
+		else if (q < 16)
+			fft_pass<avx_vector>(re, im, n, q, w_re + offset, w_im + offset);
+		else
+			fft_pass<avx512_vector>(re, im, n, q, w_re + offset, w_im + offset);
+	}
+	_mm256_zeroupper();
+}
+
+}
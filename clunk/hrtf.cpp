@@ -23,14 +23,19 @@ SOFTWARE.
 */
 
 #include <clunk/hrtf.h>
+#include <clunk/hrtf_bank.h>
+#include <clunk/batch_mdct_context.h>
+#include <clunk/mdct_context.h>
+#include <clunk/window_function.h>
 #include <clunk/buffer.h>
 #include <clunk/clunk_ex.h>
+#include <clunk/profiler.h>
 #include <algorithm>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
-#include "kemar.h"
-
 #if defined _MSC_VER || __APPLE__ || __FreeBSD__
 #	define log2f(x) (logf(x) / M_LN2)
 #endif
@@ -38,11 +43,39 @@ SOFTWARE.
 namespace clunk
 {
 
-clunk_static_assert(Hrtf::WINDOW_BITS > 2);
+clunk_static_assert(Hrtf::MinWindowBits > 2);
+clunk_static_assert(Hrtf::MinWindowBits <= Hrtf::WINDOW_BITS && Hrtf::WINDOW_BITS <= Hrtf::MaxWindowBits);
+clunk_static_assert(Hrtf::MaxWindow / 2 >= HrtfBank::MaxPartition);
+clunk_static_assert(Hrtf::MaxDelay <= Hrtf::MaxWindow / 2);
 
-Hrtf::Hrtf(): overlap_data()
+Hrtf::Hrtf(): pending(), pending_n(0), pending_size(0), overlap_data(), delay_data(), last_input(), bits(WINDOW_BITS), transform(&Hrtf::hrtf_window<WINDOW_BITS>), conv_fdl(), conv_fdl_pos(0), conv_partition(0), conv_partitions(0), generate(NULL), block(WINDOW_SIZE / 2), idt_offset(0), 
+	tier(DistanceModel::FullHrtf), tier_target(DistanceModel::FullHrtf), tier_valid(false), itd_gain(), pan_gain()
 { }
 
+unsigned Hrtf::window_bits(unsigned size) {
+	for(unsigned b = MinWindowBits; b <= MaxWindowBits; ++b) {
+		if (size == 1u << b)
+			return b;
+	}
+	throw_ex(("invalid hrtf window size %u, use power of two from %u to %u", size, (unsigned)MinWindow, (unsigned)MaxWindow));
+}
+
+void Hrtf::set_window(unsigned size) {
+	const unsigned b = window_bits(size);
+	if (b == bits)
+		return;
+	switch(b) {
+	case 7:	transform = &Hrtf::hrtf_window<7>; break;
+	case 8:	transform = &Hrtf::hrtf_window<8>; break;
+	case 9:	transform = &Hrtf::hrtf_window<9>; break;
+	case 10:	transform = &Hrtf::hrtf_window<10>; break;
+	case 11:	transform = &Hrtf::hrtf_window<11>; break;
+	}
+	bits = b;
+	//overlap of the other window size is useless
+	reset();
+}
+
 void Hrtf::idt_iit(const v3f &position, float &idt_offset, float &angle_gr, float &left_to_right_amp) {
 	float head_r = 0.093f;
 
@@ -72,183 +105,496 @@ void Hrtf::idt_iit(const v3f &position, float &idt_offset, float &angle_gr, floa
 	//LOG_DEBUG(("idt_offset %g, left_to_right_amp: %g", idt_offset, left_to_right_amp));
 }
 
-void Hrtf::get_kemar_data(kemar_ptr & kemar_data, int & elev_n, const v3f &pos) {
-	
-	kemar_data = 0;
-	elev_n = 0;
-	if (pos.is0())
-		return;
+void Hrtf::direct(float * const *dst, unsigned dst_ch, unsigned dst_n, const float *src, unsigned src_n, unsigned src_ch, float volume, float volume_step) {
+	//2d stereo sound!
+	if (src_ch != dst_ch)
+		throw_ex(("unsupported sample conversion"));
+
+	for(unsigned c = 0; c < dst_ch; ++c) {
+		float *dst_c = dst[c];
+		const float *src_c = src + c * src_n;
+		for(unsigned i = 0; i < dst_n; ++i)
+			dst_c[i] += (volume + volume_step * i) * src_c[i];
+	}
+}
+
+void Hrtf::begin(const HrtfBank &bank, unsigned sample_rate, const v3f &delta_position) {
+	//LOG_DEBUG(("data: %p, angles: %d", (void *) kemar_data, angles));
+
+	float t_idt, angle_gr, left_to_right_amp;
+	idt_iit(delta_position, t_idt, angle_gr, left_to_right_amp);
 
 #ifdef _WINDOWS
-       float len = (float)_hypot(pos.x, pos.y);
+	float len = (float)_hypot(delta_position.x, delta_position.y);
 #else
-       float len = (float)hypot(pos.x, pos.y);
+	float len = (float)hypot(delta_position.x, delta_position.y);
 #endif
+	const float elevation_gr = 180 * atan2f(delta_position.z, len) / (float)M_PI;
+
+	const unsigned partition = bank.partition();
+	switch(partition) {
+	case 0:	generate = NULL; break;
+	case 64:	generate = &Hrtf::convolve<7>; break;
+	case 128:	generate = &Hrtf::convolve<8>; break;
+	case 256:	generate = &Hrtf::convolve<9>; break;
+	default: 
+		throw_ex(("unsupported partition size %u", partition));
+	}
+	const unsigned partitions = bank.partitions();
+	if (partition != conv_partition || partitions != conv_partitions) {
+		//engine switched, old state is useless
+		reset();
+		conv_partition = partition;
+		conv_partitions = partitions;
+	}
 
-	int elev_gr = (int)(180 * atan2f(pos.z, len) / (float)M_PI);
-	//LOG_DEBUG(("elev = %d (%g %g %g)", elev_gr, pos.x, pos.y, pos.z));
-
-	for(size_t i = 0; i < KemarElevationCount; ++i)
-	{
-		const kemar_elevation_data &elev = ::kemar_data[i];
-		if (elev_gr < elev.elevation + KemarElevationStep / 2)
-		{
-			//LOG_DEBUG(("used elevation %d", elev.elevation)); 
-			kemar_data = elev.data;
-			elev_n = elev.samples;
-			break;
-		}
+	//left ear uses mirrored response of the right one, cheaper tiers do not need filters at all
+	const bool full = tier_target == DistanceModel::FullHrtf || (tier_valid && tier == DistanceModel::FullHrtf);
+	if (full && partition == 0) {
+		bank.get(filter[0], 360 - angle_gr, elevation_gr, 1u << (bits - 1));
+		bank.get(filter[1], angle_gr, elevation_gr, 1u << (bits - 1));
+	} else if (full) {
+		bank.get(conv_filter[0], 360 - angle_gr, elevation_gr);
+		bank.get(conv_filter[1], angle_gr, elevation_gr);
+	}
+	block = partition != 0? partition: 1u << (bits - 1);
+
+	//constant power, both gains are equal to the average hrtf gain in front of the listener
+	const float r2 = left_to_right_amp * left_to_right_amp, gain = bank.gain();
+	itd_gain[1] = gain * sqrtf(2 / (1 + r2));
+	itd_gain[0] = left_to_right_amp * itd_gain[1];
+	const float pan = (sinf(angle_gr * (float)M_PI / 180) + 1) * (float)M_PI_4;
+	pan_gain[0] = gain * (float)M_SQRT2 * cosf(pan);
+	pan_gain[1] = gain * (float)M_SQRT2 * sinf(pan);
+	idt_offset = (int)(t_idt * sample_rate);
+	//LOG_DEBUG(("angle: %g", angle_gr));
+	//LOG_DEBUG(("idt offset %d samples", idt_offset));
+}
+
+unsigned Hrtf::drain(float * const *dst, unsigned done, unsigned dst_n, float volume, float volume_step) {
+	const unsigned n = std::min(pending_n, dst_n - done);
+	const unsigned offset = pending_size - pending_n;
+	for(unsigned c = 0; c < 2; ++c) {
+		const float *src_3d = pending[c] + offset;
+		float *dst_c = dst[c] + done;
+		for(unsigned i = 0; i < n; ++i)
+			dst_c[i] += (volume + volume_step * (done + i)) * src_3d[i];
 	}
+	pending_n -= n;
+	return done + n;
 }
 
 unsigned Hrtf::process(
-	unsigned sample_rate, clunk::Buffer &dst_buf, unsigned dst_ch,
+	const HrtfBank &bank, unsigned sample_rate, float * const *dst, unsigned dst_ch, unsigned dst_n,
 	const clunk::Buffer &src_buf, unsigned src_ch,
-	const v3f &delta_position, float fx_volume)
+	const v3f &delta_position, float volume, float volume_end)
 {
-	s16 * const dst = static_cast<s16*>(dst_buf.get_ptr());
-	const unsigned dst_n = (unsigned)dst_buf.get_size() / dst_ch / 2;
+	const float volume_step = dst_n > 0? (volume_end - volume) / dst_n: 0;
 
-	const s16 * const src = static_cast<const s16 *>(src_buf.get_ptr());
-	const unsigned src_n = (unsigned)src_buf.get_size() / src_ch / 2;
+	const float * const src = static_cast<const float *>(src_buf.get_ptr());
+	const unsigned src_n = (unsigned)(src_buf.get_size() / src_ch / sizeof(float));
 	assert(dst_n <= src_n);
 
-	kemar_ptr kemar_data;
-	int angles;
-	get_kemar_data(kemar_data, angles, delta_position);
+	if (delta_position.is0()) {
+		direct(dst, dst_ch, dst_n, src, src_n, src_ch, volume, volume_step);
+		return dst_n;
+	}
+	assert(dst_ch == 2);
+
+	begin(bank, sample_rate, delta_position);
+	unsigned window = 0;
+	for(unsigned done = drain(dst, 0, dst_n, volume, volume_step); done < dst_n; done = drain(dst, done, dst_n, volume, volume_step)) {
+		size_t src_offset = window * block;
+		assert(src_offset + block <= src_n);
+		next_block(src + src_offset, (int)(src_n - src_offset));
+		pending_n = pending_size = block;
+		++window;
+	}
+	return window * block;
+}
 
-	if (delta_position.is0() || kemar_data == NULL) {
-		//2d stereo sound!
-		if (src_ch == dst_ch) {
-			memcpy(dst_buf.get_ptr(), src_buf.get_ptr(), dst_buf.get_size());
-			return dst_n;
+void Hrtf::process(unsigned lanes, Hrtf * const *hrtf, const HrtfBank &bank, const unsigned *sample_rate, float * const *dst, unsigned dst_ch, unsigned dst_n,
+		const clunk::Buffer * const *src_buf, unsigned src_ch, const v3f *position, const float *volume, const float *volume_end, unsigned *used, unsigned count, float *cost) {
+	switch(lanes) {
+	case 4: process_batch<4>(hrtf, bank, sample_rate, dst, dst_ch, dst_n, src_buf, src_ch, position, volume, volume_end, used, count, cost); break;
+	case 8: process_batch<8>(hrtf, bank, sample_rate, dst, dst_ch, dst_n, src_buf, src_ch, position, volume, volume_end, used, count, cost); break;
+	default: 
+		for(unsigned v = 0; v < count; ++v) {
+			Profiler::clock_type::time_point start;
+			if (cost != NULL)
+				start = Profiler::clock_type::now();
+			used[v] = hrtf[v]->process(bank, sample_rate[v], dst, dst_ch, dst_n, *src_buf[v], src_ch, position[v], volume[v], volume_end[v]);
+			if (cost != NULL)
+				cost[v] = Profiler::elapsed(start);
 		}
-		else
-			throw_ex(("unsupported sample conversion"));
 	}
-	assert(dst_ch == 2);
-	
-	//LOG_DEBUG(("data: %p, angles: %d", (void *) kemar_data, angles));
+}
 
-	float t_idt, angle_gr, left_to_right_amp;
-	idt_iit(delta_position, t_idt, angle_gr, left_to_right_amp);
+template<int LANES>
+void Hrtf::process_batch(Hrtf * const *hrtf, const HrtfBank &bank, const unsigned *sample_rate, float * const *dst, unsigned dst_ch, unsigned dst_n,
+		const clunk::Buffer * const *src_buf, unsigned src_ch, const v3f *position, const float *volume, const float *volume_end, unsigned *used, unsigned count, float *cost) {
+	assert(count <= (unsigned)LANES);
+	Hrtf *batch[LANES];
+	const float *src[LANES];
+	unsigned index[LANES], done[LANES];
+	float batch_volume[LANES], volume_step[LANES];
+	bool batched[LANES];
+	unsigned n = 0;
+	for(unsigned v = 0; v < count; ++v) {
+		Profiler::clock_type::time_point start;
+		if (cost != NULL)
+			start = Profiler::clock_type::now();
+		const Hrtf *h0 = hrtf[v];
+		const bool full = h0->tier_valid && h0->tier == DistanceModel::FullHrtf && h0->tier_target == DistanceModel::FullHrtf;
+		if (bank.partition() != 0 || position[v].is0() || !full) {
+			used[v] = hrtf[v]->process(bank, sample_rate[v], dst, dst_ch, dst_n, *src_buf[v], src_ch, position[v], volume[v], volume_end[v]);
+			if (cost != NULL)
+				cost[v] = Profiler::elapsed(start);
+			continue;
+		}
+		assert(dst_ch == 2);
+		Hrtf *h = hrtf[v];
+		assert(src_buf[v]->get_size() / src_ch / sizeof(float) >= dst_n + h->window_size());
+		h->begin(bank, sample_rate[v], position[v]);
+		batch_volume[n] = volume[v];
+		volume_step[n] = dst_n > 0? (volume_end[v] - volume[v]) / dst_n: 0;
+		done[n] = h->drain(dst, 0, dst_n, volume[v], volume_step[n]);
+		batch[n] = h;
+		batched[n] = false;
+		src[n] = static_cast<const float *>(src_buf[v]->get_ptr());
+		index[n++] = v;
+		//the share of the batched windows is added below
+		if (cost != NULL)
+			cost[v] = Profiler::elapsed(start);
+	}
 
-	const int kemar_sector_size = 360 / angles;
-	const int kemar_idx[2] = {
-		((360 - (int)angle_gr + kemar_sector_size / 2) / kemar_sector_size) % angles,
-		((int)angle_gr + kemar_sector_size / 2) / kemar_sector_size
-	};
-
-	float amp[2] = {
-		left_to_right_amp > 1? 1: 1 / left_to_right_amp,
-		left_to_right_amp > 1? left_to_right_amp: 1
-	};
-	//LOG_DEBUG(("%g (of %d)-> left: %d, right: %d", angle_gr, angles, kemar_idx_left, kemar_idx_right));
-	
-	int idt_offset = (int)(t_idt * sample_rate);
-
-	int window = 0;
-	while(sample3d[0].get_size() < dst_n * 2 || sample3d[1].get_size() < dst_n * 2) {
-		size_t offset = window * WINDOW_SIZE / 2;
-		assert(offset + WINDOW_SIZE / 2 <= src_n);
-		for(unsigned c = 0; c < dst_ch; ++c) {
-			sample3d[c].reserve(WINDOW_SIZE);
-			s16 *dst = static_cast<s16 *>(static_cast<void *>((static_cast<u8 *>(sample3d[c].get_ptr()) + sample3d[c].get_size() - WINDOW_SIZE)));
-			hrtf(c, dst, src + offset * src_ch, src_ch, src_n - offset, idt_offset, kemar_data, kemar_idx[c], amp[c]);
+	//voices are grouped by the window size, the default one is the common case
+	for(unsigned first = 0; first < n; ++first) {
+		if (batched[first])
+			continue;
+		const unsigned group_bits = batch[first]->bits;
+		Hrtf *group[LANES];
+		const float *group_src[LANES];
+		float group_volume[LANES], group_step[LANES], group_cost[LANES];
+		unsigned group_done[LANES], group_index[LANES], m = 0;
+		for(unsigned l = first; l < n; ++l) {
+			if (batched[l] || batch[l]->bits != group_bits)
+				continue;
+			batched[l] = true;
+			group[m] = batch[l];
+			group_src[m] = src[l];
+			group_volume[m] = batch_volume[l];
+			group_step[m] = volume_step[l];
+			group_done[m] = done[l];
+			group_cost[m] = 0;
+			group_index[m++] = index[l];
+		}
+		switch(group_bits) {
+		case 7:	process_windows<7, LANES>(group, dst, dst_n, group_src, group_volume, group_step, group_done, m, cost != NULL? group_cost: NULL); break;
+		case 8:	process_windows<8, LANES>(group, dst, dst_n, group_src, group_volume, group_step, group_done, m, cost != NULL? group_cost: NULL); break;
+		case 9:	process_windows<9, LANES>(group, dst, dst_n, group_src, group_volume, group_step, group_done, m, cost != NULL? group_cost: NULL); break;
+		case 10:	process_windows<10, LANES>(group, dst, dst_n, group_src, group_volume, group_step, group_done, m, cost != NULL? group_cost: NULL); break;
+		case 11:	process_windows<11, LANES>(group, dst, dst_n, group_src, group_volume, group_step, group_done, m, cost != NULL? group_cost: NULL); break;
+		}
+		for(unsigned l = 0; l < m; ++l) {
+			used[group_index[l]] = group_done[l];
+			if (cost != NULL)
+				cost[group_index[l]] += group_cost[l];
 		}
-		++window;
 	}
-	assert(sample3d[0].get_size() >= dst_n * 2 && sample3d[1].get_size() >= dst_n * 2);
-	
-	//LOG_DEBUG(("angle: %g", angle_gr));
-	//LOG_DEBUG(("idt offset %d samples", idt_offset));
-	s16 * src_3d[2] = { static_cast<s16 *>(sample3d[0].get_ptr()), static_cast<s16 *>(sample3d[1].get_ptr()) };
-	
-	//LOG_DEBUG(("size1: %u, %u, needed: %u\n%s", (unsigned)sample3d[0].get_size(), (unsigned)sample3d[1].get_size(), dst_n, sample3d[0].dump().c_str()));
-	
-	for(unsigned i = 0; i < dst_n; ++i) {
-		for(unsigned c = 0; c < dst_ch; ++c) {
-			dst[i * dst_ch + c] = src_3d[c][i];
+}
+
+template<int BITS, int LANES>
+void Hrtf::process_windows(Hrtf * const *hrtf, float * const *dst, unsigned dst_n,
+		const float * const *src, const float *volume, const float *volume_step, unsigned *done, unsigned count, float *cost) {
+	enum { HALF = 1 << (BITS - 1) };
+	Profiler::clock_type::time_point start;
+	if (cost != NULL)
+		start = Profiler::clock_type::now();
+	unsigned windows[LANES], max_windows = 0, total_windows = 0;
+	for(unsigned l = 0; l < count; ++l) {
+		windows[l] = (dst_n - done[l] + HALF - 1) / HALF;
+		max_windows = std::max(max_windows, windows[l]);
+		total_windows += windows[l];
+	}
+
+	for(unsigned w = 0; w < max_windows; ++w) {
+		//lanes which are done already transform silence and keep their state
+		bool active[LANES];
+		for(unsigned l = 0; l < count; ++l)
+			active[l] = w < windows[l];
+		hrtf_batch<BITS, LANES>(hrtf, src, active, w * HALF, count);
+		for(unsigned l = 0; l < count; ++l) {
+			if (!active[l])
+				continue;
+			Hrtf *h = hrtf[l];
+			h->pending_n = h->pending_size = HALF;
+			done[l] = h->drain(dst, done[l], dst_n, volume[l], volume_step[l]);
 		}
 	}
-	skip(dst_n);
-	return window * WINDOW_SIZE / 2;
+	//done becomes number of samples used
+	for(unsigned l = 0; l < count; ++l)
+		done[l] = windows[l] * HALF;
+
+	if (cost != NULL && total_windows > 0) {
+		const float per_window = Profiler::elapsed(start) / total_windows;
+		for(unsigned l = 0; l < count; ++l)
+			cost[l] += per_window * windows[l];
+	}
+}
+
+void Hrtf::next_block(const float *src, int src_n) {
+	if (!tier_valid) {
+		tier = tier_target;
+		tier_valid = true;
+	}
+	if (tier == tier_target) {
+		generate_block(tier, src, src_n);
+		return;
+	}
+
+	//outgoing tier renders the block from the state left by the previous one, incoming tier starts from it again
+	float input[MaxWindow / 2], history[2][MaxDelay];
+	std::copy(last_input, last_input + block, input);
+	for(unsigned c = 0; c < 2; ++c)
+		std::copy(delay_data[c], delay_data[c] + MaxDelay, history[c]);
+
+	float fade[2][MaxWindow / 2];
+	generate_block(tier, src, src_n);
+	for(unsigned c = 0; c < 2; ++c)
+		std::copy(pending[c], pending[c] + block, fade[c]);
+
+	//idt delay history and overlap are rebuilt as if the incoming tier rendered the previous block too
+	std::copy(input, input + block, last_input);
+	for(unsigned c = 0; c < 2; ++c)
+		std::copy(history[c], history[c] + MaxDelay, delay_data[c]);
+	if (tier_target == DistanceModel::FullHrtf) {
+		if (generate != NULL) {
+			//older spectra are lost, last input partition is still valid
+			std::fill(conv_fdl, conv_fdl + HrtfBank::MaxConvolutionBins, std::complex<float>());
+		} else {
+			//overlap from the window made of the last and the current block
+			(this->*transform)(src, true);
+		}
+	} else {
+		const float *gain = tier_target == DistanceModel::ItdIld? itd_gain: pan_gain;
+		float data[MaxWindow / 2];
+		for(unsigned c = 0; c < 2; ++c) {
+			for(unsigned i = 0; i < block; ++i)
+				data[i] = gain[c] * input[i];
+			remember(c, data, block);
+		}
+	}
+	generate_block(tier_target, src, src_n);
+	for(unsigned c = 0; c < 2; ++c) {
+		float *dst = pending[c];
+		for(unsigned i = 0; i < block; ++i) {
+			float t = (i + 0.5f) / block;
+			dst[i] = dst[i] * t + fade[c][i] * (1 - t);
+		}
+	}
+	tier = tier_target;
+}
+
+void Hrtf::generate_block(DistanceModel::Tier block_tier, const float *src, int src_n) {
+	switch(block_tier) {
+	case DistanceModel::FullHrtf: 
+		if (generate != NULL)
+			(this->*generate)(src, conv_partitions);
+		else
+			hrtf(src, src_n);
+		break;
+	case DistanceModel::ItdIld: 
+		pan(src, itd_gain, true);
+		break;
+	case DistanceModel::GainPanning: 
+		pan(src, pan_gain, false);
+		break;
+	}
+}
+
+void Hrtf::pan(const float *src, const float *gain, bool delayed) {
+	float data[MaxWindow / 2];
+	for(unsigned c = 0; c < 2; ++c) {
+		for(unsigned i = 0; i < block; ++i)
+			data[i] = gain[c] * src[i];
+		emit(c, data, block, delayed? delay(c): 0);
+	}
+	//keeps the history for the full hrtf tier
+	std::copy(src, src + block, last_input);
 }
 
 void Hrtf::skip(unsigned samples) {
+	pending_n -= std::min(pending_n, samples);
+}
+
+void Hrtf::reset() {
+	pending_n = 0;
 	for(int i = 0; i < 2; ++i) {
-		Buffer & buf = sample3d[i];
-		buf.pop(samples * 2);
+		std::fill(overlap_data[i], overlap_data[i] + MaxWindow / 2, 0.0f);
+		std::fill(delay_data[i], delay_data[i] + MaxDelay, 0.0f);
 	}
+	std::fill(last_input, last_input + MaxWindow / 2, 0.0f);
+	std::fill(conv_fdl, conv_fdl + HrtfBank::MaxConvolutionBins, std::complex<float>());
+	conv_fdl_pos = 0;
+	tier_valid = false;
 }
 
-void Hrtf::hrtf(const unsigned channel_idx, s16 *dst, const s16 *src, int src_ch, int src_n, int idt_offset, const kemar_ptr& kemar_data, int kemar_idx, float freq_decay) {
-	assert(channel_idx < 2);
+void Hrtf::hrtf(const float *src, int src_n) {
+	assert((int)window_size() <= src_n);
+	(this->*transform)(src, false);
+}
 
-	//LOG_DEBUG(("channel %d: window %d: adding %d, buffer size: %u, decay: %g", channel_idx, window, WINDOW_SIZE, (unsigned)result.get_size(), freq_decay));
+template<int BITS>
+void Hrtf::hrtf_window(const float *src, bool prime) {
+	typedef mdct_context<BITS, vorbis_window_func, float> mdct_type;
+	enum { N = mdct_type::N, M = mdct_type::M };
+	//shared by all the sources rendered by the thread
+	static thread_local mdct_type mdct;
+
+	if (prime) {
+		std::copy(last_input, last_input + N / 2, mdct.data);
+		std::copy(src, src + N / 2, mdct.data + N / 2);
+	} else {
+		std::copy(src, src + N, mdct.data);
+		std::copy(src, src + N / 2, last_input);
+	}
 
-	if (channel_idx <= 1) {
-		bool left = channel_idx == 0;
-		if (!left && idt_offset > 0) {
-			idt_offset = 0;
-		} else if (left && idt_offset < 0) {
-			idt_offset = 0;
-		}
-		if (idt_offset < 0)
-			idt_offset = - idt_offset;
-	} else 
-		idt_offset = 0;
-
-	assert(std::min(0, idt_offset) >= 0);
-	assert(std::max(0, idt_offset) + WINDOW_SIZE <= src_n);
-
-	for(int i = 0; i < WINDOW_SIZE; ++i) {
-		//-1 0 1 2 3
-		int p = idt_offset + i;
-		assert(p >= 0 && p < src_n);
-		//printf("%d of %d, ", p, src_n);
-		int v = src[p * src_ch];
-		_mdct.data[i] = v / 32768.0f;
-		//fprintf(stderr, "%g ", _mdct.data[i]);
-	}
-	
-	_mdct.apply_window();
-	_mdct.mdct();
-	{
-		for(size_t i = 1; i < mdct_type::M; ++i)
-		{
-			const int kemar_sample = i * KemarPoints / mdct_type::M;
-			std::complex<float> fir(kemar_data[kemar_idx][0][kemar_sample][0], kemar_data[kemar_idx][0][kemar_sample][1]);
-			_mdct.data[i] *= std::abs(fir);
-		}
+	mdct.apply_window();
+	mdct.mdct();
+	float spectrum[M];
+	std::copy(mdct.data, mdct.data + M, spectrum);
+
+	for(unsigned c = 0; c < 2; ++c) {
+		const float *filter_c = filter[c];
+		for(size_t i = 0; i < M; ++i)
+			mdct.data[i] = spectrum[i] * filter_c[i];
+
+		mdct.imdct();
+		mdct.apply_window();
+		if (prime) {
+			std::copy(mdct.data + N / 2, mdct.data + N, overlap_data[c]);
+			//end of the first half misses only the tail of the window before the last one, close enough for the idt delay
+			remember(c, mdct.data, N / 2);
+		} else
+			output(c, mdct.data, 1);
 	}
+}
 
-	//LOG_DEBUG(("kemar angle index: %d\n", kemar_idx));
-	assert(freq_decay >= 1);
-	
-	_mdct.imdct();
-	_mdct.apply_window();
-
-	{
-		//stupid msvc
-		int i;
-		for(i = 0; i < WINDOW_SIZE / 2; ++i) {
-			float v = _mdct.data[i] + overlap_data[channel_idx][i];
-			
-			if (v < -1) {
-				LOG_DEBUG(("clipping %f", v));
-				v = -1;
-			} else if (v > 1) {
-				LOG_DEBUG(("clipping %f", v));
-				v = 1;
-			}
-			*dst++ = (int)(v * 32767);
+template<int BITS, int LANES>
+void Hrtf::hrtf_batch(Hrtf * const *hrtf, const float * const *src, const bool *active, unsigned offset, unsigned count) {
+	typedef batch_mdct_context<BITS, LANES, vorbis_window_func, float> batch_mdct_type;
+	enum { N = batch_mdct_type::N, M = batch_mdct_type::M };
+	//shared by all the sources rendered by the thread
+	static thread_local batch_mdct_type mdct;
+	static thread_local typename batch_mdct_type::lanes_type spectrum[M];
+
+	for(int i = 0; i < N; ++i) {
+		for(unsigned l = 0; l < count; ++l)
+			mdct.data[i][l] = active[l]? src[l][offset + i]: 0;
+		for(unsigned l = count; l < (unsigned)LANES; ++l)
+			mdct.data[i][l] = 0;
+	}
+	for(unsigned l = 0; l < count; ++l)
+		if (active[l])
+			std::copy(src[l] + offset, src[l] + offset + N / 2, hrtf[l]->last_input);
+
+	mdct.apply_window();
+	mdct.mdct();
+	memcpy(spectrum, mdct.data, sizeof(spectrum));
+
+	for(unsigned c = 0; c < 2; ++c) {
+		for(size_t i = 0; i < M; ++i) {
+			for(unsigned l = 0; l < count; ++l)
+				mdct.data[i][l] = spectrum[i][l] * hrtf[l]->filter[c][i];
 		}
-		for(; i < WINDOW_SIZE; ++i) {
-			overlap_data[channel_idx][i - WINDOW_SIZE / 2] = _mdct.data[i];
+
+		mdct.imdct();
+		mdct.apply_window();
+		for(unsigned l = 0; l < count; ++l)
+			if (active[l])
+				hrtf[l]->output(c, &mdct.data[0][l], LANES);
+	}
+}
+
+void Hrtf::output(unsigned c, const float *data, unsigned stride) {
+	const unsigned half = 1u << (bits - 1);
+	float v[MaxWindow / 2], *overlap = overlap_data[c];
+	for(unsigned i = 0; i < half; ++i) {
+		v[i] = data[i * stride] + overlap[i];
+		overlap[i] = data[(i + half) * stride];
+	}
+	emit(c, v, half, delay(c));
+}
+
+unsigned Hrtf::delay(unsigned c) const {
+	//ear farther from the source hears it idt_offset samples later
+	const unsigned delayed = idt_offset > 0? 1: 0;
+	return c == delayed? std::min<unsigned>(std::abs(idt_offset), MaxDelay): 0;
+}
+
+void Hrtf::emit(unsigned c, const float *data, unsigned n, unsigned d) {
+	float *dst = pending[c], *history = delay_data[c];
+	d = std::min(d, n);
+	for(unsigned i = 0; i < d; ++i)
+		dst[i] = history[MaxDelay - d + i];
+	for(unsigned i = 0; i + d < n; ++i)
+		dst[i + d] = data[i];
+	remember(c, data, n);
+}
+
+void Hrtf::remember(unsigned c, const float *data, unsigned n) {
+	float *history = delay_data[c];
+	//history keeps last MaxDelay samples
+	if (n < MaxDelay) {
+		std::copy(history + n, history + MaxDelay, history);
+		std::copy(data, data + n, history + MaxDelay - n);
+	} else
+		std::copy(data + n - MaxDelay, data + n, history);
+}
+
+template<int BITS>
+void Hrtf::convolve(const float *src, unsigned partitions) {
+	typedef fft_context<BITS, float> fft_type;
+	enum { N = fft_type::N, B = N / 2, BINS = B + 1 };
+	//twiddles and scratch are shared by all the sources rendered by the thread
+	static thread_local fft_type fft;
+
+	//overlap-save: previous block followed by the new one
+	for(int i = 0; i < B; ++i) {
+		fft.data[i] = last_input[i];
+		last_input[i] = src[i];
+		fft.data[B + i] = last_input[i];
+	}
+	fft.fft();
+
+	//frequency domain delay line, newest spectrum goes first
+	conv_fdl_pos = (conv_fdl_pos + partitions - 1) % partitions;
+	std::copy(fft.data, fft.data + BINS, conv_fdl + conv_fdl_pos * BINS);
+
+	std::complex<float> acc[2][BINS];
+	for(unsigned c = 0; c < 2; ++c) {
+		std::complex<float> *dst = acc[c];
+		std::fill(dst, dst + BINS, std::complex<float>());
+		for(unsigned p = 0; p < partitions; ++p) {
+			const std::complex<float> *x = conv_fdl + ((conv_fdl_pos + p) % partitions) * BINS, *h = conv_filter[c] + p * BINS;
+			for(int k = 0; k < BINS; ++k)
+				dst[k] += x[k] * h[k];
 		}
 	}
+
+	//both ears are real, so they're transformed back at once: left in the real part, right in the imaginary one
+	const std::complex<float> i1(0, 1);
+	for(int k = 0; k < BINS; ++k) {
+		fft.data[k] = acc[0][k] + i1 * acc[1][k];
+		if (k > 0 && k < B)
+			fft.data[N - k] = std::conj(acc[0][k]) + i1 * std::conj(acc[1][k]);
+	}
+	fft.ifft();
+	for(int i = 0; i < B; ++i) {
+		pending[0][i] = fft.data[B + i].real();
+		pending[1][i] = fft.data[B + i].imag();
+	}
 }
 
-	
 }
@@ -26,46 +26,131 @@ SOFTWARE.
 #define	CLUNK_HRTF_H
 
 #include <clunk/buffer.h>
+#include <clunk/distance_model.h>
 #include <clunk/export_clunk.h>
-#include <clunk/mdct_context.h>
+#include <clunk/hrtf_bank.h>
 #include <clunk/types.h>
 #include <clunk/v3.h>
-#include <clunk/window_function.h>
-#include <clunk/kemar.h>
 
 namespace clunk {
 
 class CLUNKAPI Hrtf {
 public: 
-	enum { WINDOW_BITS = 9 };
-
-private: 
-	typedef mdct_context<WINDOW_BITS, vorbis_window_func, float> mdct_type;
-	mdct_type _mdct;
-
-public:
-	enum { WINDOW_SIZE = mdct_type::N };
+	///default window is 512 samples, windows from 128 to 2048 samples trade latency and time resolution for frequency resolution and CPU time
+	enum { WINDOW_BITS = 9, MinWindowBits = 7, MaxWindowBits = 11 };
+	enum { WINDOW_SIZE = 1 << WINDOW_BITS, MinWindow = 1 << MinWindowBits, MaxWindow = 1 << MaxWindowBits };
+	///MdctFilter: KEMAR magnitudes applied to the MDCT of the window, Convolution: full complex responses, latency of one partition
+	enum Engine { MdctFilter, Convolution };
+	///maximum number of voices processed at once
+	enum { MaxBatch = 8 };
+	///maximum idt delay in samples
+	enum { MaxDelay = 256 };
 
 	Hrtf();
 
-	///fills dst_buf with dst_ch (must be 2 for now) of binaural data, returns number of samples used
-	unsigned process(unsigned sample_rate, clunk::Buffer &dst_buf, unsigned dst_ch,
+	///adds dst_n samples of binaural data to dst_ch (must be 2 for now) planar float buffers, volume ramps linearly from volume to volume_end. src_buf holds src_ch planar float channels, 3d sound uses the first one. returns number of samples used
+	unsigned process(const HrtfBank &bank, unsigned sample_rate, float * const *dst, unsigned dst_ch, unsigned dst_n,
 			const clunk::Buffer &src_buf, unsigned src_ch,
-			const v3f &position, float fx_volume);
+			const v3f &position, float volume, float volume_end);
+
+	/*!
+		\brief processes count voices at once: forward and inverse MDCTs of the voices run together in lanes
+		Arrays hold count <= lanes elements, the rest of arguments is the same as in single voice version. 
+		Voices using convolution engine or playing 2d sound are processed one by one.
+		\param[in] lanes 4 or 8, any other value processes all voices one by one
+		\param[out] used number of samples used by each voice
+		\param[out] cost if not NULL, receives seconds spent on each voice. Voices processed one by one are timed on their own, time of the shared transforms is split by the number of windows of each voice.
+	*/
+	static void process(unsigned lanes, Hrtf * const *hrtf, const HrtfBank &bank, const unsigned *sample_rate, float * const *dst, unsigned dst_ch, unsigned dst_n,
+			const clunk::Buffer * const *src_buf, unsigned src_ch, const v3f *position, const float *volume, const float *volume_end, unsigned *used, unsigned count, float *cost = NULL);
+
+	///returns log2 of the window size, throws if size is not a power of two between MinWindow and MaxWindow
+	static unsigned window_bits(unsigned size);
+	///sets MDCT window size of the next blocks, filter state is dropped if it changes
+	void set_window(unsigned size);
+	unsigned window_size() const { return 1u << bits; }
+
+	///sets spatialization tier of the next blocks, tier changes are crossfaded within one block
+	void set_tier(DistanceModel::Tier tier) { tier_target = tier; }
 
 	void skip(unsigned samples);
+	///drops buffered output and overlap, used when source resumes after being silent
+	void reset();
 
 private:
 	static void idt_iit(const v3f &position, float &idt_offset, float &angle_gr, float &left_to_right_amp);
-	typedef const float (*kemar_ptr)[2][KemarPoints][2];
-	void get_kemar_data(kemar_ptr & kemar_data, int & samples, const v3f &delta_position);
 
-	//generate hrtf response for channel idx (0 left), in result.
-	void hrtf(const unsigned channel_idx, s16 *dst, const s16 *src, int src_ch, int src_n, int idt_offset, const kemar_ptr& kemar_data, int kemar_idx, float freq_decay);
+	//mixes 2d sound
+	static void direct(float * const *dst, unsigned dst_ch, unsigned dst_n, const float *src, unsigned src_n, unsigned src_ch, float volume, float volume_step);
+	//computes filters (if full hrtf tier is involved), panning gains, idt and picks the engine for the direction
+	void begin(const HrtfBank &bank, unsigned sample_rate, const v3f &position);
+	//generates next block into pending, crossfading the tiers if target tier has changed
+	void next_block(const float *src, int src_n);
+	void generate_block(DistanceModel::Tier block_tier, const float *src, int src_n);
+	//cheap tiers: per ear gains, optionally followed by idt delay
+	void pan(const float *src, const float *gain, bool delayed);
+	//mixes pending output to dst starting from done, returns new done
+	unsigned drain(float * const *dst, unsigned done, unsigned dst_n, float volume, float volume_step);
+
+	template<int LANES>
+	static void process_batch(Hrtf * const *hrtf, const HrtfBank &bank, const unsigned *sample_rate, float * const *dst, unsigned dst_ch, unsigned dst_n,
+			const clunk::Buffer * const *src_buf, unsigned src_ch, const v3f *position, const float *volume, const float *volume_end, unsigned *used, unsigned count, float *cost);
+
+	//batches voices sharing the window size, BITS is log2 of it. Adds time split by the windows of each voice to cost if it is not NULL
+	template<int BITS, int LANES>
+	static void process_windows(Hrtf * const *hrtf, float * const *dst, unsigned dst_n,
+			const float * const *src, const float *volume, const float *volume_step, unsigned *done, unsigned count, float *cost);
+
+	//generates next window of both ears into pending: one forward transform, filtered per ear
+	void hrtf(const float *src, int src_n);
+	//transforms the window starting at src, prime transforms last input followed by the first half of src and only restores the overlap for the next window
+	template<int BITS>
+	void hrtf_window(const float *src, bool prime);
+	//same for count voices at once, window starts at offset sample of every source. Inactive lanes are neither read nor written.
+	template<int BITS, int LANES>
+	static void hrtf_batch(Hrtf * const *hrtf, const float * const *src, const bool *active, unsigned offset, unsigned count);
+	//overlap-adds inverse transformed window (data[i * stride]) of channel c into pending, idt is applied as a delay of the far ear
+	void output(unsigned c, const float *data, unsigned stride);
+	//idt delay of the channel in samples
+	unsigned delay(unsigned c) const;
+	//writes n samples of channel c delayed by d samples to pending
+	void emit(unsigned c, const float *data, unsigned n, unsigned d);
+	//appends n samples of channel c to the idt delay history
+	void remember(unsigned c, const float *data, unsigned n);
+	//generates next partition of both ears into pending with uniformly partitioned overlap-save convolution, BITS is log2 of the fft size
+	template<int BITS>
+	void convolve(const float *src, unsigned partitions);
 
 private:
-	clunk::Buffer sample3d[2];
-	float overlap_data[2][WINDOW_SIZE / 2];
+	//generated but not yet mixed output, last pending_n samples of the window or the partition
+	float pending[2][MaxWindow / 2];
+	unsigned pending_n, pending_size;
+	float overlap_data[2][MaxWindow / 2];
+	//last MaxDelay samples of the output before idt delay
+	float delay_data[2][MaxDelay];
+	//last input block, convolution history and the source of the MDCT overlap when full hrtf tier comes back
+	float last_input[MaxWindow / 2];
+	//magnitude responses for the current direction
+	float filter[2][MaxWindow / 2];
+	//log2 of the window size and its transform
+	unsigned bits;
+	void (Hrtf::*transform)(const float *src, bool prime);
+
+	//convolution state: spectra of the recent input partitions and interpolated filters for the current direction
+	std::complex<float> conv_fdl[HrtfBank::MaxConvolutionBins];
+	unsigned conv_fdl_pos, conv_partition, conv_partitions;
+	std::complex<float> conv_filter[2][HrtfBank::MaxConvolutionBins];
+
+	//set up by begin(): convolution step or NULL for MDCT, samples generated per step and idt in samples
+	void (Hrtf::*generate)(const float *src, unsigned partitions);
+	unsigned block;
+	int idt_offset;
+
+	//tier of the last block and the requested one, tier_valid is false until the first block
+	DistanceModel::Tier tier, tier_target;
+	bool tier_valid;
+	//per ear gains of ItdIld and GainPanning tiers
+	float itd_gain[2], pan_gain[2];
 };
 
 }
@@ -0,0 +1,318 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/hrtf_bank.h>
+#include <clunk/fft_context.h>
+#include <clunk/clunk_ex.h>
+#include <algorithm>
+#include <memory>
+#include <math.h>
+#include <string.h>
+
+namespace clunk {
+
+namespace {
+	struct float32_codec {
+		typedef float type;
+		static type encode(float v) { return v; }
+		static float decode(type v) { return v; }
+	};
+
+	//magnitudes are positive, smaller than the smallest normal half are flushed to zero
+	struct float16_codec {
+		typedef uint16_t type;
+		static type encode(float v) {
+			if (!(v >= 6.1035156e-05f))
+				return 0;
+			if (v >= 65504.0f)
+				return 0x7bff;
+			uint32_t bits;
+			memcpy(&bits, &v, sizeof(bits));
+			//rebias exponent, round mantissa to the nearest
+			bits = bits - ((127 - 15) << 23) + 0x1000;
+			return (type)std::min<uint32_t>(bits >> 13, 0x7bff);
+		}
+		static float decode(type v) {
+			if (v == 0)
+				return 0;
+			const uint32_t bits = ((uint32_t)v << 13) + ((127 - 15) << 23);
+			float r;
+			memcpy(&r, &bits, sizeof(r));
+			return r;
+		}
+	};
+
+	//decoded log8 levels, built when the library is loaded, so get() reads a plain array
+	struct log8_table {
+		float levels[256];
+		log8_table() {
+			levels[0] = 0;
+			for(int i = 1; i < 256; ++i)
+				levels[i] = powf(10, (i / 2.0f - 90) / 20);
+		}
+	};
+	const log8_table log8_levels;
+
+	//0.5 dB steps from -90 dB, code 0 is silence
+	struct log8_codec {
+		typedef uint8_t type;
+		enum { Levels = 256 };
+		static type encode(float v) {
+			const float code = (20 * log10f(std::max(v, 1e-10f)) + 90) * 2;
+			return (type)std::max(0.0f, std::min(Levels - 1.0f, floorf(code + 0.5f)));
+		}
+		static float decode(type v) { return log8_levels.levels[v]; }
+	};
+}
+
+HrtfBank::HrtfBank(): _elevation_step(1), _bins(0), _points(0), _precision(Float16), _gain(1), _partition(0), _partitions(0) {}
+
+void HrtfBank::init(const std::shared_ptr<const HrtfDataset> &dataset, unsigned sample_rate, unsigned bins, Precision precision) {
+	if (!dataset)
+		throw_ex(("no hrtf dataset"));
+	//points bins of the dataset cover 0..sample_rate / 2
+	const unsigned points = dataset->points();
+	const float dataset_rate = (float)dataset->sample_rate();
+	_dataset = dataset;
+	_elevation_step = dataset->elevation_step();
+	_bins = bins;
+	_points = points;
+	_precision = precision;
+	_rows.clear();
+	for(unsigned i = 0; i < dataset->rows(); ++i) {
+		const HrtfDataset::Row &dr = dataset->row(i);
+		row r = { dr.elevation, dr.azimuths, dr.first };
+		_rows.push_back(r);
+	}
+
+	//dataset point of the bin center frequency
+	const float scale = 1.0f * sample_rate / (2 * bins) * 2 * (points - 1) / dataset_rate;
+	_bin_point.resize(bins);
+	_bin_weight.resize(bins);
+	for(unsigned i = 0; i < bins; ++i) {
+		float p = std::min<float>(i * scale, points - 1);
+		unsigned k = std::min<unsigned>((unsigned)p, points - 2);
+		_bin_point[i] = k;
+		_bin_weight[i] = p - k;
+	}
+
+	//magnitudes are only computed for the points, bins are interpolated in get()
+	const unsigned directions = dataset->directions();
+	std::vector<float> magnitudes((size_t)directions * points);
+	for(size_t r = 0; r < _rows.size(); ++r) {
+		for(unsigned a = 0; a < _rows[r].azimuths; ++a) {
+			const float *response = dataset->get((unsigned)r, a, 0);
+			float *dst = &magnitudes[(size_t)(_rows[r].first + a) * points];
+			for(unsigned k = 0; k < points; ++k)
+				dst[k] = std::abs(std::complex<float>(response[2 * k], response[2 * k + 1]));
+		}
+	}
+
+	double power = 0;
+	for(unsigned d = 0; d < directions; ++d) {
+		const float *m = &magnitudes[(size_t)d * points];
+		power += 1;
+		for(unsigned i = 1; i < bins; ++i) {
+			const unsigned k = _bin_point[i];
+			const float t = _bin_weight[i], v = m[k] * (1 - t) + m[k + 1] * t;
+			power += v * v;
+		}
+	}
+	_gain = directions == 0? 1.0f: (float)sqrt(power / ((double)directions * bins));
+
+	switch(precision) {
+	case Float32: store<float32_codec>(magnitudes); break;
+	case Float16: store<float16_codec>(magnitudes); break;
+	case Log8: store<log8_codec>(magnitudes); break;
+	default: 
+		throw_ex(("invalid hrtf precision %d", (int)precision));
+	}
+}
+
+template<typename Codec>
+void HrtfBank::store(const std::vector<float> &magnitudes) {
+	typedef typename Codec::type type;
+	std::vector<uint8_t>(magnitudes.size() * sizeof(type)).swap(_data);
+	type *dst = reinterpret_cast<type *>(_data.data());
+	for(size_t i = 0; i < magnitudes.size(); ++i)
+		dst[i] = Codec::encode(magnitudes[i]);
+}
+
+size_t HrtfBank::memory() const {
+	return _data.size() + (_bin_point.size() + _bin_weight.size()) * 4 + _spectra.size() * sizeof(std::complex<float>);
+}
+
+template<int BITS>
+static void partition_spectra(std::complex<float> *dst, const float *ir, unsigned taps, unsigned partitions) {
+	typedef fft_context<BITS, float> fft_type;
+	enum { B = fft_type::N / 2 };
+	std::unique_ptr<fft_type> fft(new fft_type);
+	for(unsigned p = 0; p < partitions; ++p) {
+		for(unsigned i = 0; i < B; ++i) {
+			const unsigned t = p * B + i;
+			fft->data[i] = t < taps? ir[t]: 0;
+			fft->data[B + i] = 0;
+		}
+		fft->fft();
+		std::copy(fft->data, fft->data + B + 1, dst + p * (B + 1));
+	}
+}
+
+void HrtfBank::init_convolution(unsigned sample_rate, unsigned partition) {
+	void (*spectra)(std::complex<float> *, const float *, unsigned, unsigned);
+	switch(partition) {
+	case 0: 
+		_partition = _partitions = 0;
+		std::vector<std::complex<float> >().swap(_spectra);
+		return;
+	case 64: spectra = &partition_spectra<7>; break;
+	case 128: spectra = &partition_spectra<8>; break;
+	case 256: spectra = &partition_spectra<9>; break;
+	default: 
+		throw_ex(("invalid partition size %u, use 64, 128 or 256", partition));
+	}
+	if (_rows.empty())
+		throw_ex(("hrtf bank was not initialized"));
+
+	//dataset spectra are rfft of 512 zeros followed by 512 samples of the impulse response
+	typedef fft_context<10, float> response_fft_type;
+	enum { ResponseTaps = response_fft_type::N / 2, ResponsePoints = ResponseTaps + 1 };
+	if (_dataset->points() != ResponsePoints)
+		throw_ex(("convolution needs datasets of %u taps responses, this one has %u", (unsigned)ResponseTaps, _dataset->points() - 1));
+	std::unique_ptr<response_fft_type> fft(new response_fft_type);
+
+	const float step = (float)_dataset->sample_rate() / sample_rate;
+	const unsigned taps = std::min<unsigned>(MaxTaps, (unsigned)ceilf(ResponseTaps / step));
+	_partition = partition;
+	_partitions = (taps + partition - 1) / partition;
+	const unsigned stride = _partitions * (partition + 1);
+	const unsigned directions = _rows.back().first + _rows.back().azimuths;
+	_spectra.resize(directions * stride);
+
+	std::vector<float> ir(taps);
+	for(size_t r = 0; r < _rows.size(); ++r) {
+		for(unsigned a = 0; a < _rows[r].azimuths; ++a) {
+			const float *src = _dataset->get((unsigned)r, a, 0);
+			for(unsigned k = 0; k < ResponsePoints; ++k) {
+				fft->data[k] = std::complex<float>(src[2 * k], src[2 * k + 1]);
+				if (k > 0 && k < ResponsePoints - 1)
+					fft->data[response_fft_type::N - k] = std::conj(fft->data[k]);
+			}
+			fft->ifft();
+
+			//resampled impulse response, gain is kept by the step factor
+			for(unsigned i = 0; i < taps; ++i) {
+				const float p = i * step;
+				const unsigned k = (unsigned)p;
+				const float t = p - k;
+				const float v0 = k < ResponseTaps? fft->data[ResponseTaps + k].real(): 0, v1 = k + 1 < ResponseTaps? fft->data[ResponseTaps + k + 1].real(): 0;
+				ir[i] = (v0 * (1 - t) + v1 * t) * step;
+			}
+			spectra(&_spectra[(_rows[r].first + a) * stride], ir.data(), taps, _partitions);
+		}
+	}
+}
+
+void HrtfBank::add_row(tap *taps, unsigned &n, const row &r, float azimuth, float weight) const {
+	const float a = azimuth * r.azimuths / 360;
+	unsigned a0 = (unsigned)a;
+	const float t = a - a0;
+	a0 %= r.azimuths;
+	const unsigned a1 = (a0 + 1) % r.azimuths;
+	tap t0 = { r.first + a0, weight * (1 - t) }, t1 = { r.first + a1, weight * t };
+	taps[n++] = t0;
+	if (t > 0)
+		taps[n++] = t1;
+}
+
+unsigned HrtfBank::get_taps(tap *taps, float azimuth, float elevation) const {
+	if (_rows.empty())
+		throw_ex(("hrtf bank was not initialized"));
+
+	azimuth = fmodf(azimuth, 360);
+	if (azimuth < 0)
+		azimuth += 360;
+
+	const int last = (int)_rows.size() - 1;
+	float e = (elevation - _rows[0].elevation) / _elevation_step;
+	if (e < 0)
+		e = 0;
+	if (e > last)
+		e = (float)last;
+	const int r0 = std::min((int)e, last), r1 = std::min(r0 + 1, last);
+	const float t = e - r0;
+
+	unsigned n = 0;
+	add_row(taps, n, _rows[r0], azimuth, 1 - t);
+	if (t > 0)
+		add_row(taps, n, _rows[r1], azimuth, t);
+	return n;
+}
+
+void HrtfBank::get(float *dst, float azimuth, float elevation, unsigned bins) const {
+	if (bins == 0 || bins > _bins || _bins % bins != 0)
+		throw_ex(("invalid number of bins %u, bank holds %u", bins, _bins));
+	tap taps[4];
+	const unsigned n = get_taps(taps, azimuth, elevation);
+	switch(_precision) {
+	case Float32: get<float32_codec>(dst, taps, n, bins); break;
+	case Float16: get<float16_codec>(dst, taps, n, bins); break;
+	case Log8: get<log8_codec>(dst, taps, n, bins); break;
+	}
+	dst[0] = 1;
+}
+
+template<typename Codec>
+void HrtfBank::get(float *dst, const tap *taps, unsigned n, unsigned bins) const {
+	typedef typename Codec::type type;
+	//bin i of the smaller window has the frequency of bin i * stride of the largest one
+	const unsigned stride = _bins / bins;
+	const type *data = reinterpret_cast<const type *>(_data.data());
+	std::fill(dst, dst + bins, 0.0f);
+	for(unsigned j = 0; j < n; ++j) {
+		const type *src = data + (size_t)taps[j].direction * _points;
+		const float w = taps[j].weight;
+		for(unsigned i = 1; i < bins; ++i) {
+			const unsigned k = _bin_point[i * stride];
+			const float t = _bin_weight[i * stride];
+			dst[i] += (Codec::decode(src[k]) * (1 - t) + Codec::decode(src[k + 1]) * t) * w;
+		}
+	}
+}
+
+void HrtfBank::get(std::complex<float> *dst, float azimuth, float elevation) const {
+	if (_spectra.empty())
+		throw_ex(("hrtf convolution is off"));
+	tap taps[4];
+	const unsigned n = get_taps(taps, azimuth, elevation);
+	const unsigned stride = _partitions * (_partition + 1);
+	std::fill(dst, dst + stride, std::complex<float>());
+	for(unsigned j = 0; j < n; ++j) {
+		const std::complex<float> *src = &_spectra[taps[j].direction * stride];
+		const float w = taps[j].weight;
+		for(unsigned i = 0; i < stride; ++i)
+			dst[i] += src[i] * w;
+	}
+}
+
+}
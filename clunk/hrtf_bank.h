@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef CLUNK_HRTF_BANK_H__
+#define CLUNK_HRTF_BANK_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/hrtf_dataset.h>
+#include <complex>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace clunk {
+
+/*!
+	\brief HRTF dataset responses prepared for the output sample rate. Built once by Context, shared by all the sources. 
+	Holds magnitudes at the points of the dataset for the default engine and, if the convolution engine is selected, 
+	partitioned spectra of the full complex impulse responses.
+	Response for any direction is bilinearly interpolated between the neighbouring azimuths and elevations, 
+	then linearly between the points at the frequencies of the MDCT bins.
+*/
+class CLUNKAPI HrtfBank {
+public:
+	enum { MaxTaps = 512, MinPartition = 64, MaxPartition = 256 };
+	enum { MaxConvolutionBins = MaxTaps / MinPartition * (MinPartition + 1) };
+	/*!
+		storage of the magnitudes: Float32, Float16 (half of the memory, relative error below 0.05%) 
+		or Log8 (quarter of the memory, 0.5 dB steps from -90 dB up)
+	*/
+	enum Precision { Float32, Float16, Log8 };
+
+	HrtfBank();
+
+	/*!
+		\brief builds magnitude responses
+		\param[in] dataset source responses, bank keeps a reference to it
+		\param[in] sample_rate output sample rate
+		\param[in] bins number of MDCT bins of the largest window (half of its size), smaller windows use every n-th bin
+		\param[in] precision storage of the magnitudes
+	*/
+	void init(const std::shared_ptr<const HrtfDataset> &dataset, unsigned sample_rate, unsigned bins, Precision precision = Float16);
+	unsigned bins() const { return _bins; }
+	Precision precision() const { return _precision; }
+	///returns memory used by the magnitudes and the spectra, bytes
+	size_t memory() const;
+	bool empty() const { return _data.empty(); }
+	const std::shared_ptr<const HrtfDataset> &dataset() const { return _dataset; }
+	///rms of all the magnitudes, cheaper spatialization tiers are scaled by it to match the loudness
+	float gain() const { return _gain; }
+
+	/*!
+		\brief builds partitioned spectra for the uniformly partitioned overlap-save convolution
+		\param[in] sample_rate output sample rate
+		\param[in] partition partition size: 64, 128 or 256. 0 drops the spectra and switches sources back to the MDCT filtering.
+	*/
+	void init_convolution(unsigned sample_rate, unsigned partition);
+	///returns partition size, 0 if convolution is off
+	unsigned partition() const { return _partition; }
+	///returns number of partitions of each impulse response
+	unsigned partitions() const { return _partitions; }
+
+	/*!
+		\brief interpolates magnitude response for the given direction
+		\param[out] dst bins magnitudes
+		\param[in] azimuth degrees, clockwise, 0 is in front of the listener
+		\param[in] elevation degrees
+		\param[in] bins number of MDCT bins of the window, bins() must be a multiple of it
+	*/
+	void get(float *dst, float azimuth, float elevation, unsigned bins) const;
+	/*!
+		\brief interpolates partitioned spectra for the given direction
+		\param[out] dst partitions() * (partition() + 1) bins, non-negative frequencies of every partition
+		\param[in] azimuth degrees, clockwise, 0 is in front of the listener
+		\param[in] elevation degrees
+	*/
+	void get(std::complex<float> *dst, float azimuth, float elevation) const;
+
+private:
+	struct row {
+		int elevation;
+		unsigned azimuths;
+		//index of the first direction of the row
+		unsigned first;
+	};
+	struct tap {
+		unsigned direction;
+		float weight;
+	};
+	//returns up to 4 directions surrounding the given one
+	unsigned get_taps(tap *taps, float azimuth, float elevation) const;
+	//interpolates magnitudes stored by Codec
+	template<typename Codec>
+	void get(float *dst, const tap *taps, unsigned n, unsigned bins) const;
+	template<typename Codec>
+	void store(const std::vector<float> &magnitudes);
+	void add_row(tap *taps, unsigned &n, const row &r, float azimuth, float weight) const;
+
+	std::shared_ptr<const HrtfDataset> _dataset;
+	int _elevation_step;
+	unsigned _bins, _points;
+	Precision _precision;
+	float _gain;
+	std::vector<row> _rows;
+	//[direction][point], encoded as _precision
+	std::vector<uint8_t> _data;
+	//left point and its weight for every bin of the largest window
+	std::vector<unsigned> _bin_point;
+	std::vector<float> _bin_weight;
+
+	unsigned _partition, _partitions;
+	//[direction][partition][bin]
+	std::vector<std::complex<float> > _spectra;
+};
+
+}
+
+#endif
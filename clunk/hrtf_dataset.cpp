@@ -0,0 +1,201 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/hrtf_dataset.h>
+#include <clunk/clunk_ex.h>
+#include <clunk/config.h>
+#include <string.h>
+
+#ifdef _WINDOWS
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#ifdef CLUNK_BUILTIN_HRTF
+#	include "kemar.h"
+#endif
+
+namespace clunk {
+
+static const char Magic[8] = { 'C', 'L', 'U', 'N', 'K', 'H', 'R', 'T' };
+
+HrtfDataset::HrtfDataset(): _sample_rate(0), _points(0), _elevation_step(0), _map(NULL), _map_size(0)
+#ifdef _WINDOWS
+	, _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+{}
+
+HrtfDataset::~HrtfDataset() {
+	unmap();
+}
+
+bool HrtfDataset::has_builtin() {
+#ifdef CLUNK_BUILTIN_HRTF
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::shared_ptr<const HrtfDataset> HrtfDataset::builtin() {
+#ifdef CLUNK_BUILTIN_HRTF
+	//static data, nothing to map
+	static const std::shared_ptr<const HrtfDataset> kemar([]() {
+		std::shared_ptr<HrtfDataset> dataset(new HrtfDataset);
+		//MIT KEMAR set was measured at 44.1kHz
+		dataset->_sample_rate = 44100;
+		dataset->_points = KemarPoints;
+		unsigned directions = 0;
+		for(int i = 0; i < KemarElevationCount; ++i) {
+			const kemar_elevation_data &elev = ::kemar_data[i];
+			Row r = { elev.elevation, elev.samples, directions, 0 };
+			dataset->_rows.push_back(r);
+			dataset->_data.push_back(&elev.data[0][0][0][0]);
+			directions += elev.samples;
+		}
+		dataset->validate("builtin kemar");
+		return dataset;
+	}());
+	return kemar;
+#else
+	throw_ex(("clunk was built without the builtin hrtf dataset, load one with Context::set_hrtf_dataset"));
+#endif
+}
+
+std::shared_ptr<const HrtfDataset> HrtfDataset::load(const std::string &fname) {
+	std::shared_ptr<HrtfDataset> dataset(new HrtfDataset);
+	size_t size;
+	const char *map;
+#ifdef _WINDOWS
+	dataset->_file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (dataset->_file == INVALID_HANDLE_VALUE)
+		throw_ex(("cannot open hrtf dataset %s", fname.c_str()));
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(dataset->_file, &file_size))
+		throw_ex(("cannot get size of hrtf dataset %s", fname.c_str()));
+	size = (size_t)file_size.QuadPart;
+	if (size < sizeof(FileHeader))
+		throw_ex(("hrtf dataset %s is too short", fname.c_str()));
+	dataset->_mapping = CreateFileMappingA(dataset->_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (dataset->_mapping == NULL)
+		throw_ex(("cannot map hrtf dataset %s", fname.c_str()));
+	dataset->_map = MapViewOfFile(dataset->_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (dataset->_map == NULL)
+		throw_ex(("cannot map hrtf dataset %s", fname.c_str()));
+#else
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd == -1)
+		throw_io(("open(%s)", fname.c_str()));
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		throw_io(("fstat(%s)", fname.c_str()));
+	}
+	size = (size_t)st.st_size;
+	if (size < sizeof(FileHeader)) {
+		close(fd);
+		throw_ex(("hrtf dataset %s is too short", fname.c_str()));
+	}
+	void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	//mapping holds its own reference to the file
+	close(fd);
+	if (addr == MAP_FAILED)
+		throw_io(("mmap(%s)", fname.c_str()));
+	dataset->_map = addr;
+#endif
+	dataset->_map_size = size;
+	map = static_cast<const char *>(dataset->_map);
+
+	FileHeader header;
+	memcpy(&header, map, sizeof(header));
+	if (memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+		throw_ex(("%s is not a clunk hrtf dataset", fname.c_str()));
+	if (header.version != Version)
+		throw_ex(("unsupported hrtf dataset version 0x%08x in %s, only little endian version %u is supported", header.version, fname.c_str(), (unsigned)Version));
+	if (header.ears != Ears)
+		throw_ex(("hrtf dataset %s has %u ears", fname.c_str(), header.ears));
+	if (header.sample_rate == 0 || header.points < 2 || header.rows == 0)
+		throw_ex(("hrtf dataset %s is empty", fname.c_str()));
+	if ((size_t)header.rows * sizeof(Row) > size - sizeof(FileHeader))
+		throw_ex(("hrtf dataset %s is truncated", fname.c_str()));
+	if (header.data_offset % sizeof(float) != 0 || header.data_offset < sizeof(FileHeader) + header.rows * sizeof(Row))
+		throw_ex(("invalid data offset %u in hrtf dataset %s", header.data_offset, fname.c_str()));
+	const size_t response = (size_t)Ears * header.points * 2 * sizeof(float);
+	if (header.data_offset > size || (size - header.data_offset) / response < header.directions)
+		throw_ex(("hrtf dataset %s is truncated", fname.c_str()));
+
+	dataset->_sample_rate = header.sample_rate;
+	dataset->_points = header.points;
+	dataset->_rows.resize(header.rows);
+	memcpy(dataset->_rows.data(), map + sizeof(FileHeader), header.rows * sizeof(Row));
+	const float *data = reinterpret_cast<const float *>(map + header.data_offset);
+	for(unsigned r = 0; r < header.rows; ++r) {
+		const Row &row = dataset->_rows[r];
+		if (row.first > header.directions || row.azimuths > header.directions - row.first)
+			throw_ex(("row %u of hrtf dataset %s is out of range", r, fname.c_str()));
+		dataset->_data.push_back(data + (size_t)row.first * Ears * header.points * 2);
+	}
+	dataset->validate(fname);
+	return dataset;
+}
+
+void HrtfDataset::validate(const std::string &name) {
+	unsigned first = 0;
+	for(size_t r = 0; r < _rows.size(); ++r) {
+		const Row &row = _rows[r];
+		if (row.azimuths == 0 || row.first != first)
+			throw_ex(("row %u of hrtf dataset %s is not contiguous", (unsigned)r, name.c_str()));
+		first += row.azimuths;
+	}
+	//directions are interpolated between the rows, elevations must be evenly spaced
+	_elevation_step = _rows.size() > 1? _rows[1].elevation - _rows[0].elevation: 1;
+	for(size_t r = 1; r < _rows.size(); ++r) {
+		if (_elevation_step <= 0 || _rows[r].elevation - _rows[r - 1].elevation != _elevation_step)
+			throw_ex(("elevations of hrtf dataset %s are not evenly spaced", name.c_str()));
+	}
+}
+
+void HrtfDataset::unmap() {
+#ifdef _WINDOWS
+	if (_map != NULL)
+		UnmapViewOfFile(_map);
+	if (_mapping != NULL)
+		CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#else
+	if (_map != NULL)
+		munmap(_map, _map_size);
+#endif
+	_map = NULL;
+	_map_size = 0;
+}
+
+}
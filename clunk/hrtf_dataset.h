@@ -0,0 +1,119 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_HRTF_DATASET_H__
+#define CLUNK_HRTF_DATASET_H__
+
+#include <clunk/export_clunk.h>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace clunk {
+
+/*!
+	\brief head related transfer functions measured on a sphere, source data of HrtfBank.
+	Directions are grouped into rows of the same elevation, rows go from the lowest elevation up with a constant step, 
+	azimuths of a row are evenly spaced clockwise starting in front of the listener.
+	Every response is points() complex bins of the real fft of (points() - 1) zeros followed by (points() - 1) taps of the impulse response.
+
+	Datasets are either compiled into the library (MIT KEMAR, unless it was built without it) or 
+	memory mapped from the binary container written by kemar/import.py, see FileHeader for the layout. 
+	Mapped data is used in place, loading only validates the header and the row table.
+*/
+class CLUNKAPI HrtfDataset {
+public:
+	enum { Version = 1, Ears = 2 };
+
+	///little endian container header, row table follows it, data starts at data_offset
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t sample_rate;
+		uint32_t points;
+		uint32_t ears;
+		uint32_t rows;
+		uint32_t directions;
+		uint32_t data_offset;
+		uint32_t reserved;
+	};
+
+	///row of directions with the same elevation, first is index of its first direction
+	struct Row {
+		int32_t elevation;
+		uint32_t azimuths;
+		uint32_t first;
+		uint32_t reserved;
+	};
+
+	///returns true if MIT KEMAR set is compiled in
+	static bool has_builtin();
+	///returns compiled in MIT KEMAR set, throws if the library was built without it
+	static std::shared_ptr<const HrtfDataset> builtin();
+	///maps binary container, throws if file is missing or malformed
+	static std::shared_ptr<const HrtfDataset> load(const std::string &fname);
+
+	~HrtfDataset();
+
+	///sample rate the responses were measured at
+	unsigned sample_rate() const { return _sample_rate; }
+	///number of complex bins of each response
+	unsigned points() const { return _points; }
+	unsigned rows() const { return (unsigned)_rows.size(); }
+	const Row &row(unsigned r) const { return _rows[r]; }
+	///elevation difference of the neighbouring rows, degrees
+	int elevation_step() const { return _elevation_step; }
+	unsigned directions() const { return _rows.empty()? 0: _rows.back().first + _rows.back().azimuths; }
+
+	///returns points() interleaved real and imaginary parts of the response of the azimuth-th direction of the row, ear 0 is left, 1 is right
+	const float *get(unsigned row, unsigned azimuth, unsigned ear) const { return _data[row] + (azimuth * Ears + ear) * _points * 2; }
+
+private:
+	HrtfDataset();
+	HrtfDataset(const HrtfDataset &);
+	const HrtfDataset& operator=(const HrtfDataset &);
+
+	//checks the rows and computes the elevation step
+	void validate(const std::string &name);
+	void unmap();
+
+	unsigned _sample_rate, _points;
+	int _elevation_step;
+	std::vector<Row> _rows;
+	//first response of every row
+	std::vector<const float *> _data;
+
+	//mapping of the loaded file
+	void *_map;
+	size_t _map_size;
+#ifdef _WINDOWS
+	void *_file, *_mapping;
+#endif
+};
+
+}
+
+#endif
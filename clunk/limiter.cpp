@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/limiter.h>
+#include <math.h>
+
+void clunk::Limiter::process(float * const *data, unsigned channels, unsigned n, int sample_rate, float volume) {
+	if (threshold >= 1) {
+		if (volume != 1) {
+			for(unsigned c = 0; c < channels; ++c) {
+				float *ptr = data[c];
+				for(unsigned i = 0; i < n; ++i)
+					ptr[i] *= volume;
+			}
+		}
+		return;
+	}
+
+	const float knee = 1 - threshold;
+	const float r = release > 0 && sample_rate > 0? expf(-1.0f / (release * sample_rate)): 0;
+
+	float gain = _gain;
+	for(unsigned i = 0; i < n; ++i) {
+		float peak = 0;
+		for(unsigned c = 0; c < channels; ++c) {
+			float v = fabsf(data[c][i]);
+			if (v > peak)
+				peak = v;
+		}
+		peak *= volume;
+
+		//soft knee: everything above threshold is compressed smoothly into [threshold, 1)
+		float target = 1;
+		if (peak > threshold)
+			target = (threshold + knee * tanhf((peak - threshold) / knee)) / peak;
+
+		//instant attack, exponential release
+		if (target < gain)
+			gain = target;
+		else
+			gain = target + (gain - target) * r;
+
+		float k = gain * volume;
+		for(unsigned c = 0; c < channels; ++c)
+			data[c][i] *= k;
+	}
+	_gain = gain;
+}
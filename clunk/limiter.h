@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_LIMITER_H__
+#define CLUNK_LIMITER_H__
+
+#include <clunk/export_clunk.h>
+
+namespace clunk {
+
+//!Soft limiter, the final gain stage of the float mix bus.
+
+struct CLUNKAPI Limiter {
+	//!Level where soft limiting starts, (0 - 1]. 1 disables limiter.
+	float threshold;
+	//!Release time, seconds
+	float release;
+
+	/*!
+		\brief Constructor
+		\param[in] threshold level where soft limiting starts
+		\param[in] release release time in seconds
+	*/
+	Limiter(float threshold = 0.9f, float release = 0.05f): threshold(threshold), release(release), _gain(1) {}
+
+	/*!
+		\brief applies volume and limits planar float data in place. Result never exceeds [-1, 1] range.
+		\param[in] data planar float buffers, one per channel
+		\param[in] channels channels number
+		\param[in] n number of samples in each channel
+		\param[in] sample_rate sample rate, used for the release time
+		\param[in] volume gain applied before limiting
+	*/
+	void process(float * const *data, unsigned channels, unsigned n, int sample_rate, float volume);
+
+	//!Resets release state
+	void reset() { _gain = 1; }
+
+private:
+	float _gain;
+};
+
+}
+
+#endif
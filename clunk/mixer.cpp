@@ -0,0 +1,158 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/mixer.h>
+#include <clunk/mixer_kernel.h>
+#include <clunk/cpu_features.h>
+
+using namespace clunk;
+
+//scalar kernels are the per sample templates, compilers vectorize their full volume loops on their own
+template<int Format>
+static void mix_samples(void *dst, const void *src, size_t n, int volume) {
+	typedef AudioFormat<Format> F;
+	if (volume < 0)
+		impl::Mixer<F, false>::mix(dst, src, n * sizeof(typename F::Type), -volume);
+	else
+		impl::Mixer<F>::mix(dst, src, n * sizeof(typename F::Type), volume);
+}
+
+template<int Format>
+static void adjust_samples(void *dst, size_t n, int volume) {
+	typedef AudioFormat<Format> F;
+	impl::Mixer<F>::adjust(dst, n * sizeof(typename F::Type), volume);
+}
+
+const mixer_kernel_table clunk::mixer_kernels_scalar = {
+	{ &mix_samples<AudioSpec::S8>, &mix_samples<AudioSpec::U8>, &mix_samples<AudioSpec::S16> },
+	{ &adjust_samples<AudioSpec::S8>, &adjust_samples<AudioSpec::U8>, &adjust_samples<AudioSpec::S16> },
+	&impl::FloatMixer<AudioFormat<AudioSpec::S16> >::mix, &impl::FloatMixer<AudioFormat<AudioSpec::S16> >::convert,
+};
+
+#ifdef CLUNK_USES_SIMD
+
+#ifdef CLUNK_MIXER_KERNEL_AVX2
+#	define CLUNK_MIXER_AVX2 &mixer_kernels_avx2
+#else
+#	define CLUNK_MIXER_AVX2 &mixer_kernels_sse
+#endif
+
+//the mixer is bound by memory long before avx-512
+static const mixer_kernel_table * const mixer_kernels[CpuFeatures::Levels] = { &mixer_kernels_scalar, &mixer_kernels_sse, CLUNK_MIXER_AVX2, CLUNK_MIXER_AVX2 };
+
+static const mixer_kernel_table &get_mixer_kernels() {
+	return *mixer_kernels[CpuFeatures::get()];
+}
+
+#elif defined CLUNK_USES_SSE
+
+static const mixer_kernel_table &get_mixer_kernels() {
+	return mixer_kernels_sse;
+}
+
+#else
+
+static const mixer_kernel_table &get_mixer_kernels() {
+	return mixer_kernels_scalar;
+}
+
+#endif
+
+static inline bool has_kernel(AudioSpec::Format format, int volume) {
+	return format != AudioSpec::U16 && volume >= 0 && volume <= MaxMixVolume;
+}
+
+static inline size_t sample_size(AudioSpec::Format format) {
+	return format == AudioSpec::S16 || format == AudioSpec::U16? 2: 1;
+}
+
+void Mixer::mix(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume) {
+	if (has_kernel(format, volume)) {
+		get_mixer_kernels().mix[format](dst, src, size / sample_size(format), volume);
+		return;
+	}
+	switch(format)
+	{
+		case AudioSpec::S8:		impl::Mixer<AudioFormat<AudioSpec::S8> >::mix(dst, src, size, volume); break;
+		case AudioSpec::S16:	impl::Mixer<AudioFormat<AudioSpec::S16> >::mix(dst, src, size, volume); break;
+		case AudioSpec::U8:		impl::Mixer<AudioFormat<AudioSpec::U8> >::mix(dst, src, size, volume); break;
+		case AudioSpec::U16:	impl::Mixer<AudioFormat<AudioSpec::U16> >::mix(dst, src, size, volume); break;
+	}
+}
+
+void Mixer::sub(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume) {
+	if (has_kernel(format, volume)) {
+		get_mixer_kernels().mix[format](dst, src, size / sample_size(format), -volume);
+		return;
+	}
+	switch(format)
+	{
+		case AudioSpec::S8:		impl::Mixer<AudioFormat<AudioSpec::S8>, false>::mix(dst, src, size, volume); break;
+		case AudioSpec::S16:	impl::Mixer<AudioFormat<AudioSpec::S16>, false>::mix(dst, src, size, volume); break;
+		case AudioSpec::U8:		impl::Mixer<AudioFormat<AudioSpec::U8>, false>::mix(dst, src, size, volume); break;
+		case AudioSpec::U16:	impl::Mixer<AudioFormat<AudioSpec::U16>, false>::mix(dst, src, size, volume); break;
+	}
+}
+
+void Mixer::adjust_volume(AudioSpec::Format format, void *dst, size_t size, int volume) {
+	if (has_kernel(format, volume)) {
+		get_mixer_kernels().adjust[format](dst, size / sample_size(format), volume);
+		return;
+	}
+	switch(format)
+	{
+		case AudioSpec::S8:		impl::Mixer<AudioFormat<AudioSpec::S8> >::adjust(dst, size, volume); break;
+		case AudioSpec::S16:	impl::Mixer<AudioFormat<AudioSpec::S16> >::adjust(dst, size, volume); break;
+		case AudioSpec::U8:		impl::Mixer<AudioFormat<AudioSpec::U8> >::adjust(dst, size, volume); break;
+		case AudioSpec::U16:	impl::Mixer<AudioFormat<AudioSpec::U16> >::adjust(dst, size, volume); break;
+	}
+}
+
+void Mixer::mix(AudioSpec::Format format, float * const *dst, unsigned channels, const void *src, size_t n, float volume) {
+	if (format == AudioSpec::S16 && channels <= 2) {
+		get_mixer_kernels().mix_float(dst, channels, src, n, volume);
+		return;
+	}
+	switch(format)
+	{
+		case AudioSpec::S8:		impl::FloatMixer<AudioFormat<AudioSpec::S8> >::mix(dst, channels, src, n, volume); break;
+		case AudioSpec::S16:	impl::FloatMixer<AudioFormat<AudioSpec::S16> >::mix(dst, channels, src, n, volume); break;
+		case AudioSpec::U8:		impl::FloatMixer<AudioFormat<AudioSpec::U8> >::mix(dst, channels, src, n, volume); break;
+		case AudioSpec::U16:	impl::FloatMixer<AudioFormat<AudioSpec::U16> >::mix(dst, channels, src, n, volume); break;
+	}
+}
+
+void Mixer::convert(AudioSpec::Format format, void *dst, const float * const *src, unsigned channels, size_t n) {
+	if (format == AudioSpec::S16 && channels <= 2) {
+		get_mixer_kernels().convert(dst, src, channels, n);
+		return;
+	}
+	switch(format)
+	{
+		case AudioSpec::S8:		impl::FloatMixer<AudioFormat<AudioSpec::S8> >::convert(dst, src, channels, n); break;
+		case AudioSpec::S16:	impl::FloatMixer<AudioFormat<AudioSpec::S16> >::convert(dst, src, channels, n); break;
+		case AudioSpec::U8:		impl::FloatMixer<AudioFormat<AudioSpec::U8> >::convert(dst, src, channels, n); break;
+		case AudioSpec::U16:	impl::FloatMixer<AudioFormat<AudioSpec::U16> >::convert(dst, src, channels, n); break;
+	}
+}
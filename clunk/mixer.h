@@ -32,6 +32,8 @@ namespace clunk {
 
 	static const int MaxMixVolumeShift = 7;
 	static const u8 MaxMixVolume = (1 << MaxMixVolumeShift);
+	///sources quieter than this are not mixed at all
+	static const float MinMixVolume = 0.5f / MaxMixVolume;
 
 	namespace impl {
 
@@ -51,7 +53,7 @@ namespace clunk {
 			}
 
 			inline DoubleType operator()(const Type dst, const Type src) {
-				return dst + src;
+				return Format::clip((int)dst + (int)src);
 			}
 		};
 
@@ -68,7 +70,7 @@ namespace clunk {
 			}
 
 			inline DoubleType operator()(const Type dst, const Type src) {
-				return dst - src;
+				return Format::clip((int)dst - (int)src);
 			}
 		};
 
@@ -108,44 +110,56 @@ namespace clunk {
 				}
 			}
 		};
-	}
 
-	struct Mixer {
-		static void mix(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume = MaxMixVolume)
-		{
-			switch(format)
-			{
-				case AudioSpec::S8:		impl::Mixer<AudioFormat<AudioSpec::S8> >::mix(dst, src, size, volume); break;
-				case AudioSpec::S16:	impl::Mixer<AudioFormat<AudioSpec::S16> >::mix(dst, src, size, volume); break;
-				case AudioSpec::U8:		impl::Mixer<AudioFormat<AudioSpec::U8> >::mix(dst, src, size, volume); break;
-				case AudioSpec::U16:	impl::Mixer<AudioFormat<AudioSpec::U16> >::mix(dst, src, size, volume); break;
+		template<typename Format> struct FloatMixer {
+			typedef typename Format::Type			Type;
+
+			//adds interleaved samples to the planar float bus
+			static void mix(float * const *dst, unsigned channels, const void *src_, size_t n, float volume) {
+				const Type *src = static_cast<const Type *>(src_);
+				volume /= (float)Format::Range + 1;
+				for(size_t i = 0; i < n; ++i) {
+					for(unsigned c = 0; c < channels; ++c) {
+						dst[c][i] += volume * ((int)*src++ - (int)Format::Zero);
+					}
+				}
 			}
-		}
+
+			//converts planar float bus to the interleaved samples, the only place where clipping happens. 
+			//Clamping goes before the integer conversion, which would wrap around on a loud enough bus
+			static void convert(void *dst_, const float * const *src, unsigned channels, size_t n) {
+				Type *dst = static_cast<Type *>(dst_);
+				const float k = (float)Format::Range + 1, lo = (float)Format::Min - (float)Format::Zero, hi = (float)Format::Max - (float)Format::Zero;
+				for(size_t i = 0; i < n; ++i) {
+					for(unsigned c = 0; c < channels; ++c) {
+						float value = src[c][i] * k;
+						value = value > lo? value: lo;
+						value = value < hi? value: hi;
+						*dst++ = (Type)((int)lrintf(value) + (int)Format::Zero);
+					}
+				}
+			}
+		};
+	}
+
+	struct CLUNKAPI Mixer {
+		///adds size bytes of src multiplied by volume / MaxMixVolume to dst, saturates the result, full volume included. S8, U8 and S16 use runtime dispatched simd kernels for volumes 0..MaxMixVolume. Context does not use the integer mixer, it is left for the applications.
+		static void mix(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume = MaxMixVolume);
 
 		static void add(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume = MaxMixVolume)
 		{ mix(format, dst, src, size, volume); }
 
-		static void sub(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume = MaxMixVolume)
-		{
-			switch(format)
-			{
-				case AudioSpec::S8:		impl::Mixer<AudioFormat<AudioSpec::S8>, false>::mix(dst, src, size, volume); break;
-				case AudioSpec::S16:	impl::Mixer<AudioFormat<AudioSpec::S16>, false>::mix(dst, src, size, volume); break;
-				case AudioSpec::U8:		impl::Mixer<AudioFormat<AudioSpec::U8>, false>::mix(dst, src, size, volume); break;
-				case AudioSpec::U16:	impl::Mixer<AudioFormat<AudioSpec::U16>, false>::mix(dst, src, size, volume); break;
-			}
-		}
-
-		static void adjust_volume(AudioSpec::Format format, void *dst, size_t size, int volume)
-		{
-			switch(format)
-			{
-				case AudioSpec::S8:		impl::Mixer<AudioFormat<AudioSpec::S8> >::adjust(dst, size, volume); break;
-				case AudioSpec::S16:	impl::Mixer<AudioFormat<AudioSpec::S16> >::adjust(dst, size, volume); break;
-				case AudioSpec::U8:		impl::Mixer<AudioFormat<AudioSpec::U8> >::adjust(dst, size, volume); break;
-				case AudioSpec::U16:	impl::Mixer<AudioFormat<AudioSpec::U16> >::adjust(dst, size, volume); break;
-			}
-		}
+		///subtracts size bytes of src multiplied by volume / MaxMixVolume from dst, saturates the result
+		static void sub(AudioSpec::Format format, void *dst, const void *src, size_t size, int volume = MaxMixVolume);
+
+		///adds n interleaved frames of the given format to the planar float bus. Context mixes streams with it, S16 with one or two channels uses runtime dispatched simd kernels.
+		static void mix(AudioSpec::Format format, float * const *dst, unsigned channels, const void *src, size_t n, float volume = 1.0f);
+
+		///converts n frames of the planar float bus to the interleaved output format, clipped. Context output goes through it, S16 with one or two channels uses runtime dispatched simd kernels.
+		static void convert(AudioSpec::Format format, void *dst, const float * const *src, unsigned channels, size_t n);
+
+		///multiplies size bytes of dst by volume / MaxMixVolume
+		static void adjust_volume(AudioSpec::Format format, void *dst, size_t size, int volume);
 	};
 }
 
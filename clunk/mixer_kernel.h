@@ -0,0 +1,220 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_MIXER_KERNEL_H__
+#define CLUNK_MIXER_KERNEL_H__
+
+//saturating integer mixer kernels of Mixer. Like the fft kernels every translation unit is compiled with its own instruction set, 
+//so everything here has internal linkage.
+
+#include <clunk/types.h>
+#include <stddef.h>
+#include <math.h>
+#include <limits>
+
+namespace clunk {
+
+/*!
+	Adds n samples of src multiplied by volume / 128 to dst and saturates them, volume is -128..128, negative volumes subtract. 
+	Scaled samples are rounded down like the shift of the scalar mixer, so every kernel gives the same result.
+*/
+typedef void (*mixer_kernel_type)(void *dst, const void *src, size_t n, int volume);
+//multiplies n samples of dst by volume / 128, volume is 0..128
+typedef void (*mixer_adjust_kernel_type)(void *dst, size_t n, int volume);
+//float bus kernels, same as FloatMixer<S16>::mix and convert, which are the scalar ones
+typedef void (*mixer_float_kernel_type)(float * const *dst, unsigned channels, const void *src, size_t n, float volume);
+typedef void (*mixer_convert_kernel_type)(void *dst, const float * const *src, unsigned channels, size_t n);
+
+//kernels indexed by AudioSpec::Format: S8, U8 and S16. U16 has no kernels.
+struct mixer_kernel_table {
+	mixer_kernel_type mix[3];
+	mixer_adjust_kernel_type adjust[3];
+	//S16 with one or two channels, the engine mixes streams into the bus and converts it to the output with them
+	mixer_float_kernel_type mix_float;
+	mixer_convert_kernel_type convert;
+};
+
+extern const mixer_kernel_table mixer_kernels_scalar;
+extern const mixer_kernel_table mixer_kernels_sse;
+extern const mixer_kernel_table mixer_kernels_avx2;
+
+namespace {
+
+template<typename T, int Min, int Max>
+void mixer_mix_block(void *dst_, const void *src_, size_t n, int volume) {
+	T *dst = static_cast<T *>(dst_);
+	const T *src = static_cast<const T *>(src_);
+	for(size_t i = 0; i < n; ++i) {
+		const int value = (int)dst[i] + (((int)src[i] * volume) >> 7);
+		dst[i] = (T)(value < Min? Min: value > Max? Max: value);
+	}
+}
+
+template<typename T>
+void mixer_adjust_block(void *dst_, size_t n, int volume) {
+	T *dst = static_cast<T *>(dst_);
+	for(size_t i = 0; i < n; ++i)
+		dst[i] = (T)(((int)dst[i] * volume) >> 7);
+}
+
+/*
+	V wraps vectors of V::Size bytes: load, store, 16 bit lanes arithmetic, saturating 8 and 16 bit add/sub and 
+	widening of 8 bit samples to 16 bit lanes (Signed extends the sign) with the saturating narrowing back. T is s8 or u8.
+*/
+template<typename V>
+void mixer_mix_s16(void *dst_, const void *src_, size_t n, int volume) {
+	typedef typename V::Type vector;
+	s16 *dst = static_cast<s16 *>(dst_);
+	const s16 *src = static_cast<const s16 *>(src_);
+	const size_t lanes = V::Size / sizeof(s16);
+	const vector v = V::set16(volume);
+	size_t i = 0;
+	for(; i + lanes <= n; i += lanes) {
+		const vector x = V::load(src + i), d = V::load(dst + i);
+		vector y;
+		if (volume == 128)
+			y = V::adds16(d, x);
+		else if (volume == -128)
+			y = V::subs16(d, x);
+		else
+			y = V::adds16(d, V::scale16(x, v));
+		V::store(dst + i, y);
+	}
+	mixer_mix_block<s16, -32768, 32767>(dst + i, src + i, n - i, volume);
+	V::end();
+}
+
+template<typename V, typename T>
+void mixer_mix_8(void *dst_, const void *src_, size_t n, int volume) {
+	typedef typename V::Type vector;
+	static const bool Signed = std::numeric_limits<T>::is_signed;
+	T *dst = static_cast<T *>(dst_);
+	const T *src = static_cast<const T *>(src_);
+	const vector v = V::set16(volume);
+	size_t i = 0;
+	for(; i + V::Size <= n; i += V::Size) {
+		const vector x = V::load(src + i), d = V::load(dst + i);
+		vector y;
+		if (volume == 128)
+			y = V::template adds8<Signed>(d, x);
+		else if (volume == -128)
+			y = V::template subs8<Signed>(d, x);
+		else {
+			//8 bit products fit 16 bit lanes, arithmetic shift rounds them down
+			const vector lo = V::add16(V::template widen_lo<Signed>(d), V::sra7(V::mul16(V::template widen_lo<Signed>(x), v)));
+			const vector hi = V::add16(V::template widen_hi<Signed>(d), V::sra7(V::mul16(V::template widen_hi<Signed>(x), v)));
+			y = V::template narrow<Signed>(lo, hi);
+		}
+		V::store(dst + i, y);
+	}
+	mixer_mix_block<T, Signed? -128: 0, Signed? 127: 255>(dst + i, src + i, n - i, volume);
+	V::end();
+}
+
+template<typename V>
+void mixer_adjust_s16(void *dst_, size_t n, int volume) {
+	typedef typename V::Type vector;
+	s16 *dst = static_cast<s16 *>(dst_);
+	const size_t lanes = V::Size / sizeof(s16);
+	const vector v = V::set16(volume);
+	size_t i = 0;
+	for(; i + lanes <= n; i += lanes)
+		V::store(dst + i, V::scale16(V::load(dst + i), v));
+	mixer_adjust_block<s16>(dst + i, n - i, volume);
+	V::end();
+}
+
+template<typename V, typename T>
+void mixer_adjust_8(void *dst_, size_t n, int volume) {
+	typedef typename V::Type vector;
+	static const bool Signed = std::numeric_limits<T>::is_signed;
+	T *dst = static_cast<T *>(dst_);
+	const vector v = V::set16(volume);
+	size_t i = 0;
+	for(; i + V::Size <= n; i += V::Size) {
+		const vector d = V::load(dst + i);
+		const vector lo = V::sra7(V::mul16(V::template widen_lo<Signed>(d), v));
+		const vector hi = V::sra7(V::mul16(V::template widen_hi<Signed>(d), v));
+		V::store(dst + i, V::template narrow<Signed>(lo, hi));
+	}
+	mixer_adjust_block<T>(dst + i, n - i, volume);
+	V::end();
+}
+
+/*
+	Float bus kernels use V::Floats lanes of V::Float, their 32 bit integer conversions and loads and stores of 
+	mono or interleaved stereo s16 samples as 32 bit lanes.
+*/
+template<typename V>
+void mixer_float_mix_s16(float * const *dst, unsigned channels, const void *src_, size_t n, float volume) {
+	typedef typename V::Type vector;
+	const s16 *src = static_cast<const s16 *>(src_);
+	volume /= 32768.0f;
+	const typename V::Float v = V::setf(volume);
+	size_t i = 0;
+	if (channels == 2) {
+		for(; i + V::Floats <= n; i += V::Floats) {
+			vector l, r;
+			V::load_stereo16(src + 2 * i, l, r);
+			V::storef(dst[0] + i, V::addf(V::loadf(dst[0] + i), V::mulf(v, V::from32(l))));
+			V::storef(dst[1] + i, V::addf(V::loadf(dst[1] + i), V::mulf(v, V::from32(r))));
+		}
+	} else if (channels == 1) {
+		for(; i + V::Floats <= n; i += V::Floats)
+			V::storef(dst[0] + i, V::addf(V::loadf(dst[0] + i), V::mulf(v, V::from32(V::load_mono16(src + i)))));
+	}
+	for(; i < n; ++i)
+		for(unsigned c = 0; c < channels; ++c)
+			dst[c][i] += volume * src[i * channels + c];
+	V::end();
+}
+
+//clamps in float like FloatMixer::convert: maxps and minps return the bound for NaN, so does the scalar comparison
+template<typename V>
+void mixer_convert_s16(void *dst_, const float * const *src, unsigned channels, size_t n) {
+	typedef typename V::Float vector;
+	s16 *dst = static_cast<s16 *>(dst_);
+	const vector k = V::setf(32768.0f), lo = V::setf(-32768.0f), hi = V::setf(32767.0f);
+	size_t i = 0;
+	if (channels == 2) {
+		for(; i + V::Floats <= n; i += V::Floats)
+			V::store_stereo16(dst + 2 * i, V::to32(V::clampf(V::mulf(V::loadf(src[0] + i), k), lo, hi)), V::to32(V::clampf(V::mulf(V::loadf(src[1] + i), k), lo, hi)));
+	} else if (channels == 1) {
+		for(; i + 2 * V::Floats <= n; i += 2 * V::Floats)
+			V::store_mono16(dst + i, V::to32(V::clampf(V::mulf(V::loadf(src[0] + i), k), lo, hi)), V::to32(V::clampf(V::mulf(V::loadf(src[0] + i + V::Floats), k), lo, hi)));
+	}
+	for(; i < n; ++i)
+		for(unsigned c = 0; c < channels; ++c) {
+			float value = src[c][i] * 32768.0f;
+			value = value > -32768.0f? value: -32768.0f;
+			value = value < 32767.0f? value: 32767.0f;
+			dst[i * channels + c] = (s16)lrintf(value);
+		}
+	V::end();
+}
+
+}
+}
+
+#endif
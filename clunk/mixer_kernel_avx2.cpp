@@ -0,0 +1,88 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/mixer_kernel.h>
+#include <immintrin.h>
+
+namespace clunk {
+namespace {
+
+struct avx2_vector {
+	typedef __m256i Type;
+	static const size_t Size = 32;
+
+	static inline Type load(const void *src) { return _mm256_loadu_si256(static_cast<const __m256i *>(src)); }
+	static inline void store(void *dst, Type x) { _mm256_storeu_si256(static_cast<__m256i *>(dst), x); }
+	static inline void end() { _mm256_zeroupper(); }
+
+	static inline Type set16(int x) { return _mm256_set1_epi16((short)x); }
+	static inline Type add16(Type a, Type b) { return _mm256_add_epi16(a, b); }
+	static inline Type mul16(Type a, Type b) { return _mm256_mullo_epi16(a, b); }
+	static inline Type sra7(Type a) { return _mm256_srai_epi16(a, 7); }
+	static inline Type adds16(Type a, Type b) { return _mm256_adds_epi16(a, b); }
+	static inline Type subs16(Type a, Type b) { return _mm256_subs_epi16(a, b); }
+
+	//bits 7..22 of the 32 bit products: x * v >> 7 rounded down, exact while it fits 16 bits
+	static inline Type scale16(Type x, Type v) {
+		return _mm256_or_si256(_mm256_slli_epi16(_mm256_mulhi_epi16(x, v), 9), _mm256_srli_epi16(_mm256_mullo_epi16(x, v), 7));
+	}
+
+	//unpacks and packs work within 128 bit halves, so narrowing restores the order of widened samples
+	template<bool Signed> static inline Type adds8(Type a, Type b) { return Signed? _mm256_adds_epi8(a, b): _mm256_adds_epu8(a, b); }
+	template<bool Signed> static inline Type subs8(Type a, Type b) { return Signed? _mm256_subs_epi8(a, b): _mm256_subs_epu8(a, b); }
+	template<bool Signed> static inline Type widen_lo(Type x) { return Signed? _mm256_srai_epi16(_mm256_unpacklo_epi8(x, x), 8): _mm256_unpacklo_epi8(x, _mm256_setzero_si256()); }
+	template<bool Signed> static inline Type widen_hi(Type x) { return Signed? _mm256_srai_epi16(_mm256_unpackhi_epi8(x, x), 8): _mm256_unpackhi_epi8(x, _mm256_setzero_si256()); }
+	template<bool Signed> static inline Type narrow(Type lo, Type hi) { return Signed? _mm256_packs_epi16(lo, hi): _mm256_packus_epi16(lo, hi); }
+
+	typedef __m256 Float;
+	static const size_t Floats = 8;
+	static inline Float loadf(const float *src) { return _mm256_loadu_ps(src); }
+	static inline void storef(float *dst, Float x) { _mm256_storeu_ps(dst, x); }
+	static inline Float setf(float x) { return _mm256_set1_ps(x); }
+	static inline Float addf(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static inline Float mulf(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static inline Float clampf(Float x, Float lo, Float hi) { return _mm256_min_ps(_mm256_max_ps(x, lo), hi); }
+	static inline Float from32(Type x) { return _mm256_cvtepi32_ps(x); }
+	static inline Type to32(Float x) { return _mm256_cvtps_epi32(x); }
+
+	static inline void load_stereo16(const s16 *src, Type &l, Type &r) {
+		const Type x = load(src);
+		l = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+		r = _mm256_srai_epi32(x, 16);
+	}
+	static inline Type load_mono16(const s16 *src) { return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src))); }
+	//interleaved pairs of both halves are packed in order, mono pack needs its quarters restored
+	static inline void store_stereo16(s16 *dst, Type l, Type r) { store(dst, _mm256_packs_epi32(_mm256_unpacklo_epi32(l, r), _mm256_unpackhi_epi32(l, r))); }
+	static inline void store_mono16(s16 *dst, Type a, Type b) { store(dst, _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8)); }
+};
+
+}
+
+const mixer_kernel_table mixer_kernels_avx2 = {
+	{ &mixer_mix_8<avx2_vector, s8>, &mixer_mix_8<avx2_vector, u8>, &mixer_mix_s16<avx2_vector> },
+	{ &mixer_adjust_8<avx2_vector, s8>, &mixer_adjust_8<avx2_vector, u8>, &mixer_adjust_s16<avx2_vector> },
+	&mixer_float_mix_s16<avx2_vector>, &mixer_convert_s16<avx2_vector>,
+};
+
+}
@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/mixer_kernel.h>
+#include <emmintrin.h>
+
+namespace clunk {
+namespace {
+
+struct sse_vector {
+	typedef __m128i Type;
+	static const size_t Size = 16;
+
+	static inline Type load(const void *src) { return _mm_loadu_si128(static_cast<const __m128i *>(src)); }
+	static inline void store(void *dst, Type x) { _mm_storeu_si128(static_cast<__m128i *>(dst), x); }
+	static inline void end() {}
+
+	static inline Type set16(int x) { return _mm_set1_epi16((short)x); }
+	static inline Type add16(Type a, Type b) { return _mm_add_epi16(a, b); }
+	static inline Type mul16(Type a, Type b) { return _mm_mullo_epi16(a, b); }
+	static inline Type sra7(Type a) { return _mm_srai_epi16(a, 7); }
+	static inline Type adds16(Type a, Type b) { return _mm_adds_epi16(a, b); }
+	static inline Type subs16(Type a, Type b) { return _mm_subs_epi16(a, b); }
+
+	//bits 7..22 of the 32 bit products: x * v >> 7 rounded down, exact while it fits 16 bits
+	static inline Type scale16(Type x, Type v) {
+		return _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(x, v), 9), _mm_srli_epi16(_mm_mullo_epi16(x, v), 7));
+	}
+
+	template<bool Signed> static inline Type adds8(Type a, Type b) { return Signed? _mm_adds_epi8(a, b): _mm_adds_epu8(a, b); }
+	template<bool Signed> static inline Type subs8(Type a, Type b) { return Signed? _mm_subs_epi8(a, b): _mm_subs_epu8(a, b); }
+	template<bool Signed> static inline Type widen_lo(Type x) { return Signed? _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8): _mm_unpacklo_epi8(x, _mm_setzero_si128()); }
+	template<bool Signed> static inline Type widen_hi(Type x) { return Signed? _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8): _mm_unpackhi_epi8(x, _mm_setzero_si128()); }
+	template<bool Signed> static inline Type narrow(Type lo, Type hi) { return Signed? _mm_packs_epi16(lo, hi): _mm_packus_epi16(lo, hi); }
+
+	typedef __m128 Float;
+	static const size_t Floats = 4;
+	static inline Float loadf(const float *src) { return _mm_loadu_ps(src); }
+	static inline void storef(float *dst, Float x) { _mm_storeu_ps(dst, x); }
+	static inline Float setf(float x) { return _mm_set1_ps(x); }
+	static inline Float addf(Float a, Float b) { return _mm_add_ps(a, b); }
+	static inline Float mulf(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static inline Float clampf(Float x, Float lo, Float hi) { return _mm_min_ps(_mm_max_ps(x, lo), hi); }
+	static inline Float from32(Type x) { return _mm_cvtepi32_ps(x); }
+	static inline Type to32(Float x) { return _mm_cvtps_epi32(x); }
+
+	static inline void load_stereo16(const s16 *src, Type &l, Type &r) {
+		const Type x = load(src);
+		l = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+		r = _mm_srai_epi32(x, 16);
+	}
+	static inline Type load_mono16(const s16 *src) {
+		const Type x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+		return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+	}
+	static inline void store_stereo16(s16 *dst, Type l, Type r) { store(dst, _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r))); }
+	static inline void store_mono16(s16 *dst, Type a, Type b) { store(dst, _mm_packs_epi32(a, b)); }
+};
+
+}
+
+const mixer_kernel_table mixer_kernels_sse = {
+	{ &mixer_mix_8<sse_vector, s8>, &mixer_mix_8<sse_vector, u8>, &mixer_mix_s16<sse_vector> },
+	{ &mixer_adjust_8<sse_vector, s8>, &mixer_adjust_8<sse_vector, u8>, &mixer_adjust_s16<sse_vector> },
+	&mixer_float_mix_s16<sse_vector>, &mixer_convert_s16<sse_vector>,
+};
+
+}
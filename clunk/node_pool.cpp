@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/node_pool.h>
+
+using namespace clunk;
+
+NodePool::NodePool(): _free(NULL), _available(0), _pending(0) {}
+
+NodePool::~NodePool() {
+	Node *node = _free.load();
+	while(node != NULL) {
+		Node *next = node->next;
+		::operator delete(node);
+		node = next;
+	}
+}
+
+void NodePool::reserve() {
+	const size_t pending = _pending.fetch_add(1) + 1;
+	//concurrent reservations could add a node or two more than needed, they stay in the pool
+	if (_available.load() < pending)
+		deallocate(::operator new(NodeSize));
+}
+
+void *NodePool::allocate() {
+	//insertions done without reservation (or after the command was dropped) must not take it from the others
+	size_t pending = _pending.load(std::memory_order_relaxed);
+	while(pending > 0 && !_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_relaxed)) {}
+
+	Node *node = _free.load(std::memory_order_acquire);
+	while(node != NULL && !_free.compare_exchange_weak(node, node->next, std::memory_order_acquire, std::memory_order_acquire)) {}
+	if (node == NULL)
+		return ::operator new(NodeSize);
+	_available.fetch_sub(1, std::memory_order_relaxed);
+	return node;
+}
+
+void NodePool::deallocate(void *p) {
+	Node *node = static_cast<Node *>(p);
+	node->next = _free.load(std::memory_order_relaxed);
+	while(!_free.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+	_available.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,100 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_NODE_POOL_H__
+#define CLUNK_NODE_POOL_H__
+
+#include <clunk/export_clunk.h>
+#include <atomic>
+#include <new>
+#include <stddef.h>
+
+namespace clunk {
+
+/*!
+	\brief Free list of the fixed size nodes of the containers changed by the audio thread.
+	Any thread could reserve nodes for the insertions it queues, allocations and deallocations are serialized by the audio lock 
+	(audio thread or setters applied in place), so the list is popped by one thread at a time and is free of ABA.
+	Nodes are added only while the free ones do not cover the pending reservations, erased nodes come back to the list, 
+	so the pool stays as large as the peak number of the nodes in use.
+*/
+class CLUNKAPI NodePool {
+public:
+	///largest node served from the pool
+	enum { NodeSize = 64 };
+
+	NodePool();
+	///frees nodes returned to the pool, nodes still held by the containers must be released before
+	~NodePool();
+
+	///any thread: reserves node for one queued insertion, adds a new one to the pool if free nodes are short
+	void reserve();
+	///audio lock: returns free node and takes one reservation, allocates the node if the pool is empty
+	void *allocate();
+	///audio lock: returns node to the pool
+	void deallocate(void *node);
+
+private:
+	NodePool(const NodePool &);
+	const NodePool& operator=(const NodePool &);
+
+	struct Node { Node *next; };
+
+	std::atomic<Node *> _free;
+	//nodes in the free list and reservations not taken by allocate() yet
+	std::atomic<size_t> _available, _pending;
+};
+
+//!std allocator of the single nodes taken from NodePool, larger requests go to the heap
+template<typename T>
+struct PoolAllocator {
+	typedef T value_type;
+	NodePool *pool;
+
+	PoolAllocator(NodePool *pool): pool(pool) {}
+	template<typename U>
+	PoolAllocator(const PoolAllocator<U> &other): pool(other.pool) {}
+
+	T *allocate(size_t n) {
+		if (n == 1 && sizeof(T) <= NodePool::NodeSize)
+			return static_cast<T *>(pool->allocate());
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, size_t n) {
+		if (n == 1 && sizeof(T) <= NodePool::NodeSize)
+			pool->deallocate(p);
+		else
+			::operator delete(p);
+	}
+
+	template<typename U>
+	bool operator==(const PoolAllocator<U> &other) const { return pool == other.pool; }
+	template<typename U>
+	bool operator!=(const PoolAllocator<U> &other) const { return pool != other.pool; }
+};
+
+}
+
+#endif
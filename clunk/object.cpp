@@ -27,141 +27,224 @@ SOFTWARE.
 #include <clunk/context.h>
 #include <clunk/locker.h>
 #include <clunk/source.h>
+#include <clunk/clunk_ex.h>
 #include <stdexcept>
+#include <algorithm>
 
 using namespace clunk;
 
-Object::Object(Context *context) : context(context), dead(false) {}
+Object::Object(Context *context) : context(context), 
+	named_sources(std::less<int>(), PoolAllocator<NamedSources::value_type>(&context->source_nodes)), 
+	indexed_sources(std::less<int>(), PoolAllocator<IndexedSources::value_type>(&context->source_nodes)), 
+	dead(false), _clock(context->_clock), _cell(0), _cell_prev(NULL), _cell_next(NULL) {}
+
+template<class Sources>
+static void _sync(Sources &sources, u64 delta) {
+	for(typename Sources::iterator i = sources.begin(); i != sources.end(); ) {
+		Source *s = i->second;
+		for(u64 left = delta; left > 0 && s->playing(); ) {
+			int dp = (int)std::min<u64>(left, 0x40000000);
+			s->_update_position(dp);
+			left -= dp;
+		}
+		if (!s->playing()) {
+			delete s;
+			sources.erase(i++);
+		} else 
+			++i;
+	}
+}
+
+void Object::sync() {
+	u64 delta = context->_clock - _clock;
+	if (delta == 0)
+		return;
+	_clock = context->_clock;
+	_sync(named_sources, delta);
+	_sync(indexed_sources, delta);
+}
 
 void Object::update(const v3f &pos, const v3f &vel) {
-	AudioLocker l;
-	_position = pos;
-	_velocity = vel;
+	Command cmd(Command::Update, this);
+	cmd.position = pos;
+	cmd.velocity = vel;
+	context->submit(cmd);
 }
 
 void Object::set_position(const v3f &pos) {
-	AudioLocker l;
-	_position = pos;
+	Command cmd(Command::SetPosition, this);
+	cmd.position = pos;
+	context->submit(cmd);
 }
 
 void Object::set_velocity(const v3f &vel) {
-	AudioLocker l;
-	_velocity = vel;
+	Command cmd(Command::SetVelocity, this);
+	cmd.velocity = vel;
+	context->submit(cmd);
 }
 
 void Object::play(const std::string &name, Source *source) {
-	AudioLocker l;
-	named_sources.insert(NamedSources::value_type(name, source));
+	Command cmd(Command::PlayNamed, this);
+	cmd.index = context->source_name(name, true);
+	cmd.source = source;
+	context->source_nodes.reserve();
+	context->submit(cmd);
 }
 
 void Object::play(int index, Source *source) {
-	AudioLocker l;
-	indexed_sources.insert(IndexedSources::value_type(index, source));
+	Command cmd(Command::PlayIndexed, this);
+	cmd.index = index;
+	cmd.source = source;
+	context->source_nodes.reserve();
+	context->submit(cmd);
 }
 
 bool Object::playing(const std::string &name) const {
+	const int id = context->source_name(name, false);
+	if (id < 0)
+		return false;
 	AudioLocker l;
-	return named_sources.find(name) != named_sources.end();
+	context->flush();
+	const_cast<Object *>(this)->sync();
+	return named_sources.find(id) != named_sources.end();
 }
 
 bool Object::playing(int index) const {
 	AudioLocker l;
+	context->flush();
+	const_cast<Object *>(this)->sync();
 	return indexed_sources.find(index) != indexed_sources.end();
 }
 
 void Object::fade_out(const std::string &name, float fadeout) {
-	AudioLocker l;
-	NamedSources::iterator b = named_sources.lower_bound(name);
-	NamedSources::iterator e = named_sources.upper_bound(name);
-	for(NamedSources::iterator i = b; i != e; ++i) {
-		i->second->fade_out(fadeout);
-	}
+	//name which was never played could not match any source
+	const int id = context->source_name(name, false);
+	if (id < 0)
+		return;
+	Command cmd(Command::FadeOutNamed, this);
+	cmd.index = id;
+	cmd.value = fadeout;
+	context->submit(cmd);
 }
 
 void Object::fade_out(int index, float fadeout) {
-	AudioLocker l;
-	IndexedSources::iterator b = indexed_sources.lower_bound(index);
-	IndexedSources::iterator e = indexed_sources.upper_bound(index);
-	for(IndexedSources::iterator i = b; i != e; ++i) {
-		i->second->fade_out(fadeout);
-	}
+	Command cmd(Command::FadeOutIndexed, this);
+	cmd.index = index;
+	cmd.value = fadeout;
+	context->submit(cmd);
 }
 
 void Object::cancel(const std::string &name, float fadeout) {
-	AudioLocker l;
-	NamedSources::iterator b = named_sources.lower_bound(name);
-	NamedSources::iterator e = named_sources.upper_bound(name);
-	for(NamedSources::iterator i = b; i != e; ) {
-		if (fadeout == 0) {
-			//quickly destroy source
-			delete i->second;
-			named_sources.erase(i++);
-			continue;
-		} else if (i->second->loop)
-			i->second->fade_out(fadeout);
-		++i;
-	}
+	//name which was never played could not match any source
+	const int id = context->source_name(name, false);
+	if (id < 0)
+		return;
+	Command cmd(Command::CancelNamed, this);
+	cmd.index = id;
+	cmd.value = fadeout;
+	context->submit(cmd);
 }
 
 void Object::cancel(int index, float fadeout) {
-	AudioLocker l;
-	IndexedSources::iterator b = indexed_sources.lower_bound(index);
-	IndexedSources::iterator e = indexed_sources.upper_bound(index);
-	for(IndexedSources::iterator i = b; i != e; ) {
-		if (fadeout == 0) {
-			//quickly destroy source
-			delete i->second;
-			indexed_sources.erase(i++);
-			continue;
-		} else if (i->second->loop)
-			i->second->fade_out(fadeout);
-		++i;
-	}
+	Command cmd(Command::CancelIndexed, this);
+	cmd.index = index;
+	cmd.value = fadeout;
+	context->submit(cmd);
 }
 
-bool Object::get_loop(const std::string &name) {
-	AudioLocker l;
-	NamedSources::iterator b = named_sources.lower_bound(name);
-	NamedSources::iterator e = named_sources.upper_bound(name);
-	for(NamedSources::iterator i = b; i != e; ++i) {
+template<class Sources>
+static bool _get_loop(Sources &sources, const typename Sources::key_type &key) {
+	typename Sources::iterator b = sources.lower_bound(key);
+	typename Sources::iterator e = sources.upper_bound(key);
+	for(typename Sources::iterator i = b; i != e; ++i) {
 		if (i->second->loop)
 			return true;
 	}
 	return false;
 }
 
-bool Object::get_loop(int index) {
+bool Object::get_loop(const std::string &name) {
+	const int id = context->source_name(name, false);
+	if (id < 0)
+		return false;
 	AudioLocker l;
-	IndexedSources::iterator b = indexed_sources.lower_bound(index);
-	IndexedSources::iterator e = indexed_sources.upper_bound(index);
-	for(IndexedSources::iterator i = b; i != e; ++i) {
-		if (i->second->loop)
-			return true;
-	}
-	return false;
+	context->flush();
+	sync();
+	return _get_loop(named_sources, id);
 }
 
+bool Object::get_loop(int index) {
+	AudioLocker l;
+	context->flush();
+	sync();
+	return _get_loop(indexed_sources, index);
+}
 
 void Object::set_loop(const std::string &name, const bool loop) {
-	AudioLocker l;
-	NamedSources::iterator b = named_sources.lower_bound(name);
-	NamedSources::iterator e = named_sources.upper_bound(name);
-	for(NamedSources::iterator i = b; i != e; ++i) {
-		i->second->loop = i == b? loop: false; //set loop only for the first. disable others. 
-	}
+	//name which was never played could not match any source
+	const int id = context->source_name(name, false);
+	if (id < 0)
+		return;
+	Command cmd(Command::SetLoopNamed, this);
+	cmd.index = id;
+	cmd.flag = loop;
+	context->submit(cmd);
 }
 
 void Object::set_loop(int index, const bool loop) {
-	AudioLocker l;
-	IndexedSources::iterator b = indexed_sources.lower_bound(index);
-	IndexedSources::iterator e = indexed_sources.upper_bound(index);
-	for(IndexedSources::iterator i = b; i != e; ++i) {
+	Command cmd(Command::SetLoopIndexed, this);
+	cmd.index = index;
+	cmd.flag = loop;
+	context->submit(cmd);
+}
+
+void Object::cancel_all(bool force, float fadeout) {
+	Command cmd(Command::CancelAll, this);
+	cmd.flag = force;
+	cmd.value = fadeout;
+	context->submit(cmd);
+}
+
+void Object::autodelete() {
+	context->submit(Command(Command::Autodelete, this));
+}
+
+template<class Sources>
+static void _fade_out(Sources &sources, const typename Sources::key_type &key, float fadeout) {
+	typename Sources::iterator b = sources.lower_bound(key);
+	typename Sources::iterator e = sources.upper_bound(key);
+	for(typename Sources::iterator i = b; i != e; ++i) {
+		i->second->fade_out(fadeout);
+	}
+}
+
+template<class Sources>
+static void _cancel(Sources &sources, const typename Sources::key_type &key, float fadeout) {
+	typename Sources::iterator b = sources.lower_bound(key);
+	typename Sources::iterator e = sources.upper_bound(key);
+	for(typename Sources::iterator i = b; i != e; ) {
+		if (fadeout == 0) {
+			//quickly destroy source
+			delete i->second;
+			sources.erase(i++);
+			continue;
+		} else if (i->second->loop)
+			i->second->fade_out(fadeout);
+		++i;
+	}
+}
+
+template<class Sources>
+static void _set_loop(Sources &sources, const typename Sources::key_type &key, const bool loop) {
+	typename Sources::iterator b = sources.lower_bound(key);
+	typename Sources::iterator e = sources.upper_bound(key);
+	for(typename Sources::iterator i = b; i != e; ++i) {
 		i->second->loop = i == b? loop: false; //set loop only for the first. disable others. 
 	}
 }
 
 template<class Sources>
-void _cancel_all(Sources &sources, bool force, float fadeout) {
+static void _cancel_all(Sources &sources, bool force, float fadeout) {
 	for(typename Sources::iterator i = sources.begin(); i != sources.end(); ++i) {
 		if (force) {
 			delete i->second;
@@ -175,31 +258,79 @@ void _cancel_all(Sources &sources, bool force, float fadeout) {
 	}
 }
 
-void Object::cancel_all(bool force, float fadeout) {
-	AudioLocker l;
-	_cancel_all(indexed_sources, force, fadeout);
-	_cancel_all(named_sources, force, fadeout);
+void Object::execute(const Command &cmd) {
+	sync();
+	switch(cmd.type) {
+	case Command::Update: 
+		_position = cmd.position;
+		_velocity = cmd.velocity;
+		context->_index.update(this);
+		break;
+	case Command::SetPosition: 
+		_position = cmd.position;
+		context->_index.update(this);
+		break;
+	case Command::SetVelocity: 
+		_velocity = cmd.velocity;
+		break;
+	case Command::PlayNamed: 
+		context->add_source(cmd.source);
+		named_sources.insert(NamedSources::value_type(cmd.index, cmd.source));
+		break;
+	case Command::PlayIndexed: 
+		context->add_source(cmd.source);
+		indexed_sources.insert(IndexedSources::value_type(cmd.index, cmd.source));
+		break;
+	case Command::CancelNamed: 
+		_cancel(named_sources, cmd.index, cmd.value);
+		break;
+	case Command::CancelIndexed: 
+		_cancel(indexed_sources, cmd.index, cmd.value);
+		break;
+	case Command::CancelAll: 
+		_cancel_all(indexed_sources, cmd.flag, cmd.value);
+		_cancel_all(named_sources, cmd.flag, cmd.value);
+		break;
+	case Command::FadeOutNamed: 
+		_fade_out(named_sources, cmd.index, cmd.value);
+		break;
+	case Command::FadeOutIndexed: 
+		_fade_out(indexed_sources, cmd.index, cmd.value);
+		break;
+	case Command::SetLoopNamed: 
+		_set_loop(named_sources, cmd.index, cmd.flag);
+		break;
+	case Command::SetLoopIndexed: 
+		_set_loop(indexed_sources, cmd.index, cmd.flag);
+		break;
+	case Command::Autodelete: 
+		_cancel_all(indexed_sources, false, 0.1f);
+		_cancel_all(named_sources, false, 0.1f);
+		dead = true;
+		break;
+	default: 
+		throw_ex(("invalid object command %d", (int)cmd.type));
+	}
 }
 
 Object::~Object() {
 	if (dead)
 		return;
 	AudioLocker l;
-	cancel_all();
+	context->flush();
+	sync();
+	_cancel_all(indexed_sources, false, 0.1f);
+	_cancel_all(named_sources, false, 0.1f);
 	context->delete_object(this);
 }
 
 bool Object::active() const {
 	AudioLocker l;
+	context->flush();
+	const_cast<Object *>(this)->sync();
 	return !indexed_sources.empty() || !named_sources.empty();
 }
 
-void Object::autodelete() {
-	AudioLocker l;
-	cancel_all();
-	dead = true;
-}
-
 ListenerObject::ListenerObject(Context *context):
 	Object(context) {
 	update_view(v3f(0, 1, 0), v3f(0, 0, 1));
@@ -28,11 +28,14 @@ SOFTWARE.
 #include <string>
 #include <map>
 #include <clunk/export_clunk.h>
+#include <clunk/types.h>
 #include <clunk/v3.h>
+#include <clunk/node_pool.h>
 
 namespace clunk {
 class Context;
 class Source;
+struct Command;
 
 /*! 
 	\brief Object containing sources.
@@ -172,6 +175,7 @@ public:
 
 protected:
 	friend class Context;
+	friend class SpatialIndex;
 
 	Context *context;
 	v3f _position, _velocity;
@@ -179,12 +183,23 @@ protected:
 	Object(Context *context);
 
 private:
-	typedef std::multimap<const std::string, Source *> NamedSources;
+	//names are interned by the context, nodes are taken from its pool, so audio thread does not allocate when sources are played
+	typedef std::multimap<const int, Source *, std::less<int>, PoolAllocator<std::pair<const int, Source *> > > NamedSources;
 	NamedSources named_sources;
-	typedef std::multimap<const int, Source *> IndexedSources;
+	typedef NamedSources IndexedSources;
 	IndexedSources indexed_sources;
 	
 	bool dead;
+
+	//sources of the objects not selected for mixing are advanced lazily, _clock is the context time they were updated for.
+	u64 _clock;
+	//spatial index cell and the neighbours linked in it
+	u64 _cell;
+	Object *_cell_prev, *_cell_next;
+	//advances sources to the current context time, purging finished ones
+	void sync();
+	//applies deferred setter, called by the context with audio lock held
+	void execute(const Command &cmd);
 };
 
 class CLUNKAPI ListenerObject : public Object {
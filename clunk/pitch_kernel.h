@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef CLUNK_PITCH_KERNEL_H__
+#define CLUNK_PITCH_KERNEL_H__
+
+//interpolating sample readers of Source. Like the fft kernels every translation unit is compiled with its own instruction set, 
+//so everything here has internal linkage.
+
+#include <clunk/types.h>
+
+namespace clunk {
+
+/*!
+	Fills dst with n mono samples read at positions pos + i * step, both are 32.32 fixed point frames. 
+	Linear kernels read frames floor(position) and the next one, cubic ones also the frames before and after them: all of them must be inside the data.
+*/
+typedef void (*pitch_kernel_type)(float *dst, unsigned n, const void *src, u64 pos, u64 step);
+
+//kernels for s16 and float samples (Sample::Storage), linear and cubic interpolation
+typedef pitch_kernel_type pitch_kernel_table[2][2];
+
+extern const pitch_kernel_table pitch_kernels_scalar;
+extern const pitch_kernel_table pitch_kernels_sse;
+extern const pitch_kernel_table pitch_kernels_avx2;
+
+namespace {
+
+inline float pitch_normalize(s16 v) { return v / 32768.0f; }
+inline float pitch_normalize(float v) { return v; }
+
+//catmull-rom spline through 4 frames, t is the position between x0 and x1
+inline float pitch_cubic(float xm1, float x0, float x1, float x2, float t) {
+	const float c1 = 0.5f * (x1 - xm1);
+	const float c2 = xm1 - 2.5f * x0 + 2 * x1 - 0.5f * x2;
+	const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+	return ((c3 * t + c2) * t + c1) * t + x0;
+}
+
+//fraction of the 32.32 position
+inline float pitch_fraction(u64 pos) {
+	return (unsigned)(pos & 0xffffffffu) * (1.0f / 4294967296.0f);
+}
+
+template<typename T, bool Cubic>
+void pitch_block(float *dst, unsigned n, const void *data, u64 pos, u64 step) {
+	const T *src = static_cast<const T *>(data);
+	for(unsigned i = 0; i < n; ++i, pos += step) {
+		const T *x = src + (size_t)(pos >> 32);
+		const float t = pitch_fraction(pos);
+		if (Cubic) {
+			dst[i] = pitch_cubic(pitch_normalize(x[-1]), pitch_normalize(x[0]), pitch_normalize(x[1]), pitch_normalize(x[2]), t);
+		} else {
+			const float x0 = pitch_normalize(x[0]);
+			dst[i] = x0 + t * (pitch_normalize(x[1]) - x0);
+		}
+	}
+}
+
+}
+}
+
+#endif
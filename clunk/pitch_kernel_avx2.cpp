@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/pitch_kernel.h>
+#include <immintrin.h>
+
+namespace clunk {
+namespace {
+
+//frames floor(position) - 1 .. floor(position) + 2 of 8 positions. s16 pairs are gathered as one 32 bit word
+struct s16_taps {
+	typedef s16 type;
+	static inline __m256 low(__m256i v) { return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16)), _mm256_set1_ps(1.0f / 32768)); }
+	static inline __m256 high(__m256i v) { return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(v, 16)), _mm256_set1_ps(1.0f / 32768)); }
+
+	static inline void linear(const s16 *src, __m256i idx, __m256 &x0, __m256 &x1) {
+		__m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(src), idx, 2);
+		x0 = low(v);
+		x1 = high(v);
+	}
+	static inline void cubic(const s16 *src, __m256i idx, __m256 &xm1, __m256 &x0, __m256 &x1, __m256 &x2) {
+		__m256i a = _mm256_i32gather_epi32(reinterpret_cast<const int *>(src - 1), idx, 2);
+		__m256i b = _mm256_i32gather_epi32(reinterpret_cast<const int *>(src + 1), idx, 2);
+		xm1 = low(a);
+		x0 = high(a);
+		x1 = low(b);
+		x2 = high(b);
+	}
+};
+
+struct float_taps {
+	typedef float type;
+	static inline void linear(const float *src, __m256i idx, __m256 &x0, __m256 &x1) {
+		x0 = _mm256_i32gather_ps(src, idx, 4);
+		x1 = _mm256_i32gather_ps(src + 1, idx, 4);
+	}
+	static inline void cubic(const float *src, __m256i idx, __m256 &xm1, __m256 &x0, __m256 &x1, __m256 &x2) {
+		xm1 = _mm256_i32gather_ps(src - 1, idx, 4);
+		x0 = _mm256_i32gather_ps(src, idx, 4);
+		x1 = _mm256_i32gather_ps(src + 1, idx, 4);
+		x2 = _mm256_i32gather_ps(src + 2, idx, 4);
+	}
+};
+
+template<typename Taps, bool Cubic>
+void pitch_avx2(float *dst, unsigned n, const void *data, u64 pos, u64 step) {
+	typedef typename Taps::type T;
+	const T *src = static_cast<const T *>(data);
+	unsigned i = 0;
+	if (n >= 8) {
+		//integer and fractional parts of 8 positions, fraction carries into the integer part
+		int idx0[8], frac0[8];
+		for(int k = 0; k < 8; ++k) {
+			const u64 p = pos + k * step;
+			idx0[k] = (int)(p >> 32);
+			frac0[k] = (int)(unsigned)p;
+		}
+		__m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(idx0)), frac = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(frac0));
+		const u64 step8 = 8 * step;
+		const __m256i step_int = _mm256_set1_epi32((int)(step8 >> 32)), step_frac = _mm256_set1_epi32((int)(unsigned)step8);
+		const __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+		const __m256 frac_scale = _mm256_set1_ps(1.0f / 16777216.0f);
+
+		for(; i + 8 <= n; i += 8) {
+			const __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(frac, 8)), frac_scale);
+			__m256 y;
+			if (Cubic) {
+				__m256 xm1, x0, x1, x2;
+				Taps::cubic(src, idx, xm1, x0, x1, x2);
+				const __m256 half = _mm256_set1_ps(0.5f);
+				const __m256 c1 = _mm256_mul_ps(half, _mm256_sub_ps(x1, xm1));
+				const __m256 c2 = _mm256_fmadd_ps(_mm256_set1_ps(-2.5f), x0, _mm256_fmadd_ps(_mm256_set1_ps(2.0f), x1, _mm256_fnmadd_ps(half, x2, xm1)));
+				const __m256 c3 = _mm256_fmadd_ps(half, _mm256_sub_ps(x2, xm1), _mm256_mul_ps(_mm256_set1_ps(1.5f), _mm256_sub_ps(x0, x1)));
+				y = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_fmadd_ps(c3, t, c2), t, c1), t, x0);
+			} else {
+				__m256 x0, x1;
+				Taps::linear(src, idx, x0, x1);
+				y = _mm256_fmadd_ps(t, _mm256_sub_ps(x1, x0), x0);
+			}
+			_mm256_storeu_ps(dst + i, y);
+
+			//unsigned overflow of the fraction: sign flipped signed compare
+			const __m256i next = _mm256_add_epi32(frac, step_frac);
+			const __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(frac, sign), _mm256_xor_si256(next, sign));
+			idx = _mm256_sub_epi32(_mm256_add_epi32(idx, step_int), carry);
+			frac = next;
+		}
+		pos += i * step;
+	}
+	pitch_block<T, Cubic>(dst + i, n - i, data, pos, step);
+	_mm256_zeroupper();
+}
+
+}
+
+const pitch_kernel_table pitch_kernels_avx2 = {
+	{ &pitch_avx2<s16_taps, false>, &pitch_avx2<s16_taps, true> },
+	{ &pitch_avx2<float_taps, false>, &pitch_avx2<float_taps, true> },
+};
+
+}
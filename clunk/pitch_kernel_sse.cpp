@@ -0,0 +1,71 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/pitch_kernel.h>
+#include <emmintrin.h>
+
+namespace clunk {
+namespace {
+
+//sse2 has no gathers: 4 positions are stepped in scalar code, interpolation runs on vectors
+template<typename T>
+inline __m128 load4(const T *src, const unsigned *idx, int offset) {
+	return _mm_setr_ps(pitch_normalize(src[idx[0] + offset]), pitch_normalize(src[idx[1] + offset]), pitch_normalize(src[idx[2] + offset]), pitch_normalize(src[idx[3] + offset]));
+}
+
+template<typename T, bool Cubic>
+void pitch_sse(float *dst, unsigned n, const void *data, u64 pos, u64 step) {
+	const T *src = static_cast<const T *>(data);
+	unsigned i = 0;
+	for(; i + 4 <= n; i += 4) {
+		unsigned idx[4];
+		int frac[4];
+		for(int k = 0; k < 4; ++k, pos += step) {
+			idx[k] = (unsigned)(pos >> 32);
+			frac[k] = (int)((unsigned)pos >> 8);
+		}
+		const __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frac))), _mm_set1_ps(1.0f / 16777216.0f));
+		const __m128 x0 = load4(src, idx, 0), x1 = load4(src, idx, 1);
+		__m128 y;
+		if (Cubic) {
+			const __m128 xm1 = load4(src, idx, -1), x2 = load4(src, idx, 2);
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 c1 = _mm_mul_ps(half, _mm_sub_ps(x1, xm1));
+			const __m128 c2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(xm1, _mm_mul_ps(_mm_set1_ps(2.5f), x0)), _mm_add_ps(x1, x1)), _mm_mul_ps(half, x2));
+			const __m128 c3 = _mm_add_ps(_mm_mul_ps(half, _mm_sub_ps(x2, xm1)), _mm_mul_ps(_mm_set1_ps(1.5f), _mm_sub_ps(x0, x1)));
+			y = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(c3, t), c2), t), c1), t), x0);
+		} else 
+			y = _mm_add_ps(x0, _mm_mul_ps(t, _mm_sub_ps(x1, x0)));
+		_mm_storeu_ps(dst + i, y);
+	}
+	pitch_block<T, Cubic>(dst + i, n - i, data, pos, step);
+}
+
+}
+
+const pitch_kernel_table pitch_kernels_sse = {
+	{ &pitch_sse<s16, false>, &pitch_sse<s16, true> },
+	{ &pitch_sse<float, false>, &pitch_sse<float, true> },
+};
+
+}
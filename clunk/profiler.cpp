@@ -0,0 +1,165 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/profiler.h>
+#include <algorithm>
+#include <string.h>
+#include <stddef.h>
+
+using namespace clunk;
+
+Profiler::Profiler(size_t capacity): _enabled(false), _records(capacity), _head(0), _tail(0), _dropped(0) {}
+
+void Profiler::set_enabled(bool enabled, size_t capacity) {
+	if (capacity == 0)
+		capacity = 1;
+	if (capacity != _records.size()) {
+		std::vector<ProfileRecord> records(capacity);
+		_records.swap(records);
+	}
+	_head = _tail = 0;
+	_dropped = 0;
+	_enabled = enabled;
+}
+
+ProfileRecord *Profiler::begin(u64 clock, unsigned frames, unsigned sample_rate) {
+	if (!_enabled)
+		return NULL;
+
+	size_t head = _head.load(std::memory_order_relaxed);
+	if (head - _tail.load(std::memory_order_acquire) >= _records.size()) {
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	ProfileRecord &record = _records[head % _records.size()];
+	record.clock = clock;
+	record.frames = frames;
+	record.period = sample_rate > 0? (float)frames / sample_rate: 0;
+	std::fill(record.stage, record.stage + ProfileRecord::Stages, 0.0f);
+	record.sources = 0;
+	return &record;
+}
+
+void Profiler::end() {
+	_head.fetch_add(1, std::memory_order_release);
+}
+
+bool Profiler::pop(ProfileRecord &record) {
+	size_t tail = _tail.load(std::memory_order_relaxed);
+	if (tail == _head.load(std::memory_order_acquire))
+		return false;
+
+	const ProfileRecord &src = _records[tail % _records.size()];
+	memcpy(&record, &src, offsetof(ProfileRecord, source) + src.sources * sizeof(ProfileRecord::SourceCost));
+	_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+void ProfileStats::Window::add(float value, size_t window) {
+	if (_values.size() < window) {
+		_values.push_back(value);
+		return;
+	}
+	_values[_next] = value;
+	_next = (_next + 1) % window;
+}
+
+ProfileStats::Aggregate ProfileStats::Window::aggregate() const {
+	Aggregate r;
+	if (_values.empty())
+		return r;
+
+	std::vector<float> values(_values);
+	r.count = (unsigned)values.size();
+	r.min = *std::min_element(values.begin(), values.end());
+	r.max = *std::max_element(values.begin(), values.end());
+	double sum = 0;
+	for(size_t i = 0; i < values.size(); ++i)
+		sum += values[i];
+	r.avg = (float)(sum / values.size());
+
+	std::vector<float>::iterator p99 = values.begin() + (values.size() - 1) * 99 / 100;
+	std::nth_element(values.begin(), p99, values.end());
+	r.p99 = *p99;
+	return r;
+}
+
+ProfileStats::ProfileStats(size_t window): _window(window > 0? window: 1) {}
+
+void ProfileStats::add(const ProfileRecord &record) {
+	for(int i = 0; i < ProfileRecord::Stages; ++i)
+		_stages[i].add(record.stage[i], _window);
+	if (record.period > 0)
+		_load.add(record.stage[ProfileRecord::Total] / record.period, _window);
+
+	//the same sample or object could be rendered several times per period
+	std::map<std::string, float> samples;
+	std::map<const void *, float> objects;
+	for(unsigned i = 0; i < record.sources; ++i) {
+		const ProfileRecord::SourceCost &cost = record.source[i];
+		samples[std::string(cost.sample, strnlen(cost.sample, ProfileRecord::NameLength))] += cost.time;
+		objects[cost.object] += cost.time;
+	}
+	for(std::map<std::string, float>::const_iterator i = samples.begin(); i != samples.end(); ++i)
+		_samples[i->first].add(i->second, _window);
+	for(std::map<const void *, float>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+		_objects[i->first].add(i->second, _window);
+}
+
+void ProfileStats::add(Profiler &profiler) {
+	ProfileRecord record;
+	while(profiler.pop(record))
+		add(record);
+}
+
+void ProfileStats::clear() {
+	for(int i = 0; i < ProfileRecord::Stages; ++i)
+		_stages[i] = Window();
+	_load = Window();
+	_samples.clear();
+	_objects.clear();
+}
+
+ProfileStats::Aggregate ProfileStats::get(ProfileRecord::Stage stage) const {
+	return stage >= 0 && stage < ProfileRecord::Stages? _stages[stage].aggregate(): Aggregate();
+}
+
+ProfileStats::Aggregate ProfileStats::get_load() const {
+	return _load.aggregate();
+}
+
+std::map<std::string, ProfileStats::Aggregate> ProfileStats::get_samples() const {
+	std::map<std::string, Aggregate> result;
+	for(std::map<std::string, Window>::const_iterator i = _samples.begin(); i != _samples.end(); ++i)
+		result[i->first] = i->second.aggregate();
+	return result;
+}
+
+std::map<const void *, ProfileStats::Aggregate> ProfileStats::get_objects() const {
+	std::map<const void *, Aggregate> result;
+	for(std::map<const void *, Window>::const_iterator i = _objects.begin(); i != _objects.end(); ++i)
+		result[i->first] = i->second.aggregate();
+	return result;
+}
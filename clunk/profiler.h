@@ -0,0 +1,164 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_PROFILER_H__
+#define CLUNK_PROFILER_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/types.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace clunk {
+
+//!Timings of the single Context::process call
+struct CLUNKAPI ProfileRecord {
+	enum Stage {
+		///sources selection: spatial walk, scoring and voice update
+		Selection,
+		///stream decoding and resampling
+		Streams,
+		///sources rendering (hrtf), wall time of the whole stage
+		Sources,
+		///accumulators reduction, limiter and output conversion
+		Mixing,
+		///whole callback
+		Total,
+		Stages
+	};
+	enum { MaxSources = 64, NameLength = 32 };
+
+	//!Render cost of the single source
+	struct SourceCost {
+		///sample name, truncated
+		char sample[NameLength];
+		///owner object, use it only as an identifier
+		const void *object;
+		///seconds
+		float time;
+	};
+
+	///context clock (frames) at the beginning of the period
+	u64 clock;
+	///period length, frames
+	unsigned frames;
+	///period length, seconds: a budget for the Total stage
+	float period;
+	///seconds spent per stage
+	float stage[Stages];
+	///number of valid entries in sources, costs of the sources beyond MaxSources are not recorded
+	unsigned sources;
+	SourceCost source[MaxSources];
+};
+
+/*!
+	\brief Built-in profiler of the audio callback.
+	Audio thread pushes one ProfileRecord per period into a lock-free ring, game thread pops them and feeds ProfileStats.
+	When the ring is full new records are dropped, see dropped().
+*/
+class CLUNKAPI Profiler {
+public:
+	typedef std::chrono::steady_clock clock_type;
+
+	Profiler(size_t capacity = 256);
+
+	///enables profiling, ring is reallocated if capacity differs. Call it from the thread owning context.
+	void set_enabled(bool enabled, size_t capacity = 256);
+	bool enabled() const { return _enabled; }
+
+	///game thread: pops the oldest record, returns false if ring is empty
+	bool pop(ProfileRecord &record);
+	///number of records dropped because reader was too slow
+	size_t dropped() const { return _dropped.load(); }
+
+	///internal: returns record for the current period or NULL if profiler is disabled or ring is full
+	ProfileRecord *begin(u64 clock, unsigned frames, unsigned sample_rate);
+	///internal: publishes record returned by begin
+	void end();
+
+	///returns seconds elapsed since start
+	static inline float elapsed(const clock_type::time_point &start) {
+		return std::chrono::duration<float>(clock_type::now() - start).count();
+	}
+
+private:
+	Profiler(const Profiler &);
+	const Profiler& operator=(const Profiler &);
+
+	bool _enabled;
+	std::vector<ProfileRecord> _records;
+	std::atomic<size_t> _head, _tail;
+	std::atomic<size_t> _dropped;
+};
+
+//!Game thread aggregator of the profile records: min/avg/p99/max over the sliding window
+class CLUNKAPI ProfileStats {
+public:
+	struct Aggregate {
+		float min, avg, p99, max;
+		unsigned count;
+		Aggregate(): min(0), avg(0), p99(0), max(0), count(0) {}
+	};
+
+	///window - number of the latest samples kept for every value
+	ProfileStats(size_t window = 1024);
+
+	void add(const ProfileRecord &record);
+	///pops all records from the profiler
+	void add(Profiler &profiler);
+	void clear();
+
+	///timings of the stage, seconds
+	Aggregate get(ProfileRecord::Stage stage) const;
+	///load of the callback: total time / period length
+	Aggregate get_load() const;
+	///render cost of the sources grouped by sample name, seconds per period
+	std::map<std::string, Aggregate> get_samples() const;
+	///render cost of the sources grouped by object, seconds per period
+	std::map<const void *, Aggregate> get_objects() const;
+
+private:
+	class Window {
+	public:
+		Window(): _next(0) {}
+		void add(float value, size_t window);
+		Aggregate aggregate() const;
+	private:
+		std::vector<float> _values;
+		size_t _next;
+	};
+
+	size_t _window;
+	Window _stages[ProfileRecord::Stages];
+	Window _load;
+	std::map<std::string, Window> _samples;
+	std::map<const void *, Window> _objects;
+};
+
+}
+
+#endif
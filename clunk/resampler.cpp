@@ -0,0 +1,386 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/resampler.h>
+#include <clunk/resampler_kernel.h>
+#include <clunk/clunk_ex.h>
+#include <clunk/cpu_features.h>
+#include <clunk/logger.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+using namespace clunk;
+
+namespace {
+
+inline float dot_scalar(const float *x, const float *h, unsigned taps) {
+	float a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+	for(unsigned k = 0; k < taps; k += 4) {
+		a0 += x[k] * h[k];
+		a1 += x[k + 1] * h[k + 1];
+		a2 += x[k + 2] * h[k + 2];
+		a3 += x[k + 3] * h[k + 3];
+	}
+	return (a0 + a1) + (a2 + a3);
+}
+
+struct Preset {
+	unsigned taps, phase_bits;
+	//stopband attenuation, dB
+	double attenuation;
+};
+
+const Preset presets[] = {
+	{ 16, 6, 60 },
+	{ 32, 7, 80 },
+	{ 64, 9, 100 },
+};
+
+//input frames stored per process() iteration on top of the taps
+const unsigned Block = 1024;
+
+double bessel_i0(double x) {
+	double sum = 1, term = 1;
+	for(int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+unsigned gcd(unsigned a, unsigned b) {
+	while(b != 0) {
+		unsigned r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+template<int Format>
+void to_float_frames(float *dst, unsigned dst_channels, const void *data, unsigned src_channels, size_t frames) {
+	typedef AudioFormat<Format> F;
+	const typename F::Type *src = static_cast<const typename F::Type *>(data);
+	const float scale = 1.0f / (F::Range + 1);
+	for(size_t i = 0; i < frames; ++i, src += src_channels) {
+		const float v0 = ((int)src[0] - (int)F::Zero) * scale;
+		if (src_channels == dst_channels) {
+			dst[0] = v0;
+			if (dst_channels == 2)
+				dst[1] = ((int)src[1] - (int)F::Zero) * scale;
+		} else if (dst_channels == 1) {
+			dst[0] = 0.5f * (v0 + ((int)src[1] - (int)F::Zero) * scale);
+		} else 
+			dst[0] = dst[1] = v0;
+		dst += dst_channels;
+	}
+}
+
+template<int Format>
+void from_float_samples(void *data, const float *src, size_t n) {
+	typedef AudioFormat<Format> F;
+	typename F::Type *dst = static_cast<typename F::Type *>(data);
+	const float scale = (float)(F::Range + 1);
+	for(size_t i = 0; i < n; ++i)
+		dst[i] = F::clip((int)lrintf(src[i] * scale) + (int)F::Zero);
+}
+
+}
+
+void clunk::resampler_kernel_scalar(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps) {
+	resampler_pass<&dot_scalar>(dst, dst_stride, src, n, offsets, rows, mu, taps);
+}
+
+#ifdef CLUNK_USES_SIMD
+
+#ifdef CLUNK_RESAMPLER_KERNEL_AVX2
+#	define CLUNK_RESAMPLER_AVX2 &resampler_kernel_avx2
+#else
+#	define CLUNK_RESAMPLER_AVX2 &resampler_kernel_sse
+#endif
+
+//avx-512 brings nothing to the dot products of 8-64 taps
+static const resampler_kernel_type kernels[CpuFeatures::Levels] = { &resampler_kernel_scalar, &resampler_kernel_sse, CLUNK_RESAMPLER_AVX2, CLUNK_RESAMPLER_AVX2 };
+
+resampler_kernel_type Resampler::kernel() {
+	return kernels[CpuFeatures::get()];
+}
+
+#elif defined CLUNK_USES_SSE
+
+resampler_kernel_type Resampler::kernel() {
+	return &resampler_kernel_sse;
+}
+
+#else
+
+resampler_kernel_type Resampler::kernel() {
+	return &resampler_kernel_scalar;
+}
+
+#endif
+
+Resampler::Resampler(): _src_rate(0), _dst_rate(0), _channels(0), _quality(Medium), _kernel(NULL), _taps(0), _phases(0), _interpolated(false), _cutoff(0), 
+	_step(1), _pos(0), _den(1), _frac(0), _step_int(1), _step_frac(0), _capacity(0), _size(0), _first(0), _frames(0) {}
+
+void Resampler::init(unsigned src_rate, unsigned dst_rate, unsigned channels, Quality quality) {
+	if (src_rate == 0 || dst_rate == 0)
+		throw_ex(("invalid sample rates %u -> %u", src_rate, dst_rate));
+	if (src_rate > 32 * dst_rate)
+		throw_ex(("downsampling %u -> %u is not supported, ratio is above 32", src_rate, dst_rate));
+	if (channels == 0)
+		throw_ex(("invalid number of channels"));
+	if (quality != Fast && quality != Medium && quality != Best)
+		throw_ex(("invalid resampler quality %d", (int)quality));
+
+	_src_rate = src_rate;
+	_dst_rate = dst_rate;
+	_channels = channels;
+	_quality = quality;
+	_kernel = kernel();
+
+	const Preset &preset = presets[quality];
+	const double ratio = (double)src_rate / dst_rate;
+	//taps grow with the downsampling ratio to keep the transition band as steep relative to the output nyquist frequency
+	_taps = std::min<unsigned>(((unsigned)ceil(preset.taps * std::max(1.0, ratio)) + 7) & ~7u, MaxTaps);
+	//kaiser estimate of the transition width, relative to the input nyquist frequency. Stopband starts at the lower nyquist frequency.
+	const double transition = (preset.attenuation - 7.95) / (2.285 * (_taps - 1) * M_PI);
+	_cutoff = (float)(std::min(1.0, 1 / ratio) - transition / 2);
+
+	const unsigned g = gcd(src_rate, dst_rate);
+	_step = ratio;
+	if (dst_rate / g <= MaxPhases) {
+		_interpolated = false;
+		_phases = dst_rate / g;
+		_den = _phases;
+		_step_int = (src_rate / g) / _phases;
+		_step_frac = (src_rate / g) % _phases;
+	} else {
+		_interpolated = true;
+		_phases = 1u << preset.phase_bits;
+		_den = (u64)1 << 32;
+		_step_int = (u64)ratio;
+		_step_frac = (u64)((ratio - floor(ratio)) * 4294967296.0);
+	}
+	design();
+
+	_capacity = Block + _taps;
+	_history.assign(_capacity * _channels, 0.0f);
+	reset();
+	LOG_DEBUG(("resampler %u -> %u, %u channel(s): %u taps, %u %s phases", src_rate, dst_rate, channels, _taps, _phases, _interpolated? "interpolated": "exact"));
+}
+
+void Resampler::design() {
+	const double attenuation = presets[_quality].attenuation;
+	const double beta = attenuation > 50? 0.1102 * (attenuation - 8.7): 0.5842 * pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21);
+	const unsigned rows = _interpolated? _phases + 1: _phases;
+	const double half = _taps / 2, i0 = bessel_i0(beta);
+	_table.assign(rows * _taps, 0.0f);
+	for(unsigned p = 0; p < rows; ++p) {
+		//taps of the row start half - 1 frames before the output position, which is p / phases frames past the input frame
+		const double f = (double)p / _phases;
+		float *row = &_table[p * _taps];
+		double sum = 0;
+		for(unsigned k = 0; k < _taps; ++k) {
+			const double x = k - (half - 1) - f, r = x / half;
+			if (r <= -1 || r >= 1)
+				continue;
+			const double w = bessel_i0(beta * sqrt(1 - r * r)) / i0;
+			const double a = M_PI * _cutoff * x;
+			const double h = w * (a == 0? 1: sin(a) / a);
+			row[k] = (float)h;
+			sum += h;
+		}
+		//unity dc gain of every phase
+		for(unsigned k = 0; k < _taps; ++k)
+			row[k] = (float)(row[k] / sum);
+	}
+}
+
+void Resampler::set_step(double step) {
+	if (_taps == 0)
+		throw_ex(("resampler was not initialized"));
+	step = std::max(1.0 / 256, std::min(step, _taps / 2.0));
+	if (!_interpolated) {
+		_interpolated = true;
+		_frac = (_frac << 32) / _den;
+		_den = (u64)1 << 32;
+		_phases = 1u << presets[_quality].phase_bits;
+		design();
+	}
+	_step = step;
+	_step_int = (u64)step;
+	_step_frac = (u64)((step - floor(step)) * 4294967296.0);
+}
+
+void Resampler::reset() {
+	_pos = _frac = 0;
+	_first = _frames = 0;
+	//silence before the first input frame
+	_size = _taps / 2 - 1;
+	for(unsigned c = 0; c < _channels; ++c)
+		std::fill(_history.begin() + c * _capacity, _history.begin() + c * _capacity + _size, 0.0f);
+}
+
+size_t Resampler::max_output(size_t frames) const {
+	const u64 end = _frames + frames;
+	return (size_t)((end > _pos? end - _pos: 0) / _step) + 2;
+}
+
+void Resampler::append(const float *src, size_t frames) {
+	for(unsigned c = 0; c < _channels; ++c) {
+		float *dst = &_history[c * _capacity + _size];
+		if (src == NULL) {
+			std::fill(dst, dst + frames, 0.0f);
+			continue;
+		}
+		const float *s = src + c;
+		for(size_t i = 0; i < frames; ++i, s += _channels)
+			dst[i] = *s;
+	}
+	_size += frames;
+	if (src != NULL)
+		_frames += frames;
+}
+
+size_t Resampler::run(float *dst, u64 limit) {
+	const u64 end = _first + _size;
+	size_t written = 0;
+	for(;;) {
+		unsigned n = 0;
+		for(; n < Batch && _pos + _taps <= end && _pos < limit; ++n) {
+			_offsets[n] = (unsigned)(_pos - _first);
+			if (_interpolated) {
+				const u64 phase = _frac * _phases;
+				_rows[n] = &_table[(phase >> 32) * _taps];
+				_mu[n] = (float)(phase & 0xffffffffu) * (1.0f / 4294967296.0f);
+			} else 
+				_rows[n] = &_table[_frac * _taps];
+
+			_pos += _step_int;
+			_frac += _step_frac;
+			if (_frac >= _den) {
+				_frac -= _den;
+				++_pos;
+			}
+		}
+		if (n == 0)
+			break;
+
+		float *out = dst + written * _channels;
+		for(unsigned c = 0; c < _channels; ++c)
+			_kernel(out + c, _channels, &_history[c * _capacity], n, _offsets, _rows, _interpolated? _mu: NULL, _taps);
+		written += n;
+	}
+
+	//frames before the next output are not needed anymore. Steps are below taps / 2, so the next output always starts inside the history.
+	const size_t drop = (size_t)std::min<u64>(_pos - _first, _size);
+	if (drop > 0) {
+		_size -= drop;
+		for(unsigned c = 0; c < _channels; ++c) {
+			float *h = &_history[c * _capacity];
+			memmove(h, h + drop, _size * sizeof(float));
+		}
+		_first += drop;
+	}
+	return written;
+}
+
+size_t Resampler::process(float *dst, const float *src, size_t frames) {
+	if (_taps == 0)
+		throw_ex(("resampler was not initialized"));
+	size_t written = 0;
+	while(frames > 0) {
+		const size_t n = std::min(frames, _capacity - _size);
+		append(src, n);
+		src += n * _channels;
+		frames -= n;
+		written += run(dst + written * _channels, ~(u64)0);
+	}
+	return written;
+}
+
+size_t Resampler::flush(float *dst) {
+	if (_taps == 0)
+		throw_ex(("resampler was not initialized"));
+	size_t written = 0;
+	while(_pos < _frames) {
+		append(NULL, std::min<size_t>(_capacity - _size, _taps));
+		written += run(dst + written * _channels, _frames);
+	}
+	reset();
+	return written;
+}
+
+void Resampler::to_float(Buffer &dst, unsigned dst_channels, const AudioSpec &spec, const Buffer &src) {
+	if (spec.channels < 1 || spec.channels > 2)
+		throw_ex(("invalid source channel count %u", (unsigned)spec.channels));
+	if (dst_channels < 1 || dst_channels > 2)
+		throw_ex(("invalid destination channel count %u", dst_channels));
+
+	const size_t frames = src.get_size() / spec.bytes_per_sample() / spec.channels;
+	dst.set_size(frames * dst_channels * sizeof(float));
+	float *out = static_cast<float *>(dst.get_ptr());
+	switch(spec.format) {
+		case AudioSpec::S8:		to_float_frames<AudioSpec::S8>(out, dst_channels, src.get_ptr(), spec.channels, frames); break;
+		case AudioSpec::U8:		to_float_frames<AudioSpec::U8>(out, dst_channels, src.get_ptr(), spec.channels, frames); break;
+		case AudioSpec::S16:	to_float_frames<AudioSpec::S16>(out, dst_channels, src.get_ptr(), spec.channels, frames); break;
+		case AudioSpec::U16:	to_float_frames<AudioSpec::U16>(out, dst_channels, src.get_ptr(), spec.channels, frames); break;
+		default: throw_ex(("invalid source format %d", (int)spec.format));
+	}
+}
+
+void Resampler::from_float(Buffer &dst, const AudioSpec &spec, const float *src, size_t frames) {
+	const size_t n = frames * spec.channels;
+	dst.set_size(n * spec.bytes_per_sample());
+	switch(spec.format) {
+		case AudioSpec::S8:		from_float_samples<AudioSpec::S8>(dst.get_ptr(), src, n); break;
+		case AudioSpec::U8:		from_float_samples<AudioSpec::U8>(dst.get_ptr(), src, n); break;
+		case AudioSpec::S16:	from_float_samples<AudioSpec::S16>(dst.get_ptr(), src, n); break;
+		case AudioSpec::U16:	from_float_samples<AudioSpec::U16>(dst.get_ptr(), src, n); break;
+		default: throw_ex(("invalid destination format %d", (int)spec.format));
+	}
+}
+
+void Resampler::resample(Buffer &dst, const Buffer &src, unsigned channels, unsigned src_rate, unsigned dst_rate, Quality quality) {
+	Resampler resampler;
+	resampler.init(src_rate, dst_rate, channels, quality);
+	const size_t frames = src.get_size() / sizeof(float) / channels;
+	dst.set_size(resampler.max_output(frames) * channels * sizeof(float));
+	float *out = static_cast<float *>(dst.get_ptr());
+	size_t n = resampler.process(out, static_cast<const float *>(src.get_ptr()), frames);
+	n += resampler.flush(out + n * channels);
+	dst.set_size(n * channels * sizeof(float));
+}
+
+void Resampler::resample(const AudioSpec &dst_spec, Buffer &dst, const AudioSpec &src_spec, const Buffer &src, Quality quality) {
+	Buffer input;
+	to_float(input, dst_spec.channels, src_spec, src);
+	if (src_spec.sample_rate != dst_spec.sample_rate) {
+		Buffer output;
+		resample(output, input, dst_spec.channels, src_spec.sample_rate, dst_spec.sample_rate, quality);
+		input.swap(output);
+	}
+	from_float(dst, dst_spec, static_cast<const float *>(input.get_ptr()), input.get_size() / sizeof(float) / dst_spec.channels);
+}
@@ -0,0 +1,185 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef CLUNK_RESAMPLER_H__
+#define CLUNK_RESAMPLER_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/audio_spec.h>
+#include <clunk/buffer.h>
+#include <stddef.h>
+#include <vector>
+
+namespace clunk {
+
+/*!
+	Computes n output samples of one channel: dst[i * dst_stride] is the dot product of taps samples src + offsets[i] with rows[i]. 
+	If mu is not NULL, the dot product with the next row (rows[i] + taps) is blended in by mu[i]. taps is a multiple of 8.
+*/
+typedef void (*resampler_kernel_type)(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps);
+
+/*!
+	\brief Band-limited polyphase resampler of the interleaved float frames.
+	Kaiser windowed sinc is tabulated for every phase of the exact src:dst ratio if there are at most MaxPhases of them 
+	(all the usual 8000-192000 Hz pairs), otherwise, or after set_step, for a power of two phases with linear interpolation between the neighbouring ones. 
+	Input history and the fractional position are kept between process() calls, so the stream may be fed in chunks of any size.
+	Output is aligned with the input, flush() emits the frames which are still in the history.
+*/
+class CLUNKAPI Resampler {
+public:
+	/*!
+		filter presets, taps are given for upsampling and grow with the downsampling ratio. Stopband starts at the lower nyquist frequency.
+		Fast: 16 taps, 60 dB stopband, transition band from 52% of the lower nyquist frequency. 
+		Medium: 32 taps, 80 dB, from 68%. 
+		Best: 64 taps, 100 dB, from 80%. 
+	*/
+	enum Quality { Fast, Medium, Best };
+	enum { MaxPhases = 1024, MaxTaps = 256, Batch = 64 };
+
+	Resampler();
+
+	/*!
+		\brief designs the filter and resets the state
+		\param[in] src_rate input sample rate
+		\param[in] dst_rate output sample rate
+		\param[in] channels number of channels of the interleaved frames
+		\param[in] quality filter preset
+	*/
+	void init(unsigned src_rate, unsigned dst_rate, unsigned channels, Quality quality = Medium);
+	/*!
+		\brief changes input frames consumed per output frame, e.g. src_rate * pitch / dst_rate. Position and history are kept.
+		Filter is designed for the ratio given to init(), higher steps alias. First call after init() rebuilds the table, do it outside of the audio thread.
+		\param[in] step input frames per output frame, it's clamped to 1 / 256 .. taps / 2
+	*/
+	void set_step(double step);
+	///returns input frames per output frame
+	double get_step() const { return _step; }
+	///drops the history and the fractional position
+	void reset();
+
+	unsigned channels() const { return _channels; }
+	unsigned taps() const { return _taps; }
+	unsigned phases() const { return _phases; }
+	Quality quality() const { return _quality; }
+	///returns memory used by the coefficients and the history, bytes
+	size_t memory() const { return (_table.size() + _history.size()) * sizeof(float); }
+
+	///returns maximum number of frames process() or process() followed by flush() writes for the given number of input frames
+	size_t max_output(size_t frames) const;
+	/*!
+		\brief converts frames, all of them are consumed
+		\param[out] dst interleaved output, max_output(frames) frames at least
+		\param[in] src interleaved input
+		\param[in] frames number of input frames
+		\return number of output frames written
+	*/
+	size_t process(float *dst, const float *src, size_t frames);
+	/*!
+		\brief writes output frames left in the history, as if the input was followed by silence, then resets the state
+		\param[out] dst interleaved output, max_output(0) frames at least
+		\return number of output frames written
+	*/
+	size_t flush(float *dst);
+
+	/*!
+		\brief converts samples of any format to the normalized interleaved floats
+		\param[out] dst floats, stereo is averaged down to mono and mono is duplicated to stereo
+		\param[in] dst_channels channels of the output, 1 or 2
+		\param[in] spec format of the samples
+		\param[in] src samples
+	*/
+	static void to_float(Buffer &dst, unsigned dst_channels, const AudioSpec &spec, const Buffer &src);
+	/*!
+		\brief converts normalized floats to the samples of the given format, values are rounded and clipped
+		\param[out] dst samples
+		\param[in] spec format of the samples, channels of the floats must match it
+		\param[in] src floats
+		\param[in] frames number of frames
+	*/
+	static void from_float(Buffer &dst, const AudioSpec &spec, const float *src, size_t frames);
+	/*!
+		\brief converts the whole buffer of interleaved floats at once
+		\param[out] dst output floats
+		\param[in] src input floats
+		\param[in] channels number of channels
+		\param[in] src_rate input sample rate
+		\param[in] dst_rate output sample rate
+		\param[in] quality filter preset
+	*/
+	static void resample(Buffer &dst, const Buffer &src, unsigned channels, unsigned src_rate, unsigned dst_rate, Quality quality = Medium);
+	/*!
+		\brief converts the whole buffer of samples at once
+		\param[in] dst_spec output format and sample rate
+		\param[out] dst output samples
+		\param[in] src_spec input format and sample rate
+		\param[in] src input samples
+		\param[in] quality filter preset
+	*/
+	static void resample(const AudioSpec &dst_spec, Buffer &dst, const AudioSpec &src_spec, const Buffer &src, Quality quality = Medium);
+
+	///returns dot product kernel of CpuFeatures::get() level or the best compiled one below it
+	static resampler_kernel_type kernel();
+
+private:
+	Resampler(const Resampler &);
+	const Resampler& operator=(const Resampler &);
+
+	//fills the table for the current number of phases
+	void design();
+	//appends frames to the history, NULL src appends silence
+	void append(const float *src, size_t frames);
+	//computes outputs whose taps are in the history and whose position is below limit
+	size_t run(float *dst, u64 limit);
+
+	unsigned _src_rate, _dst_rate, _channels;
+	Quality _quality;
+	resampler_kernel_type _kernel;
+
+	//taps per phase, phases, rows of the table are phases + 1 in the interpolated mode
+	unsigned _taps, _phases;
+	bool _interpolated;
+	float _cutoff;
+	std::vector<float> _table;
+
+	/*
+		position of the next output: _pos + _frac / _den input frames, 
+		_den is the number of phases in the exact mode and 2^32 in the interpolated one
+	*/
+	double _step;
+	u64 _pos, _den, _frac, _step_int, _step_frac;
+
+	//planar history, _capacity frames per channel starting from the frame _first. 
+	//Input frame i is stored as frame i + taps / 2 - 1, preceded by silence, so the taps of the output at i start at i.
+	std::vector<float> _history;
+	size_t _capacity, _size;
+	u64 _first, _frames;
+
+	//per output values of the current batch
+	unsigned _offsets[Batch];
+	const float *_rows[Batch];
+	float _mu[Batch];
+};
+
+}
+
+#endif
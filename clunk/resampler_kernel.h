@@ -0,0 +1,55 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef CLUNK_RESAMPLER_KERNEL_H__
+#define CLUNK_RESAMPLER_KERNEL_H__
+
+//resampler dot product kernels, see resampler_kernel_type. Like the fft kernels every translation unit is compiled with its own instruction set.
+
+namespace clunk {
+
+void resampler_kernel_scalar(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps);
+void resampler_kernel_sse(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps);
+void resampler_kernel_avx2(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps);
+
+namespace {
+
+//Dot computes taps long dot product, taps is a multiple of 8
+template<float (*Dot)(const float *, const float *, unsigned)>
+inline void resampler_pass(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps) {
+	if (mu == 0) {
+		for(unsigned i = 0; i < n; ++i)
+			dst[i * dst_stride] = Dot(src + offsets[i], rows[i], taps);
+	} else {
+		for(unsigned i = 0; i < n; ++i) {
+			const float *x = src + offsets[i];
+			const float y0 = Dot(x, rows[i], taps), y1 = Dot(x, rows[i] + taps, taps);
+			dst[i * dst_stride] = y0 + mu[i] * (y1 - y0);
+		}
+	}
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/resampler_kernel.h>
+#include <immintrin.h>
+
+namespace clunk {
+namespace {
+
+inline float dot_avx2(const float *x, const float *h, unsigned taps) {
+	__m256 a = _mm256_mul_ps(_mm256_loadu_ps(x), _mm256_loadu_ps(h)), b = _mm256_setzero_ps();
+	unsigned k = 8;
+	for(; k + 16 <= taps; k += 16) {
+		b = _mm256_fmadd_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(h + k), b);
+		a = _mm256_fmadd_ps(_mm256_loadu_ps(x + k + 8), _mm256_loadu_ps(h + k + 8), a);
+	}
+	if (k < taps)
+		b = _mm256_fmadd_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(h + k), b);
+	a = _mm256_add_ps(a, b);
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+}
+
+void resampler_kernel_avx2(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps) {
+	resampler_pass<&dot_avx2>(dst, dst_stride, src, n, offsets, rows, mu, taps);
+	_mm256_zeroupper();
+}
+
+}
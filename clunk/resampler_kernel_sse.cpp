@@ -0,0 +1,48 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/resampler_kernel.h>
+#include <emmintrin.h>
+
+namespace clunk {
+namespace {
+
+inline float dot_sse(const float *x, const float *h, unsigned taps) {
+	__m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+	for(unsigned k = 0; k < taps; k += 8) {
+		a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(x + k), _mm_loadu_ps(h + k)));
+		b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(x + k + 4), _mm_loadu_ps(h + k + 4)));
+	}
+	a = _mm_add_ps(a, b);
+	a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+	return _mm_cvtss_f32(a);
+}
+
+}
+
+void resampler_kernel_sse(float *dst, unsigned dst_stride, const float *src, unsigned n, const unsigned *offsets, const float * const *rows, const float *mu, unsigned taps) {
+	resampler_pass<&dot_sse>(dst, dst_stride, src, n, offsets, rows, mu, taps);
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/ring_buffer.h>
+#include <algorithm>
+#include <string.h>
+
+using namespace clunk;
+
+RingBuffer::RingBuffer(size_t capacity): _data(capacity), _read(0), _write(0) {}
+
+void RingBuffer::reset(size_t capacity) {
+	std::vector<u8> data(capacity);
+	_data.swap(data);
+	_read = 0;
+	_write = 0;
+}
+
+size_t RingBuffer::size() const {
+	return _write.load(std::memory_order_acquire) - _read.load(std::memory_order_acquire);
+}
+
+size_t RingBuffer::space() const {
+	return _data.size() - size();
+}
+
+size_t RingBuffer::write(const void *data, size_t size) {
+	const size_t capacity = _data.size();
+	const size_t w = _write.load(std::memory_order_relaxed);
+	size = std::min(size, capacity - (w - _read.load(std::memory_order_acquire)));
+	if (size == 0)
+		return 0;
+
+	const size_t offset = w % capacity;
+	const size_t size1 = std::min(size, capacity - offset);
+	memcpy(&_data[offset], data, size1);
+	if (size1 < size)
+		memcpy(&_data[0], static_cast<const u8 *>(data) + size1, size - size1);
+
+	_write.store(w + size, std::memory_order_release);
+	return size;
+}
+
+void RingBuffer::peek(size_t size, const void *&ptr1, size_t &size1, const void *&ptr2, size_t &size2) const {
+	const size_t capacity = _data.size();
+	const size_t r = _read.load(std::memory_order_relaxed);
+	size = std::min(size, _write.load(std::memory_order_acquire) - r);
+	if (size == 0) {
+		ptr1 = ptr2 = NULL;
+		size1 = size2 = 0;
+		return;
+	}
+
+	const size_t offset = r % capacity;
+	size1 = std::min(size, capacity - offset);
+	size2 = size - size1;
+	ptr1 = &_data[offset];
+	ptr2 = size2 > 0? &_data[0]: NULL;
+}
+
+void RingBuffer::consume(size_t size) {
+	const size_t r = _read.load(std::memory_order_relaxed);
+	size = std::min(size, _write.load(std::memory_order_acquire) - r);
+	_read.store(r + size, std::memory_order_release);
+}
@@ -0,0 +1,74 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_RING_BUFFER_H__
+#define CLUNK_RING_BUFFER_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/types.h>
+#include <atomic>
+#include <vector>
+
+namespace clunk {
+
+/*!
+	\brief Fixed capacity byte ring, single producer / single consumer.
+	Consumer reads data in place: peek() returns up to two contiguous segments, consume() releases them.
+*/
+class CLUNKAPI RingBuffer {
+public:
+	RingBuffer(size_t capacity = 0);
+
+	///reallocates ring and drops its content. Not thread safe.
+	void reset(size_t capacity);
+	size_t capacity() const { return _data.size(); }
+
+	///bytes available for reading
+	size_t size() const;
+	///bytes available for writing
+	size_t space() const;
+	bool empty() const { return size() == 0; }
+
+	///producer: writes up to size bytes, returns number of bytes written
+	size_t write(const void *data, size_t size);
+
+	///consumer: returns segments covering at most size readable bytes, second segment is empty unless data wraps around
+	void peek(size_t size, const void *&ptr1, size_t &size1, const void *&ptr2, size_t &size2) const;
+	///consumer: releases size bytes
+	void consume(size_t size);
+	///consumer: drops everything written so far
+	void clear() { consume(size()); }
+
+private:
+	RingBuffer(const RingBuffer &);
+	const RingBuffer& operator=(const RingBuffer &);
+
+	std::vector<u8> _data;
+	//monotonic byte counters
+	std::atomic<size_t> _read, _write;
+};
+
+}
+
+#endif
@@ -23,15 +23,16 @@ SOFTWARE.
 */
 
 #include <clunk/sample.h>
+#include <clunk/clunk_ex.h>
 #include <clunk/context.h>
 #include <clunk/locker.h>
 #include <clunk/logger.h>
-#include <clunk/resample.h>
+#include <clunk/resampler.h>
 #include <stdexcept>
 
 using namespace clunk;
 
-Sample::Sample(Context *context) : gain(1.0f), pitch(1.0f), _context(context) {}
+Sample::Sample(Context *context) : gain(1.0f), pitch(1.0f), _context(context), _storage(Int16) {}
 
 void Sample::generateSine(const int freq, const float len) {
 	AudioLocker l;
@@ -39,6 +40,7 @@ void Sample::generateSine(const int freq, const float len) {
 	_spec.sample_rate = _context->get_spec().sample_rate;
 	_spec.channels = 1;
 	_spec.format = _context->get_spec().format;
+	_storage = Int16;
 
 	unsigned size = ((int)(len * _spec.sample_rate)) * 2;
 	_data.resize(size);
@@ -58,13 +60,33 @@ void Sample::generateSine(const int freq, const float len) {
 	LOG_DEBUG(("generated %u bytes", (unsigned)_data.get_size()));
 }
 
-void Sample::init(const clunk::Buffer &src_data, const AudioSpec &spec) {
-	AudioLocker l;
+void Sample::init(const clunk::Buffer &src_data, const AudioSpec &spec, Storage storage) {
+	if (storage != Int16 && storage != Float32)
+		throw_ex(("invalid sample storage %d", (int)storage));
+
+	AudioSpec dst_spec;
+	dst_spec.sample_rate = _context->get_spec().sample_rate;
+	dst_spec.channels = 1;
+	dst_spec.format = AudioSpec::S16;
+
+	//conversion runs before locking the audio thread. Data is resampled as float, so Float32 storage is not quantized to 16 bits.
+	clunk::Buffer data;
+	Resampler::to_float(data, 1, spec, src_data);
+	if (spec.sample_rate != dst_spec.sample_rate) {
+		clunk::Buffer resampled;
+		Resampler::resample(resampled, data, 1, spec.sample_rate, dst_spec.sample_rate, _context->get_resample_quality());
+		data.swap(resampled);
+	}
+	if (storage == Int16) {
+		clunk::Buffer s16_data;
+		Resampler::from_float(s16_data, dst_spec, static_cast<const float *>(data.get_ptr()), data.get_size() / sizeof(float));
+		data.swap(s16_data);
+	}
 
-	_spec.sample_rate = _context->get_spec().sample_rate;
-	_spec.channels = 1;
-	_spec.format = _context->get_spec().format;
-	Resample::resample(_spec, _data, spec, src_data);
+	AudioLocker l;
+	_spec = dst_spec;
+	_storage = storage;
+	_data.swap(data);
 }
 
 Sample::~Sample() { }
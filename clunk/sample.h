@@ -35,6 +35,13 @@ class Context;
 //!Holds raw wave data. 
 class CLUNKAPI Sample {
 public: 
+	/*!
+		storage of the converted data, samples are mono, so both are planar.
+		Int16: 2 bytes per sample, converted to float every period it's played. 
+		Float32: normalized floats, twice the memory, render path copies them as is.
+	*/
+	enum Storage { Int16, Float32 };
+
 	///name - for general purpose
 	std::string name;
 	///gain
@@ -48,8 +55,9 @@ public:
 		\brief initializes sample
 		\param[in] data raw audio data
 		\param[in] spec audio format specification
+		\param[in] storage format of the converted data
 	*/	
-	void init(const clunk::Buffer &data, const AudioSpec &spec);
+	void init(const clunk::Buffer &data, const AudioSpec &spec, Storage storage = Int16);
 
 	/*! 
 		\brief generate sine wave with given length (seconds)
@@ -59,9 +67,19 @@ public:
 	void generateSine(int freq, float len);
 
 	float length() const {
-		return 1.0f * _data.get_size() / _spec.sample_rate / _spec.channels / 2;
+		return 1.0f * samples() / _spec.sample_rate;
 	}
 
+	///returns number of samples per channel
+	unsigned samples() const { return (unsigned)(_data.get_size() / _spec.channels / (_storage == Float32? sizeof(float): sizeof(s16))); }
+	///returns storage of the data
+	Storage get_storage() const { return _storage; }
+	///returns memory used by the data, bytes
+	size_t memory() const { return _data.get_size(); }
+	///returns memory used above the Int16 storage of the same data, bytes
+	size_t memory_overhead() const { return _storage == Float32? _data.get_size() / 2: 0; }
+
+	///returns data in the storage format: interleaved s16 for Int16, float for Float32
 	const clunk::Buffer & get_data() const	{ return _data; }
 	const AudioSpec get_spec() const		{ return _spec; }
 
@@ -75,6 +93,7 @@ private:
 
 	Context *		_context;
 	AudioSpec		_spec;
+	Storage			_storage;
 	clunk::Buffer	_data;
 };
 }
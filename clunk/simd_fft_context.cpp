@@ -0,0 +1,56 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/cpu_features.h>
+#include <clunk/fft_context.h>
+#include <clunk/fft_kernel.h>
+
+using namespace clunk;
+
+void clunk::fft_kernel_scalar(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im) {
+	const unsigned n = 1u << bits;
+	for(unsigned q = fft_first_pass(src, reversed, sign, re, im, bits); q < n; q *= 4) {
+		const unsigned offset = fft_stage_offset(bits, q);
+		fft_pass(re, im, n, q, w_re + offset, w_im + offset);
+	}
+}
+
+#ifdef CLUNK_FFT_KERNEL_AVX2
+#	define CLUNK_FFT_AVX2 &fft_kernel_avx2
+#else
+#	define CLUNK_FFT_AVX2 &fft_kernel_sse
+#endif
+
+#ifdef CLUNK_FFT_KERNEL_AVX512
+#	define CLUNK_FFT_AVX512 &fft_kernel_avx512
+#else
+#	define CLUNK_FFT_AVX512 CLUNK_FFT_AVX2
+#endif
+
+//levels without compiled kernel fall back to the best one below
+static const fft_kernel_type kernels[CpuFeatures::Levels] = { &fft_kernel_scalar, &fft_kernel_sse, CLUNK_FFT_AVX2, CLUNK_FFT_AVX512 };
+
+fft_kernel_type FftKernels::get() {
+	return kernels[CpuFeatures::get()];
+}
@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_SIMD_FFT_CONTEXT_H__
+#define CLUNK_SIMD_FFT_CONTEXT_H__
+
+#include <clunk/export_clunk.h>
+
+#ifndef CLUNK_USES_SIMD
+#	error turn on runtime SIMD dispatch with CLUNK_USES_SIMD macro
+#endif
+
+#include <complex>
+
+namespace clunk {
+
+/*!
+	FFT of 1 << bits points with fft_tables<bits, float> twiddles and permutation. 
+	First pass reads interleaved complex src in bit reversed order (conjugated if sign is negative), result is written as split re and im arrays.
+*/
+typedef void (*fft_kernel_type)(const float *src, const unsigned *reversed, float sign, float *re, float *im, unsigned bits, const float *w_re, const float *w_im);
+
+//!FFT kernels compiled for the CpuFeatures levels
+struct CLUNKAPI FftKernels {
+	///returns kernel of CpuFeatures::get() level or the best compiled one below it
+	static fft_kernel_type get();
+};
+
+template<int BITS>
+class fft_context<BITS, float> {
+public: 
+	enum { N = 1 << BITS };
+
+	typedef std::complex<float> value_type;
+	value_type data[N];
+
+	fft_context(): data() { }
+
+	inline void fft() {
+		transform(1);
+	}
+
+	inline void ifft() {
+		transform(-1);
+	}
+
+private:
+	float _re[N], _im[N];
+
+	//inverse transform is conj(fft(conj(x))) / N
+	void transform(float sign) {
+		const fft_tables<BITS, float> &tables = fft_tables<BITS, float>::get();
+		FftKernels::get()(reinterpret_cast<const float *>(data), tables.reversed, sign, _re, _im, BITS, tables.w_re, tables.w_im);
+
+		const float scale = sign > 0? 1.0f: 1.0f / N;
+		for(unsigned i = 0; i < N; ++i)
+			data[i] = value_type(_re[i] * scale, sign * _im[i] * scale);
+	}
+};
+
+}
+
+#endif
@@ -29,6 +29,9 @@ SOFTWARE.
 #include <assert.h>
 #include <clunk/clunk_assert.h>
 #include <clunk/mixer.h>
+#include <clunk/cpu_features.h>
+#include <clunk/pitch_kernel.h>
+#include <algorithm>
 
 #if defined _MSC_VER || __APPLE__ || __FreeBSD__
 #	define pow10f(x) powf(10.0f, (x))
@@ -38,8 +41,8 @@ SOFTWARE.
 using namespace clunk;
 
 Source::Source(const Sample * sample, const bool loop, const v3f &delta, float gain, float pitch, float panning):
-	sample(sample), loop(loop), delta_position(delta), gain(gain), pitch(pitch), panning(panning), 
-	position(0), fadeout(0), fadeout_total(0)
+	sample(sample), loop(loop), delta_position(delta), gain(gain), pitch(pitch), panning(panning), priority(1), interpolation(Linear),
+	position(0), fadeout(0), fadeout_total(0), _phase(0), _voice_gain(0), _voice_target(0), _voice_step(0), _hrtf_window(0)
 {	
 	if (sample == NULL)
 		throw_ex(("sample for source cannot be NULL"));
@@ -55,88 +58,266 @@ bool Source::playing() const {
 	//if (!sample3d[0].empty() || !sample3d[1].empty())
 	//	return true;
 	
-	return position < (int)(sample->get_data().get_size() / sample->get_spec().channels / 2);
+	return position < (int)sample->samples();
 }
 	
-float Source::_process(clunk::Buffer &dst_buf, unsigned dst_ch, const v3f &delta_position, float fx_volume, float pitch) {
-	
-	const s16 * src = static_cast<const s16 *>(sample->get_data().get_ptr());
-	if (src == NULL)
+float Source::_process(const HrtfBank &bank, float * const *dst, unsigned dst_ch, unsigned dst_n, const v3f &delta_position, float fx_volume, float pitch, Buffer &src_buf) {
+	float volume, volume_end;
+	if (!_prepare(dst_ch, dst_n, fx_volume, pitch, src_buf, volume, volume_end))
+		return 0;
+
+	unsigned used_samples = _hrtf.process(bank, sample->get_spec().sample_rate, dst, dst_ch, dst_n, src_buf, dst_ch, delta_position, volume, volume_end);
+	_advance(used_samples, pitch);
+
+	//LOG_DEBUG(("size2: %u, %u, needed: %u", (unsigned)sample3d[0].get_size(), (unsigned)sample3d[1].get_size(), dst_n));
+	return volume_end;
+}
+
+namespace {
+	//sample values normalized to -1..1
+	inline float normalize(s16 v) { return v / 32768.0f; }
+	inline float normalize(float v) { return v; }
+
+	//32.32 fixed point frames per output sample
+	inline u64 pitch_step(float pitch) {
+		return std::max<u64>(1, (u64)(pitch * 4294967296.0 + 0.5));
+	}
+
+	template<typename T>
+	inline float fetch(const T *src, int src_n, int p, bool loop) {
+		if (loop) {
+			p %= src_n;
+			if (p < 0)
+				p += src_n;
+		} else if (p < 0 || p >= src_n)
+			return 0;
+		return normalize(src[p]);
+	}
+}
+
+const pitch_kernel_table clunk::pitch_kernels_scalar = {
+	{ &pitch_block<s16, false>, &pitch_block<s16, true> },
+	{ &pitch_block<float, false>, &pitch_block<float, true> },
+};
+
+#ifdef CLUNK_USES_SIMD
+
+#ifdef CLUNK_PITCH_KERNEL_AVX2
+#	define CLUNK_PITCH_AVX2 &pitch_kernels_avx2
+#else
+#	define CLUNK_PITCH_AVX2 &pitch_kernels_sse
+#endif
+
+//gathers of avx-512 would not pay off on the blocks of one period
+static const pitch_kernel_table * const pitch_kernels[CpuFeatures::Levels] = { &pitch_kernels_scalar, &pitch_kernels_sse, CLUNK_PITCH_AVX2, CLUNK_PITCH_AVX2 };
+
+static const pitch_kernel_table &get_pitch_kernels() {
+	return *pitch_kernels[CpuFeatures::get()];
+}
+
+#elif defined CLUNK_USES_SSE
+
+static const pitch_kernel_table &get_pitch_kernels() {
+	return pitch_kernels_sse;
+}
+
+#else
+
+static const pitch_kernel_table &get_pitch_kernels() {
+	return pitch_kernels_scalar;
+}
+
+#endif
+
+namespace {
+	inline void copy_frames(float *dst, const s16 *src, unsigned n) {
+		for(unsigned i = 0; i < n; ++i)
+			dst[i] = normalize(src[i]);
+	}
+
+	inline void copy_frames(float *dst, const float *src, unsigned n) {
+		std::copy(src, src + n, dst);
+	}
+
+	/*
+		spreads n mono samples of the first channel to dst_ch planar channels, pans and fades them out. 
+		One function is generated for every state of the source, so the loop does not test the state per sample.
+	*/
+	typedef void (*spread_type)(float *dst, unsigned dst_ch, unsigned n, float panning, int fadeout, int fadeout_total);
+
+	template<bool Pan, bool Fade, bool Stereo>
+	void spread(float *dst, unsigned dst_ch, unsigned n, float panning, int fadeout, int fadeout_total) {
+		//panned channels may not exceed the full scale of s16.
+		const float max_value = 32767 / 32768.0f;
+		if (Stereo) {
+			float *left = dst, *right = dst + n;
+			if (!Pan && !Fade) {
+				std::copy(left, left + n, right);
+				return;
+			}
+			const float gl = 1.0f - panning, gr = 1.0f + panning;
+			for(unsigned i = 0; i < n; ++i) {
+				float l = left[i], r = l;
+				if (Pan) {
+					l = std::max(-max_value, std::min(max_value, gl * l));
+					r = std::max(-max_value, std::min(max_value, gr * r));
+				}
+				if (Fade) {
+					const float f = (int)i < fadeout? (float)(fadeout - (int)i) / fadeout_total: 0.0f;
+					l *= f;
+					r *= f;
+				}
+				left[i] = l;
+				right[i] = r;
+			}
+			return;
+		}
+
+		//channel 0 holds the source data, so it's written last.
+		const float *mono = dst;
+		for(unsigned c = dst_ch; c-- > 0; ) {
+			float *out = dst + c * n;
+			if (Pan && c < 2) {
+				const float g = 1.0f + panning * (c == 0? -1: 1);
+				for(unsigned i = 0; i < n; ++i)
+					out[i] = std::max(-max_value, std::min(max_value, g * mono[i]));
+			} else if (c != 0)
+				std::copy(mono, mono + n, out);
+		}
+
+		if (Fade) {
+			for(unsigned c = 0; c < dst_ch; ++c) {
+				float *out = dst + c * n;
+				for(unsigned i = 0; i < n; ++i)
+					out[i] *= (int)i < fadeout? (float)(fadeout - (int)i) / fadeout_total: 0.0f;
+			}
+		}
+	}
+
+	//[panned][fading][stereo]
+	const spread_type spread_kernels[2][2][2] = {
+		{ { &spread<false, false, false>, &spread<false, false, true> }, { &spread<false, true, false>, &spread<false, true, true> } },
+		{ { &spread<true, false, false>, &spread<true, false, true> }, { &spread<true, true, false>, &spread<true, true, true> } },
+	};
+}
+
+template<typename T, bool Loop>
+float Source::_read(const T *src, int src_n, s64 pos) const {
+	const int p = (int)(pos >> 32);
+	if (interpolation == Nearest)
+		return fetch(src, src_n, p, Loop);
+
+	const float t = pitch_fraction((u64)pos);
+	const float x0 = fetch(src, src_n, p, Loop), x1 = fetch(src, src_n, p + 1, Loop);
+	if (interpolation == Linear)
+		return x0 + t * (x1 - x0);
+	return pitch_cubic(fetch(src, src_n, p - 1, Loop), x0, x1, fetch(src, src_n, p + 2, Loop), t);
+}
+
+template<typename T, bool Loop>
+void Source::_fill(float *dst, unsigned dst_n, float pitch) const {
+	const T * src = static_cast<const T *>(sample->get_data().get_ptr());
+	const int src_n = (int)sample->samples();
+	const u64 step = pitch_step(pitch);
+
+	if (step == ((u64)1 << 32) && _phase == 0) {
+		//every interpolation reads frames as they are at pitch 1 and integer position: copy or convert the runs between the loop points
+		int p = Loop? position % src_n: position;
+		for(unsigned i = 0; i < dst_n; ) {
+			if (Loop && p >= src_n)
+				p = 0;
+			if (!Loop && p >= src_n) {
+				std::fill(dst + i, dst + dst_n, 0.0f);
+				break;
+			}
+			const unsigned n = std::min<unsigned>(dst_n - i, (unsigned)(src_n - p));
+			copy_frames(dst + i, src + p, n);
+			p += n;
+			i += n;
+		}
+		return;
+	}
+
+	const s64 end = (s64)src_n << 32;
+	//frames read before and after the position
+	const int before = interpolation == Cubic? 1: 0, after = interpolation == Cubic? 2: interpolation == Linear? 1: 0;
+	const pitch_kernel_type kernel = interpolation == Nearest? NULL: get_pitch_kernels()[sample->get_storage() == Sample::Float32? 1: 0][interpolation == Cubic? 1: 0];
+
+	//runs of positions with all their frames inside the data go to the kernel, 
+	//positions around the loop point and the ends of the sample are read one by one.
+	s64 pos = (s64)position * 4294967296LL + _phase;
+	for(unsigned i = 0; i < dst_n; ) {
+		if (Loop && pos >= end)
+			pos -= end;
+		const int p = (int)(pos >> 32);
+		if (!Loop && p - before >= src_n) {
+			std::fill(dst + i, dst + dst_n, 0.0f);
+			break;
+		}
+		if (kernel != NULL && p >= before && p + after < src_n) {
+			const s64 last = ((s64)(src_n - after) << 32) - 1;
+			const unsigned n = (unsigned)std::min<u64>(dst_n - i, (u64)(last - pos) / step + 1);
+			kernel(dst + i, n, src, (u64)pos, step);
+			pos += (s64)(n * step);
+			i += n;
+		} else {
+			dst[i++] = _read<T, Loop>(src, src_n, pos);
+			pos += step;
+		}
+	}
+}
+
+bool Source::_prepare(unsigned dst_ch, unsigned dst_n, float fx_volume, float &pitch, Buffer &src_buf, float &volume, float &volume_end) {
+	if (sample->get_data().get_ptr() == NULL)
 			throw_ex(("uninitialized sample used (%p)", (void *)sample));
 
 	pitch *= this->pitch * sample->pitch;
 	if (pitch <= 0)
 		throw_ex(("pitch %g could not be negative or zero", pitch));
 
-	unsigned src_ch = sample->get_spec().channels;
-	unsigned src_n = (unsigned)sample->get_data().get_size() / src_ch / 2;
-	unsigned dst_n = (unsigned)dst_buf.get_size() / dst_ch / 2;
-
 	float vol = fx_volume * gain * sample->gain;
 	
 	if (vol > 1)
 		vol = 1;
 
-	Buffer src_buf;
-	unsigned dst_n_plus_overlap = dst_n + Hrtf::WINDOW_SIZE;
-	src_buf.resize(dst_ch * dst_n_plus_overlap * 2);
-	s16 * src_buf_ptr = static_cast<s16 *>(src_buf.get_ptr());
-	for(unsigned i = 0; i < dst_n_plus_overlap; ++i) {
-		for(unsigned c = 0; c < dst_ch; ++c) {
-			int p = position + (int)(i * pitch);
-
-			s16 v = 0;
-			if (loop || (p >= 0 && p < (int)src_n)) {
-				p %= src_n;
-				if (p < 0)
-					p += src_n;
-
-				if (c < src_ch) {
-					v = src[p * src_ch + c];
-				} else {
-					v = src[p * src_ch];//expand mono channel if needed
-				}
-
-				if (panning != 0 && c < 2) {
-					bool left = c == 0;
-					int v0 = (int)((1.0f + panning * (left? -1: 1)) * v);
-					if (v0 > 32767) {
-						v = 32767;
-					} else if (v0 < -32767) {
-						v = -32767;
-					} else {
-						v = (s16)v0;
-					}
-				}
-				if (fadeout_total > 0 && fadeout - i <= 0) {
-					v = 0;
-				}
-				if (fadeout_total > 0 && fadeout - i > 0) {
-					//LOG_DEBUG(("fadeout %d: %d -> %d", fadeout - i, v, v * (fadeout - i) / fadeout_total));
-					v *= (fadeout - i) / fadeout_total;
-				}
-			}
-			src_buf_ptr[i * dst_ch + c] = v;
-		}
+	unsigned dst_n_plus_overlap = dst_n + _hrtf.window_size();
+	src_buf.resize(dst_ch * dst_n_plus_overlap * sizeof(float));
+	float * src_buf_ptr = static_cast<float *>(src_buf.get_ptr());
+	//readers and spreaders are specialized for the state of the source, it's picked once per period
+	if (sample->get_storage() == Sample::Float32) {
+		if (loop)
+			_fill<float, true>(src_buf_ptr, dst_n_plus_overlap, pitch);
+		else
+			_fill<float, false>(src_buf_ptr, dst_n_plus_overlap, pitch);
+	} else {
+		if (loop)
+			_fill<s16, true>(src_buf_ptr, dst_n_plus_overlap, pitch);
+		else
+			_fill<s16, false>(src_buf_ptr, dst_n_plus_overlap, pitch);
 	}
+	spread_kernels[panning != 0][fadeout_total > 0][dst_ch == 2](src_buf_ptr, dst_ch, dst_n_plus_overlap, panning, fadeout, fadeout_total);
 
-	if (vol < 0 || (int)floor(MaxMixVolume * vol + 0.5f) <= 0) {
-		_update_position((int)(dst_n * pitch));
-		return 0;
+	if (vol < MinMixVolume) {
+		_advance(dst_n, pitch);
+		return false;
 	}
 	
-	unsigned used_samples = _hrtf.process(sample->get_spec().sample_rate, dst_buf, dst_ch, src_buf, dst_ch, delta_position, vol);
-	_update_position((int)(used_samples * pitch));
+	float voice_gain = _voice_gain;
+	if (_voice_gain < _voice_target)
+		_voice_gain = std::min(_voice_target, _voice_gain + _voice_step * dst_n);
+	else if (_voice_gain > _voice_target)
+		_voice_gain = std::max(_voice_target, _voice_gain - _voice_step * dst_n);
 
-	//LOG_DEBUG(("size2: %u, %u, needed: %u", (unsigned)sample3d[0].get_size(), (unsigned)sample3d[1].get_size(), dst_n));
-	return vol;
+	volume = vol * voice_gain;
+	volume_end = vol * _voice_gain;
+	return true;
 }
 
 void Source::_update_position(const int dp) {
 	//LOG_DEBUG(("update_position(%d)", dp));
 	position += dp;
 
-	int src_n = (int)sample->get_data().get_size() / sample->get_spec().channels / 2;
+	int src_n = (int)sample->samples();
 	if (loop) {
 		position %= src_n;
 		//LOG_DEBUG(("position %d", position));
@@ -152,8 +333,33 @@ void Source::_update_position(const int dp) {
 	}
 }
 
+void Source::_advance(unsigned n, float pitch) {
+	const u64 delta = _phase + n * pitch_step(pitch);
+	_phase = (unsigned)(delta & 0xffffffffu);
+	_update_position((int)(delta >> 32));
+}
+
+void Source::_set_voice(bool real, float step) {
+	_voice_step = step;
+	if (real && _voice_target <= 0) {
+		if (_voice_gain <= 0) {
+			//resumed voice: stale hrtf state is dropped, sound fades in. fresh sound starts at full gain.
+			_hrtf.reset();
+			_voice_gain = position == 0? 1.0f: 0.0f;
+		}
+		_voice_target = 1;
+	} else if (!real)
+		_voice_target = 0;
+}
+
 Source::~Source() {}
 
 void Source::fade_out(const float sec) {
 	fadeout = fadeout_total = (int)(sample->get_spec().sample_rate * sec);
 }
+
+void Source::set_hrtf_window(unsigned size) {
+	if (size != 0)
+		Hrtf::window_bits(size);
+	_hrtf_window = size;
+}
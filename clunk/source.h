@@ -56,6 +56,15 @@ namespace clunk
 				note: panning is actually applied on mono samples in center(listener) position.
 		*/
 		float panning;
+		///priority, multiplies estimated gain when the context picks real voices
+		float priority;
+		/*!
+			reading of the sample between its frames when pitch or doppler moves the position by fractions of a frame. 
+			Nearest: truncated position, aliases. Linear: 2 frames. Cubic: catmull-rom spline through 4 frames. 
+		*/
+		enum Interpolation { Nearest, Linear, Cubic };
+		///interpolation of the pitched samples, Linear by default
+		Interpolation interpolation;
 		/*!
 				\brief constructs new source
 				\param[in] sample audio data
@@ -71,6 +80,14 @@ namespace clunk
 		///fades out source. usually you do not need this method
 		void fade_out(float sec);
 
+		/*!
+			\brief overrides hrtf window size of the context for this source
+			\param[in] size power of two from 128 to 2048 samples, 0 uses the context's window (default)
+		*/
+		void set_hrtf_window(unsigned size);
+		///returns hrtf window size of the source, 0 if the context's one is used
+		unsigned get_hrtf_window() const { return _hrtf_window; }
+
 		~Source();
 
 		/*!
@@ -78,16 +95,50 @@ namespace clunk
 				\internal for the internal use only.
 		*/
 		void _update_position(int dp);
+		/*!
+				\brief for the internal use only. DO NOT USE IT.
+				\internal advances position by n samples played with pitch, fractional part of the position is kept.
+		*/
+		void _advance(unsigned n, float pitch);
 
 		/*!
 				\brief for the internal use only. DO NOT USE IT.
-				\internal for the internal use only.
+				\internal adds n samples to the ch planar float buffers, returns volume used. scratch is reused between calls to avoid allocations.
 		*/
-		float _process(clunk::Buffer &buffer, unsigned ch, const v3f &position, float fx_volume, float pitch);
+		float _process(const HrtfBank &bank, float * const *dst, unsigned ch, unsigned n, const v3f &position, float fx_volume, float pitch, Buffer &scratch);
+
+		/*!
+				\brief for the internal use only. DO NOT USE IT.
+				\internal first half of _process: fills scratch with ch planar float channels of n + hrtf window samples, multiplies pitch by source and sample pitch and returns volume ramp for the period. 
+				Returns false and advances position if source is too quiet to be mixed. Mix scratch with _get_hrtf() and call _advance(used, pitch) then.
+		*/
+		bool _prepare(unsigned ch, unsigned n, float fx_volume, float &pitch, Buffer &scratch, float &volume, float &volume_end);
+		///internal: hrtf state of the source
+		Hrtf &_get_hrtf() { return _hrtf; }
+
+		/*!
+				\brief for the internal use only. DO NOT USE IT.
+				\internal sets virtual voice target: real voices fade in, demoted ones fade out by step per sample.
+		*/
+		void _set_voice(bool real, float step);
+		///internal: returns true if source is rendered (real or still fading out)
+		bool _voiced() const { return _voice_gain > 0 || _voice_target > 0; }
 
 	private:
+		//reads n mono samples of the sample stored as T into dst, Loop must be equal to loop
+		template<typename T, bool Loop>
+		void _fill(float *dst, unsigned n, float pitch) const;
+		//reads one sample at 32.32 fixed point position, wraps around looped samples and reads silence around the others
+		template<typename T, bool Loop>
+		float _read(const T *src, int src_n, s64 pos) const;
+
 		int position, fadeout, fadeout_total;
+		//fraction of the position, 32 bit fixed point
+		unsigned _phase;
 		Hrtf _hrtf;
+		//virtual voice fade: current gain, target gain (0 or 1) and step per sample
+		float _voice_gain, _voice_target, _voice_step;
+		unsigned _hrtf_window;
 	};
 }
 
@@ -0,0 +1,236 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/spatial_index.h>
+#include <clunk/object.h>
+#include <clunk/clunk_ex.h>
+#include <algorithm>
+#include <math.h>
+
+using namespace clunk;
+
+namespace {
+	//21 bits per axis
+	const int axis_bits = 21;
+	const int axis_limit = (1 << (axis_bits - 1)) - 1;
+	const u64 axis_mask = (1ull << axis_bits) - 1;
+
+	const size_t min_cells = 16;
+
+	//first slot probed for the cell
+	inline size_t home(u64 key, size_t mask) {
+		return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+	}
+
+	inline int chebyshev(int dx, int dy, int dz) {
+		dx = abs(dx); dy = abs(dy); dz = abs(dz);
+		return std::max(dx, std::max(dy, dz));
+	}
+}
+
+SpatialIndex::SpatialIndex(float cell_size): _cell_size(cell_size), _size(0), _used(0) {
+	if (cell_size <= 0)
+		throw_ex(("invalid cell size %g", cell_size));
+	Cell empty = { 0, NULL };
+	_cells.resize(min_cells, empty);
+}
+
+inline int SpatialIndex::cell(float v) const {
+	float c = floorf(v / _cell_size);
+	if (c > axis_limit)
+		return axis_limit;
+	if (c < -axis_limit)
+		return -axis_limit;
+	return (int)c;
+}
+
+SpatialIndex::key_type SpatialIndex::key(int x, int y, int z) {
+	return ((u64)(x & axis_mask) << (2 * axis_bits)) | ((u64)(y & axis_mask) << axis_bits) | (u64)(z & axis_mask);
+}
+
+int SpatialIndex::unpack(key_type key, int shift) {
+	int v = (int)((key >> shift) & axis_mask);
+	return v > axis_limit? v - (1 << axis_bits): v;
+}
+
+size_t SpatialIndex::find(key_type key) const {
+	const size_t mask = _cells.size() - 1;
+	size_t i = home(key, mask);
+	while(_cells[i].head != NULL && _cells[i].key != key)
+		i = (i + 1) & mask;
+	return i;
+}
+
+void SpatialIndex::grow(size_t objects) {
+	size_t size = _cells.size();
+	while(size < 2 * objects)
+		size *= 2;
+	if (size == _cells.size())
+		return;
+
+	cells_type cells(size);
+	std::swap(cells, _cells);
+	for(size_t i = 0; i < cells.size(); ++i) {
+		if (cells[i].head != NULL)
+			_cells[find(cells[i].key)] = cells[i];
+	}
+}
+
+void SpatialIndex::erase(size_t slot) {
+	const size_t mask = _cells.size() - 1;
+	for(size_t i = (slot + 1) & mask; _cells[i].head != NULL; i = (i + 1) & mask) {
+		//cells probed from their home slot past the freed one move into it
+		if (((i - home(_cells[i].key, mask)) & mask) >= ((i - slot) & mask)) {
+			_cells[slot] = _cells[i];
+			slot = i;
+		}
+	}
+	_cells[slot].head = NULL;
+	--_used;
+}
+
+void SpatialIndex::set_cell_size(float cell_size) {
+	if (cell_size <= 0)
+		throw_ex(("invalid cell size %g", cell_size));
+
+	std::vector<Object *> objects;
+	objects.reserve(_size);
+	for(size_t i = 0; i < _cells.size(); ++i) {
+		for(Object *o = _cells[i].head; o != NULL; o = o->_cell_next)
+			objects.push_back(o);
+		_cells[i].head = NULL;
+	}
+
+	_size = _used = 0;
+	_cell_size = cell_size;
+	for(size_t i = 0; i < objects.size(); ++i)
+		link(objects[i]);
+}
+
+void SpatialIndex::insert(Object *o) {
+	grow(_size + 1);
+	link(o);
+}
+
+void SpatialIndex::link(Object *o) {
+	o->_cell = key(cell(o->_position.x), cell(o->_position.y), cell(o->_position.z));
+	Cell &c = _cells[find(o->_cell)];
+	if (c.head == NULL) {
+		c.key = o->_cell;
+		++_used;
+	} else 
+		c.head->_cell_prev = o;
+	o->_cell_prev = NULL;
+	o->_cell_next = c.head;
+	c.head = o;
+	++_size;
+}
+
+void SpatialIndex::remove(Object *o) {
+	if (o->_cell_prev != NULL) {
+		o->_cell_prev->_cell_next = o->_cell_next;
+	} else {
+		const size_t i = find(o->_cell);
+		if (_cells[i].head != o)
+			return;
+		_cells[i].head = o->_cell_next;
+		if (o->_cell_next == NULL)
+			erase(i);
+	}
+	if (o->_cell_next != NULL)
+		o->_cell_next->_cell_prev = o->_cell_prev;
+	o->_cell_prev = o->_cell_next = NULL;
+	--_size;
+}
+
+void SpatialIndex::update(Object *o) {
+	key_type k = key(cell(o->_position.x), cell(o->_position.y), cell(o->_position.z));
+	if (k == o->_cell)
+		return;
+	//object count does not change, cell slots are never short
+	remove(o);
+	link(o);
+}
+
+SpatialIndex::Query::Query(const SpatialIndex &index, const v3f &center, storage_type &storage):
+	_index(index), _center(center), 
+	_x(index.cell(center.x)), _y(index.cell(center.y)), _z(index.cell(center.z)), 
+	_radius(0), _scanned(0), _exhausted(index._size == 0), _candidates(storage) {
+	_candidates.clear();
+}
+
+void SpatialIndex::Query::scan_cell(Object *head) {
+	for(Object *o = head; o != NULL; o = o->_cell_next) {
+		_candidates.push_back(candidate_type(_center.quick_distance(o->_position), o));
+		std::push_heap(_candidates.begin(), _candidates.end(), std::greater<candidate_type>());
+		++_scanned;
+	}
+}
+
+void SpatialIndex::Query::scan_shell() {
+	const int r = _radius++;
+	const size_t shell_cells = r == 0? 1: 24 * (size_t)r * r + 2;
+
+	if (shell_cells > _index._used) {
+		//sparse world: cheaper to check every occupied cell than to walk the shell
+		for(cells_type::const_iterator i = _index._cells.begin(); i != _index._cells.end(); ++i) {
+			if (i->head != NULL && chebyshev(unpack(i->key, 2 * axis_bits) - _x, unpack(i->key, axis_bits) - _y, unpack(i->key, 0) - _z) >= r)
+				scan_cell(i->head);
+		}
+		_exhausted = true;
+		return;
+	}
+
+	for(int dx = -r; dx <= r; ++dx)
+		for(int dy = -r; dy <= r; ++dy) {
+			const bool side = dx == -r || dx == r || dy == -r || dy == r;
+			for(int dz = -r; dz <= r; dz += side? 1: std::max(1, 2 * r)) {
+				const Cell &c = _index._cells[_index.find(key(_x + dx, _y + dy, _z + dz))];
+				if (c.head != NULL)
+					scan_cell(c.head);
+			}
+		}
+
+	if (_scanned >= _index._size)
+		_exhausted = true;
+}
+
+Object *SpatialIndex::Query::next() {
+	while(true) {
+		if (!_candidates.empty()) {
+			//every object outside of the scanned shells is at least (radius - 1) cells away
+			const float bound = (_radius - 1) * _index._cell_size;
+			const candidate_type &top = _candidates.front();
+			if (_exhausted || top.first <= bound * bound) {
+				Object *o = top.second;
+				std::pop_heap(_candidates.begin(), _candidates.end(), std::greater<candidate_type>());
+				_candidates.pop_back();
+				return o;
+			}
+		}
+		if (_exhausted)
+			return NULL;
+		scan_shell();
+	}
+}
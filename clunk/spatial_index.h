@@ -0,0 +1,125 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_SPATIAL_INDEX_H__
+#define CLUNK_SPATIAL_INDEX_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/types.h>
+#include <clunk/v3.h>
+#include <vector>
+
+namespace clunk {
+class Object;
+
+/*!
+	\brief Uniform grid of the objects.
+	Objects are moved between the cells from Object::set_position, so the context never sorts the whole world.
+	Query walks the grid in growing shells around the listener and returns objects ordered by distance, 
+	visiting only the cells needed to get the next nearest object.
+	Cells are slots of an open addressing table kept at most half full and objects are linked into them intrusively, 
+	so the table grows only when objects are inserted and moving objects around never allocates.
+*/
+
+class CLUNKAPI SpatialIndex {
+public:
+	typedef u64 key_type;
+
+	/*!
+		\brief constructor
+		\param[in] cell_size size of the grid cell. Use the distance where typical emitters are packed densely.
+	*/
+	SpatialIndex(float cell_size = 32);
+
+	///changes cell size and rebuilds grid
+	void set_cell_size(float cell_size);
+	float get_cell_size() const { return _cell_size; }
+
+	///adds object into the grid, may grow the table
+	void insert(Object *o);
+	///removes object from the grid, does nothing if the object is not indexed
+	void remove(Object *o);
+	///moves object to the new cell if needed, must be called after each position change
+	void update(Object *o);
+
+	///returns number of the indexed objects
+	size_t size() const { return _size; }
+
+	//!Incremental nearest-first traversal
+	class CLUNKAPI Query {
+	public:
+		typedef std::pair<float, Object *> candidate_type;
+		typedef std::vector<candidate_type> storage_type;
+
+		///storage is used for the candidates heap, pass the same one each time to avoid allocations
+		Query(const SpatialIndex &index, const v3f &center, storage_type &storage);
+		///returns next nearest object or NULL if all objects were visited
+		Object *next();
+
+	private:
+		void scan_shell();
+		void scan_cell(Object *head);
+
+		const SpatialIndex &_index;
+		v3f _center;
+		int _x, _y, _z;
+		int _radius;
+		size_t _scanned;
+		bool _exhausted;
+
+		storage_type &_candidates;
+	};
+
+private:
+	inline int cell(float v) const;
+	static key_type key(int x, int y, int z);
+	static int unpack(key_type key, int shift);
+
+	//returns slot of the cell with given key or the free slot it goes to
+	size_t find(key_type key) const;
+	//grows table to keep cells of the given number of objects at most half full
+	void grow(size_t objects);
+	//links object into the cell of its position
+	void link(Object *o);
+	//frees slot, shifting back the cells probed past it
+	void erase(size_t slot);
+
+	float _cell_size;
+	size_t _size;
+
+	//free slot has no objects
+	struct Cell {
+		key_type key;
+		Object *head;
+	};
+	//power of two slots, linear probing
+	typedef std::vector<Cell> cells_type;
+	cells_type _cells;
+	//occupied slots
+	size_t _used;
+};
+
+}
+
+#endif
@@ -35,9 +35,10 @@ class Buffer;
 
 /*! 
 	\brief Music/Ambient stream.
-	simple abstract class allowing you to play audio streams. Note that stream's methods will be called from the audio callback. 
-	Usually it's the different thread context and if you're using any global variables from the stream code, you need to protect it with mutex
-	or clunk::AudioLocker. 
+	simple abstract class allowing you to play audio streams. Note that stream's methods will be called from the audio callback 
+	or from the stream decoder threads (see Context::set_stream_threads), first chunk is read by Context::play itself. 
+	Usually it's the different thread context and if you're using any global variables from the stream code, you need to protect it with mutex.
+	clunk::AudioLocker protects you from the audio callback only. 
 */
 
 class CLUNKAPI Stream {
@@ -62,7 +63,7 @@ protected:
 	/*! initialize it from your open() method */
 	AudioSpec _spec;
 
-	friend class Context;
+	friend class StreamBuffer;
 };
 }
 
@@ -0,0 +1,281 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <clunk/stream_decoder.h>
+#include <clunk/stream.h>
+#include <clunk/resample.h>
+#include <clunk/resampler.h>
+#include <clunk/clunk_ex.h>
+#include <clunk/logger.h>
+#include <algorithm>
+#include <chrono>
+#include <assert.h>
+
+namespace clunk {
+
+StreamBuffer::StreamBuffer(const AudioSpec &spec, Stream *stream, bool loop, size_t depth, size_t low, size_t high, Resampler::Quality quality):
+	ring(depth), id(0), gain(1.0f), paused(false), decoder(NULL), underruns(NULL), next_stream(NULL), _spec(spec), _stream(stream), _loop(loop), _eos(false), _low(low), _high(std::min(depth, std::max(low, high))), 
+	_pending(&_chunk), _pending_offset(0), _head_raw(0), _head_size(0), _head_complete(false), _cached(false), _replay(false), _skip(0), _done(false),
+	_prev(NULL), _next(NULL), _busy(false), _retired(false), _incoming_next(NULL) {
+	if (stream->_spec.sample_rate != spec.sample_rate)
+		_resampler.init(stream->_spec.sample_rate, spec.sample_rate, spec.channels, quality);
+}
+
+StreamBuffer::~StreamBuffer() {
+	delete _stream;
+}
+
+bool StreamBuffer::starving(size_t need) const {
+	return !done() && ring.size() < std::max(need, _low);
+}
+
+void StreamBuffer::fill(size_t need) {
+	if (!starving(need))
+		return;
+
+	const unsigned frame_size = _spec.bytes_per_sample() * _spec.channels;
+	const size_t high = std::min(ring.capacity(), std::max(need, _high));
+	while(ring.size() < high) {
+		if (_pending_offset < _pending->get_size()) {
+			size_t n = std::min(_pending->get_size() - _pending_offset, ring.space());
+			n -= n % frame_size;
+			if (n == 0)
+				break;
+			ring.write(static_cast<const u8 *>(_pending->get_ptr()) + _pending_offset, n);
+			_pending_offset += n;
+		} else if (_eos) {
+			_done.store(true, std::memory_order_release);
+			break;
+		} else if (_replay) {
+			_replay = _cached;
+			if (converted()) {
+				convert(_head, false);
+				_pending = &_chunk;
+			} else 
+				_pending = &_head;
+			_pending_offset = 0;
+		} else 
+			read();
+	}
+}
+
+void StreamBuffer::read() {
+	_pending = &_chunk;
+	_pending_offset = 0;
+
+	bool eos = !_stream->read(_data, (unsigned)ring.space());
+	const size_t raw = _data.get_size();
+	if (_skip > 0) {
+		const size_t n = std::min(_skip, raw);
+		_data.pop(n);
+		_skip -= n;
+	}
+
+	//head keeps the stream data, converting it again on every replay runs the resampler through the loop point
+	if (_loop && !_head_complete) {
+		_head.append(_data);
+		_head_raw += raw;
+	}
+
+	if (converted()) {
+		convert(_data, eos && !_loop);
+	} else 
+		std::swap(_data, _chunk);
+	//LOG_DEBUG(("read %u bytes", (unsigned)_chunk.get_size()));
+
+	if (_loop && !_head_complete) {
+		_head_size += _chunk.get_size();
+		_head_complete = _head_size >= _high;
+	}
+
+	if (!eos)
+		return;
+
+	if (!_loop) {
+		_eos = true;
+	} else if (_head_complete) {
+		//loop start goes right after this chunk, stream resumes after it
+		_stream->rewind();
+		_skip = _head_raw;
+		_replay = true;
+	} else if (!_head.empty()) {
+		//whole stream is in the head
+		_cached = _replay = true;
+	} else {
+		//empty looped stream would spin here forever
+		_eos = true;
+	}
+}
+
+bool StreamBuffer::converted() const {
+	const AudioSpec &spec = _stream->_spec;
+	return spec.sample_rate != _spec.sample_rate || spec.channels != _spec.channels || spec.format != _spec.format;
+}
+
+void StreamBuffer::convert(const Buffer &src, bool last) {
+	const AudioSpec &spec = _stream->_spec;
+	if (spec.sample_rate == _spec.sample_rate) {
+		Resample::resample(_spec, _chunk, spec, src);
+		return;
+	}
+
+	Resampler::to_float(_float, _spec.channels, spec, src);
+	const size_t frames = _float.get_size() / sizeof(float) / _spec.channels;
+	_resampled.set_size(_resampler.max_output(frames) * _spec.channels * sizeof(float));
+	float *out = static_cast<float *>(_resampled.get_ptr());
+	size_t n = _resampler.process(out, static_cast<const float *>(_float.get_ptr()), frames);
+	if (last)
+		n += _resampler.flush(out + n * _spec.channels);
+	Resampler::from_float(_chunk, _spec, out, n);
+}
+
+StreamDecoder::StreamDecoder(): _running(false), _buffers(NULL), _incoming(NULL) {}
+
+StreamDecoder::~StreamDecoder() {
+	stop();
+	while(_buffers != NULL)
+		unlink(_buffers);
+}
+
+void StreamDecoder::start(unsigned threads) {
+	stop();
+	if (threads == 0)
+		return;
+
+	_running = true;
+	for(unsigned i = 0; i < threads; ++i)
+		_threads.push_back(std::thread(&StreamDecoder::main, this));
+}
+
+void StreamDecoder::stop() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running = false;
+	}
+	_wakeup.notify_all();
+	for(size_t i = 0; i < _threads.size(); ++i)
+		_threads[i].join();
+	_threads.clear();
+
+	adopt();
+	for(StreamBuffer *buffer = _buffers; buffer != NULL; ) {
+		StreamBuffer *next = buffer->_next;
+		if (buffer->_retired) {
+			unlink(buffer);
+			TRY {
+				delete buffer;
+			} CATCH("deleting stream", {});
+		}
+		buffer = next;
+	}
+}
+
+void StreamDecoder::remove(StreamBuffer *buffer) {
+	assert(_threads.empty());
+	adopt();
+	unlink(buffer);
+}
+
+void StreamDecoder::unlink(StreamBuffer *buffer) {
+	if (buffer->_prev != NULL)
+		buffer->_prev->_next = buffer->_next;
+	else 
+		_buffers = buffer->_next;
+	if (buffer->_next != NULL)
+		buffer->_next->_prev = buffer->_prev;
+	buffer->_prev = buffer->_next = NULL;
+}
+
+void StreamDecoder::adopt() {
+	StreamBuffer *buffer = _incoming.exchange(NULL, std::memory_order_acquire);
+	while(buffer != NULL) {
+		StreamBuffer *next = buffer->_incoming_next;
+		buffer->_incoming_next = NULL;
+		buffer->_prev = NULL;
+		buffer->_next = _buffers;
+		if (_buffers != NULL)
+			_buffers->_prev = buffer;
+		_buffers = buffer;
+		buffer = next;
+	}
+}
+
+void StreamDecoder::add(StreamBuffer *buffer) {
+	buffer->_retired.store(false, std::memory_order_relaxed);
+	StreamBuffer *head = _incoming.load(std::memory_order_relaxed);
+	do {
+		buffer->_incoming_next = head;
+	} while(!_incoming.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+	_wakeup.notify_one();
+}
+
+void StreamDecoder::retire(StreamBuffer *buffer) {
+	buffer->_retired.store(true, std::memory_order_release);
+	_wakeup.notify_one();
+}
+
+void StreamDecoder::wake() {
+	_wakeup.notify_one();
+}
+
+void StreamDecoder::main() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(_running) {
+		adopt();
+		StreamBuffer *job = NULL;
+		for(StreamBuffer *buffer = _buffers; buffer != NULL; buffer = buffer->_next) {
+			if (!buffer->_busy && (buffer->_retired || buffer->starving())) {
+				job = buffer;
+				break;
+			}
+		}
+		if (job == NULL) {
+			//notifications from the audio thread are not synchronized with the mutex, poll in case one is missed
+			_wakeup.wait_for(lock, std::chrono::milliseconds(5));
+			continue;
+		}
+
+		if (job->_retired) {
+			unlink(job);
+			lock.unlock();
+			TRY {
+				delete job;
+			} CATCH("deleting stream", {});
+			lock.lock();
+			continue;
+		}
+
+		job->_busy = true;
+		lock.unlock();
+		TRY {
+			job->fill();
+		} CATCH("decoding stream", {
+			job->_eos = true;
+			job->_done.store(true, std::memory_order_release);
+		});
+		lock.lock();
+		job->_busy = false;
+	}
+}
+
+}
@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef CLUNK_STREAM_DECODER_H__
+#define CLUNK_STREAM_DECODER_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/audio_spec.h>
+#include <clunk/buffer.h>
+#include <clunk/resampler.h>
+#include <clunk/ring_buffer.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace clunk {
+
+class Stream;
+class StreamDecoder;
+
+/*!
+	\brief Stream with its ring of decoded samples in the output format.
+	Producer side (fill) runs either in the audio callback or on the StreamDecoder thread, 
+	consumer side (ring and done()) is the mixer.
+	Looped streams keep their first high watermark worth of samples, so the loop start is always 
+	decoded before the stream is rewound, and streams fitting into it are never rewound at all.
+	Sample rate is converted by one Resampler for the whole stream, so chunk edges and loop points keep its phase and history.
+*/
+class CLUNKAPI StreamBuffer {
+public:
+	/*!
+		\param[in] spec output format
+		\param[in] stream stream object, owned by the buffer from now on
+		\param[in] loop auto rewind stream after it ends
+		\param[in] depth ring size, bytes
+		\param[in] low stream is decoded when buffered data drops below this level, bytes
+		\param[in] high decoding stops when buffered data reaches this level, bytes
+		\param[in] quality resampler preset used if the stream has different sample rate
+	*/
+	StreamBuffer(const AudioSpec &spec, Stream *stream, bool loop, size_t depth, size_t low, size_t high, Resampler::Quality quality = Resampler::Medium);
+	~StreamBuffer();
+
+	///decodes stream up to the high watermark if it has less than low watermark or need bytes buffered
+	void fill(size_t need = 0);
+	///returns true if fill() has something to do
+	bool starving(size_t need = 0) const;
+	///returns true if stream has ended and all its data is in the ring
+	bool done() const { return _done.load(std::memory_order_acquire); }
+
+	RingBuffer ring;
+
+	//mixer state, owned by the context, so playing a stream allocates nothing in the callback
+	int id;
+	float gain;
+	bool paused;
+	//decoder filling it in background, NULL if the context fills it in the callback
+	StreamDecoder *decoder;
+	//underrun counter of the stream id, lives in the context
+	std::atomic<unsigned> *underruns;
+	//next stream mixed by the context, sorted by id
+	StreamBuffer *next_stream;
+
+private:
+	StreamBuffer(const StreamBuffer &);
+	const StreamBuffer& operator=(const StreamBuffer &);
+
+	//reads next chunk from the stream
+	void read();
+	//returns true if stream data differs from the output format
+	bool converted() const;
+	//converts stream data into _chunk, last chunk of the stream flushes the resampler
+	void convert(const Buffer &src, bool last);
+
+	friend class StreamDecoder;
+
+	AudioSpec _spec;
+	Stream *_stream;
+	bool _loop, _eos;
+	size_t _low, _high;
+	//data read from the stream and the same data converted to the output format
+	Buffer _data, _chunk;
+	//data written into the ring next: _chunk or _head
+	const Buffer *_pending;
+	size_t _pending_offset;
+	//loop start in the stream format, number of stream bytes it was read from and its size in the output format
+	Buffer _head;
+	size_t _head_raw, _head_size;
+	//sample rate conversion state and its float buffers
+	Resampler _resampler;
+	Buffer _float, _resampled;
+	//loop start is decoded up to the high watermark / whole stream fits into it / it goes next
+	bool _head_complete, _cached, _replay;
+	//stream bytes to drop after rewind, they're in the head already
+	size_t _skip;
+	std::atomic<bool> _done;
+
+	//decoder bookkeeping, guarded by its mutex
+	StreamBuffer *_prev, *_next;
+	bool _busy;
+	//set by the audio thread without the decoder mutex
+	std::atomic<bool> _retired;
+	//link in the list of buffers handed over to the decoder
+	StreamBuffer *_incoming_next;
+};
+
+/*!
+	\brief Pool of background threads keeping stream buffers topped up to their high watermark.
+	Audio thread only adds and retires buffers, so reading, rewinding and deleting of the streams 
+	never happens in the callback. Retired buffers are deleted by the decoder.
+	Neither add() nor retire() takes the decoder mutex: added buffers go to a lock-free list 
+	the decoding threads pick up on their next poll.
+	Stopped decoder keeps the buffers which were not retired until they're removed, so the context can stop it 
+	outside of the audio lock and hand the buffers over afterwards.
+*/
+class CLUNKAPI StreamDecoder {
+public:
+	StreamDecoder();
+	~StreamDecoder();
+
+	///starts decoding threads, 0 stops them
+	void start(unsigned threads);
+	///stops all threads and deletes retired buffers. Buffers which were not retired stay until remove() or destruction.
+	void stop();
+	///returns number of threads
+	unsigned size() const { return (unsigned)_threads.size(); }
+	///takes buffer which was not retired back from the stopped decoder
+	void remove(StreamBuffer *buffer);
+
+	///starts decoding buffer in background, lock-free
+	void add(StreamBuffer *buffer);
+	///stops decoding buffer and deletes it as soon as possible, lock-free
+	void retire(StreamBuffer *buffer);
+	///wakes decoding threads up
+	void wake();
+
+private:
+	StreamDecoder(const StreamDecoder &);
+	const StreamDecoder& operator=(const StreamDecoder &);
+
+	void main();
+	void unlink(StreamBuffer *buffer);
+	//moves buffers handed over by add() into the list, mutex must be held
+	void adopt();
+
+	std::vector<std::thread>	_threads;
+	std::mutex					_mutex;
+	std::condition_variable		_wakeup;
+	bool						_running;
+	//intrusive list of buffers, no allocations in add/retire
+	StreamBuffer				*_buffers;
+	//buffers added by the audio thread and not yet adopted, linked by _incoming_next
+	std::atomic<StreamBuffer *>	_incoming;
+};
+
+}
+
+#endif
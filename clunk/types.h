@@ -39,10 +39,12 @@ namespace clunk
 	typedef uint8_t		u8;
 	typedef uint16_t	u16;
 	typedef uint32_t	u32;
+	typedef uint64_t	u64;
 
 	typedef int8_t		s8;
 	typedef int16_t		s16;
 	typedef int32_t		s32;
+	typedef int64_t		s64;
 }
 
 #if !(defined(__GNUC__) || defined(__GNUG__) || defined(__attribute__))
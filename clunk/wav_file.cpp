@@ -112,10 +112,10 @@ namespace clunk {
 		return wav.release();
 	}
 
-	Sample * WavFile::load(Context &context, const std::string &fname) {
+	Sample * WavFile::load(Context &context, const std::string &fname, Sample::Storage storage) {
 		std::unique_ptr<WavFile> wav(load(fname));
 		std::unique_ptr<Sample> sample(context.create_sample());
-		sample->init(wav->_data, wav->_spec);
+		sample->init(wav->_data, wav->_spec, storage);
 		sample->name = fname;
 		return sample.release();
 	}
@@ -0,0 +1,172 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <clunk/worker_pool.h>
+#include <clunk/clunk_ex.h>
+#include <clunk/logger.h>
+#include <chrono>
+
+#ifdef _WINDOWS
+#	include <windows.h>
+#elif defined(__linux__)
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+using namespace clunk;
+
+namespace {
+	inline u32 generation_of(u64 next) { return (u32)(next >> 32); }
+
+	void pin_thread(std::thread &thread, unsigned cpu) {
+		unsigned cpus = std::thread::hardware_concurrency();
+		if (cpus > 0)
+			cpu %= cpus;
+#ifdef _WINDOWS
+		if (SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpu) == 0)
+			LOG_ERROR(("SetThreadAffinityMask(%u) failed", cpu));
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0)
+			LOG_ERROR(("pthread_setaffinity_np(%u) failed", cpu));
+#else
+		LOG_ERROR(("thread pinning is not supported on this platform"));
+#endif
+	}
+}
+
+WorkerPool::WorkerPool(): _sleeping(0), _stop(false), _spin(0), _next(0), _done(0) {
+	for(unsigned i = 0; i < 2; ++i) {
+		_jobs[i].job.store(NULL, std::memory_order_relaxed);
+		_jobs[i].arg.store(NULL, std::memory_order_relaxed);
+		_jobs[i].tasks.store(0, std::memory_order_relaxed);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	stop();
+}
+
+void WorkerPool::start(unsigned threads, bool pin, unsigned spin) {
+	stop();
+	_spin = spin;
+	_stop = false;
+	for(unsigned i = 1; i < threads; ++i) {
+		_threads.push_back(std::thread(&WorkerPool::main, this, i));
+		if (pin)
+			pin_thread(_threads.back(), i);
+	}
+	LOG_DEBUG(("started %u worker threads", (unsigned)_threads.size()));
+}
+
+void WorkerPool::stop() {
+	if (_threads.empty())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wakeup.notify_all();
+	for(size_t i = 0; i < _threads.size(); ++i)
+		_threads[i].join();
+	_threads.clear();
+}
+
+void WorkerPool::run(job_type job, void *arg, unsigned tasks) {
+	if (tasks == 0)
+		return;
+
+	if (_threads.empty()) {
+		for(unsigned i = 0; i < tasks; ++i)
+			job(arg, i);
+		return;
+	}
+
+	//helpers late for the previous generation still read its descriptor, the new one goes to the other slot and is published by _next
+	u32 generation = generation_of(_next.load(std::memory_order_relaxed)) + 1;
+	Job &current = _jobs[generation & 1];
+	current.job.store(job, std::memory_order_relaxed);
+	current.arg.store(arg, std::memory_order_relaxed);
+	current.tasks.store(tasks, std::memory_order_relaxed);
+	_done.store(0, std::memory_order_relaxed);
+	//seq_cst store and load pair with the ones in main: either the helper going to sleep sees the new generation or we see it counted in _sleeping
+	_next.store((u64)generation << 32, std::memory_order_seq_cst);
+	if (_sleeping.load(std::memory_order_seq_cst) > 0) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_wakeup.notify_all();
+	}
+
+	work(generation);
+
+	while(_done.load(std::memory_order_acquire) < tasks)
+		std::this_thread::yield();
+}
+
+void WorkerPool::work(u32 generation) {
+	/*
+		descriptor of the generation is only rewritten two generations later, which needs all its tasks finished. 
+		Stale reads are harmless: _next has moved on then, so the claim fails.
+	*/
+	const Job &current = _jobs[generation & 1];
+	u64 next = _next.load(std::memory_order_acquire);
+	while(generation_of(next) == generation && (u32)next < current.tasks.load(std::memory_order_relaxed)) {
+		if (!_next.compare_exchange_weak(next, next + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+			continue;
+
+		TRY {
+			current.job.load(std::memory_order_relaxed)(current.arg.load(std::memory_order_relaxed), (u32)next);
+		} CATCH("worker", {});
+		_done.fetch_add(1, std::memory_order_release);
+		next = _next.load(std::memory_order_acquire);
+	}
+}
+
+void WorkerPool::main(unsigned index) {
+	u32 generation = generation_of(_next.load());
+	while(!_stop.load()) {
+		//spinning for the next job keeps wake-up latency low
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(_spin);
+		unsigned iterations = 0;
+		while(generation_of(_next.load(std::memory_order_acquire)) == generation && !_stop.load(std::memory_order_relaxed)) {
+			if ((++iterations & 0xff) == 0 && std::chrono::steady_clock::now() >= deadline)
+				break;
+		}
+
+		if (generation_of(_next.load()) == generation) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			//seq_cst increment and load, see run
+			_sleeping.fetch_add(1, std::memory_order_seq_cst);
+			while(generation_of(_next.load(std::memory_order_seq_cst)) == generation && !_stop.load())
+				_wakeup.wait(lock);
+			--_sleeping;
+		}
+		if (_stop.load())
+			break;
+
+		generation = generation_of(_next.load(std::memory_order_acquire));
+		work(generation);
+	}
+}
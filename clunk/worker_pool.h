@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2008-2019 Netive Media Group & Vladimir Menshakov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLUNK_WORKER_POOL_H__
+#define CLUNK_WORKER_POOL_H__
+
+#include <clunk/export_clunk.h>
+#include <clunk/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace clunk {
+
+/*!
+	\brief Pool of worker threads used by the audio callback.
+	Calling thread always takes part in the work, so the pool of N threads starts N - 1 helper threads. 
+	Tasks are claimed dynamically: if some helper is still waking up, calling thread takes its tasks, 
+	so wake-up latency never stalls the callback for longer than a single task.
+	Helpers spin for a while after each job before going to sleep on the condition variable.
+*/
+
+class CLUNKAPI WorkerPool {
+public:
+	///job function, called once per task index from any thread of the pool
+	typedef void (*job_type)(void *arg, unsigned task);
+
+	WorkerPool();
+	~WorkerPool();
+
+	/*!
+		\brief starts worker threads
+		\param[in] threads total number of threads including calling one. 0 or 1 disables the pool.
+		\param[in] pin pins helper threads to the cpu cores (1, 2, ...) leaving core 0 for the audio thread.
+		\param[in] spin time in microseconds helpers spin waiting for the next job before going to sleep.
+	*/
+	void start(unsigned threads, bool pin = false, unsigned spin = 500);
+	///stops all helper threads
+	void stop();
+
+	///returns total number of threads including calling one
+	unsigned size() const { return (unsigned)_threads.size() + 1; }
+
+	///runs tasks [0, tasks) and returns when all of them are finished
+	void run(job_type job, void *arg, unsigned tasks);
+
+private:
+	WorkerPool(const WorkerPool &);
+	const WorkerPool& operator=(const WorkerPool &);
+
+	void main(unsigned index);
+	//claims and executes tasks of the given generation, returns when there's nothing left
+	void work(u32 generation);
+
+	std::vector<std::thread>	_threads;
+	std::mutex					_mutex;
+	std::condition_variable		_wakeup;
+	std::atomic<unsigned>		_sleeping;
+	std::atomic<bool>			_stop;
+	unsigned					_spin;
+
+	//job of one generation, published by the release store of _next
+	struct Job {
+		std::atomic<job_type>	job;
+		std::atomic<void *>		arg;
+		std::atomic<unsigned>	tasks;
+	};
+
+	//generation in the high 32 bits, next task index in the low ones
+	std::atomic<u64>			_next;
+	std::atomic<unsigned>		_done;
+	//descriptors of odd and even generations
+	Job							_jobs[2];
+};
+
+}
+
+#endif
@@ -1,49 +1,53 @@
 #!/usr/bin/env python
 
+#converts MIT KEMAR measurements ("full" set, big endian 16 bit .dat files) to the compiled in tables (kemar.c, kemar.h)
+#and/or to the binary dataset loaded by clunk::Context::set_hrtf_dataset:
+#	import.py [--source full] [--rate 44100] [--no-c] [--binary kemar.hrtf]
+
+from __future__ import print_function
+
 import re
 import os
 import os.path
 import struct
-from numpy.fft import rfft
+import sys
 
 file_re = re.compile(r"([LR])(\-?\d+).*e(\d+)a.dat", re.IGNORECASE)
 
-kemar = {}
-
-for dirpath, _dn, files in os.walk("full"):
-	for fname in files:
-		#print dirpath, fname
-		m = file_re.match(fname)
-		if not m:
-			continue
-
-		fname = os.path.join(dirpath, fname)
-
-		mic = {'L': 0, 'R': 1}[m.group(1).upper()]
-		elev = int(m.group(2))
-		az = int(m.group(3))
-
-		with open(fname, "rb") as f:
-			data = f.read()
-		#print "Read %d" %len(data)
-		data = struct.unpack(">512h", data)
-		sdata = []
-		for i in xrange(0, len(data)):
-			sdata.append(0)
-		for i in xrange(0, len(data)):
-			sdata.append(data[i] / 32768.0)
-		data = rfft(sdata)
-		if elev not in kemar:
-			kemar[elev] = {az: {mic: data}}
-			continue
-
-		if az not in kemar[elev]:
-			kemar[elev][az] = {mic: data}
-			continue
-
-		kemar[elev][az][mic] = data
-
-header = """#ifndef CLUNK_KEMAR_H
+POINTS = 513
+
+def read_mit(source):
+	from numpy.fft import rfft
+
+	kemar = {}
+	for dirpath, _dn, files in os.walk(source):
+		for fname in files:
+			#print dirpath, fname
+			m = file_re.match(fname)
+			if not m:
+				continue
+
+			fname = os.path.join(dirpath, fname)
+
+			mic = {'L': 0, 'R': 1}[m.group(1).upper()]
+			elev = int(m.group(2))
+			az = int(m.group(3))
+
+			with open(fname, "rb") as f:
+				data = f.read()
+			#print "Read %d" %len(data)
+			data = struct.unpack(">512h", data)
+			sdata = []
+			for i in range(0, len(data)):
+				sdata.append(0)
+			for i in range(0, len(data)):
+				sdata.append(data[i] / 32768.0)
+			data = rfft(sdata)
+			kemar.setdefault(elev, {}).setdefault(az, {})[mic] = data
+	return kemar
+
+def write_c(kemar):
+	header = """#ifndef CLUNK_KEMAR_H
 #define CLUNK_KEMAR_H
 
 /*
@@ -63,15 +67,14 @@ extern "C" {
 /* DO NOT EDIT THIS HEADER, IT'S AUTOGENERATED */
 """
 
-print "found %d elevation angles" %len(kemar)
-eangles = sorted(kemar.iterkeys())
-header += "static const int KemarMinElevation = %d;\n" % min(eangles)
-header += "static const int KemarMaxElevation = %d;\n" % max(eangles)
-header += "static const int KemarElevationCount = %d;\n" % len(eangles)
-header += "static const int KemarElevationStep = %d;\n" % ((max(eangles) - min(eangles)) / (len(eangles) - 1))
-header += "static const unsigned KemarPoints = 513;\n"
+	eangles = sorted(kemar.keys())
+	header += "static const int KemarMinElevation = %d;\n" % min(eangles)
+	header += "static const int KemarMaxElevation = %d;\n" % max(eangles)
+	header += "static const int KemarElevationCount = %d;\n" % len(eangles)
+	header += "static const int KemarElevationStep = %d;\n" % ((max(eangles) - min(eangles)) // (len(eangles) - 1))
+	header += "static const unsigned KemarPoints = %d;\n" % POINTS
 
-header += """
+	header += """
 struct kemar_elevation_data {
 	int elevation;
 	unsigned samples;
@@ -79,9 +82,9 @@ struct kemar_elevation_data {
 };
 
 """
-header += "extern struct kemar_elevation_data kemar_data[14];\n"
+	header += "extern struct kemar_elevation_data kemar_data[%d];\n" % len(eangles)
 
-header += """
+	header += """
 #ifdef __cplusplus
 }
 #endif
@@ -89,43 +92,102 @@ header += """
 #endif
 """
 
-with open("kemar.h", "wb") as f:
-	f.write(header)
+	with open("kemar.h", "w") as f:
+		f.write(header)
 
-source = """#include "kemar.h"
+	source = """#include "kemar.h"
 
 """
 
-epilogue = """
+	epilogue = """
 struct kemar_elevation_data kemar_data[%d] =
 {
 """ %len(eangles)
 
-for elev, az_dict in sorted(kemar.iteritems()):
-	print "elevation %d, items: %d" %(elev, len(az_dict))
-	array_name = "elev_%s" %(elev if elev >= 0 else ("m%d" % -elev))
-	source += """static const float %s[][2][513][2] =
+	for elev, az_dict in sorted(kemar.items()):
+		print("elevation %d, items: %d" %(elev, len(az_dict)))
+		array_name = "elev_%s" %(elev if elev >= 0 else ("m%d" % -elev))
+		source += """static const float %s[][2][513][2] =
 {
 """ %array_name
 
-	for az, mic_n_data in sorted(az_dict.iteritems()):
-		data0 = ""
-		data1 = ""
-		for a in mic_n_data[0]:
-			data0 += "{%g, %g}, " %(float(a.real), float(a.imag))
-		for a in mic_n_data[1]:
-			data1 += "{%g, %g}, " %(float(a.real), float(a.imag))
-		source += """	/* azimuth = %d */
+		for az, mic_n_data in sorted(az_dict.items()):
+			data0 = ""
+			data1 = ""
+			for a in mic_n_data[0]:
+				data0 += "{%g, %g}, " %(float(a.real), float(a.imag))
+			for a in mic_n_data[1]:
+				data1 += "{%g, %g}, " %(float(a.real), float(a.imag))
+			source += """	/* azimuth = %d */
 	{
 		{%s},
 		{%s}
 	},
 """ %(az, data0, data1)
-	source += "};\n"
-	epilogue += "\t{%4d, %4d, %10s },\n" %(elev, len(az_dict), array_name)
+		source += "};\n"
+		epilogue += "\t{%4d, %4d, %10s },\n" %(elev, len(az_dict), array_name)
 
-epilogue += """};
+	epilogue += """};
 """
 
-with open("kemar.c", "wb") as f:
-	f.write(source + epilogue)
+	with open("kemar.c", "w") as f:
+		f.write(source + epilogue)
+
+#layout of clunk::HrtfDataset::FileHeader, Row and the data, all little endian
+MAGIC = b"CLUNKHRT"
+VERSION = 1
+EARS = 2
+HEADER = "<8s8I"
+ROW = "<iIII"
+DATA_ALIGNMENT = 64
+
+def write_binary(fname, kemar, sample_rate):
+	rows = []
+	directions = 0
+	for elev, az_dict in sorted(kemar.items()):
+		rows.append(struct.pack(ROW, elev, len(az_dict), directions, 0))
+		directions += len(az_dict)
+
+	data_offset = struct.calcsize(HEADER) + len(rows) * struct.calcsize(ROW)
+	data_offset = (data_offset + DATA_ALIGNMENT - 1) // DATA_ALIGNMENT * DATA_ALIGNMENT
+
+	with open(fname, "wb") as f:
+		f.write(struct.pack(HEADER, MAGIC, VERSION, sample_rate, POINTS, EARS, len(rows), directions, data_offset, 0))
+		for row in rows:
+			f.write(row)
+		f.write(b"\0" * (data_offset - f.tell()))
+		for elev, az_dict in sorted(kemar.items()):
+			for az, mic_n_data in sorted(az_dict.items()):
+				for mic in range(EARS):
+					if mic not in mic_n_data:
+						raise Exception("elevation %d, azimuth %d has no response for the ear %d" %(elev, az, mic))
+					values = []
+					for a in mic_n_data[mic]:
+						values += [float(a.real), float(a.imag)]
+					if len(values) != 2 * POINTS:
+						raise Exception("elevation %d, azimuth %d has %d points" %(elev, az, len(values) // 2))
+					f.write(struct.pack("<%df" % len(values), *values))
+	print("wrote %d directions to %s" %(directions, fname))
+
+if __name__ == "__main__":
+	source, sample_rate, c, binary = "full", 44100, True, None
+	args = sys.argv[1:]
+	while args:
+		arg = args.pop(0)
+		if arg == "--source":
+			source = args.pop(0)
+		elif arg == "--rate":
+			sample_rate = int(args.pop(0))
+		elif arg == "--no-c":
+			c = False
+		elif arg == "--binary":
+			binary = args.pop(0)
+		else:
+			sys.exit("usage: %s [--source full] [--rate 44100] [--no-c] [--binary kemar.hrtf]" % sys.argv[0])
+
+	kemar = read_mit(source)
+	print("found %d elevation angles" %len(kemar))
+	if c:
+		write_c(kemar)
+	if binary:
+		write_binary(binary, kemar, sample_rate)
@@ -23,17 +23,33 @@ SOFTWARE.
 */
 
 #include <clunk/context.h>
-#include <clunk/backend/sdl/backend.h>
+#ifdef CLUNK_BACKEND_SDL
+#	include <clunk/backend/sdl/backend.h>
+#endif
+#include <clunk/backend/offline/backend.h>
 #include <clunk/source.h>
+#include <clunk/stream.h>
 #include <clunk/wav_file.h>
+#include <clunk/allocation_hook.h>
 #include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <string>
 #ifdef _WINDOWS
 #	include <Windows.h>
 #	define usleep(us) ::Sleep(((us) + 999) / 1000)
 #else
 #	include <unistd.h>
 #endif
+#include <clunk/mdct_context.h>
 #include <clunk/ref_mdct_context.h>
+#include <clunk/window_function.h>
+#include <clunk/cpu_features.h>
+#include <clunk/mixer.h>
+#include <clunk/resample.h>
+#include <clunk/resampler.h>
 
 #define WINDOW_BITS 9
 
@@ -87,6 +103,349 @@ struct mdct_test {
 	}
 };
 
+//relative error of the fft against direct dft and of the round trip
+template<int BITS>
+float fft_check() {
+	typedef clunk::fft_context<BITS, float> fft_type;
+	fft_type fft;
+	std::complex<double> input[fft_type::N];
+	for(int i = 0; i < fft_type::N; ++i) {
+		input[i] = std::complex<double>((rand() % 2001 - 1000) / 1000.0, (rand() % 2001 - 1000) / 1000.0);
+		fft.data[i] = std::complex<float>(input[i]);
+	}
+	fft.fft();
+	double error = 0, norm = 0;
+	for(int k = 0; k < fft_type::N; ++k) {
+		std::complex<double> sum;
+		for(int i = 0; i < fft_type::N; ++i)
+			sum += input[i] * std::polar(1.0, -2 * M_PI * i * k / fft_type::N);
+		error = std::max(error, std::abs(sum - std::complex<double>(fft.data[k])));
+		norm = std::max(norm, std::abs(sum));
+	}
+	fft.ifft();
+	for(int i = 0; i < fft_type::N; ++i)
+		error = std::max(error, std::abs(input[i] - std::complex<double>(fft.data[i])) * fft_type::N);
+	return (float)(error / norm);
+}
+
+//mdct and imdct of the fixed input, their result is compared between the kernels
+void mdct_run(float *result) {
+	mdct_type mdct;
+	srand(1);
+	for(int i = 0; i < mdct_type::N; ++i)
+		mdct.data[i] = (rand() % 2001 - 1000) / 1000.0f;
+	mdct.apply_window();
+	mdct.mdct();
+	std::copy(mdct.data, mdct.data + mdct_type::M, result);
+	mdct.imdct();
+	std::copy(mdct.data, mdct.data + mdct_type::N, result + mdct_type::M);
+}
+
+//rms of the difference from the unit sine of the given frequency at the output rate, relative to the sine, skipping the filter edges
+static float sine_error(const float *data, size_t frames, unsigned channels, double freq, unsigned rate) {
+	double error = 0, norm = 0;
+	for(size_t i = 256; i + 256 < frames; ++i) {
+		const double v = sin(2 * M_PI * freq * i / rate);
+		error += (data[i * channels] - v) * (data[i * channels] - v);
+		norm += 0.5;
+	}
+	return norm > 0? (float)(10 * log10(error / norm + 1e-20)): 0;
+}
+
+//stereo sine of the given frequency
+static void sine(clunk::Buffer &data, size_t frames, double freq, unsigned rate) {
+	data.set_size(frames * 2 * sizeof(float));
+	float *dst = static_cast<float *>(data.get_ptr());
+	for(size_t i = 0; i < frames; ++i)
+		dst[2 * i] = dst[2 * i + 1] = (float)sin(2 * M_PI * freq * i / rate);
+}
+
+//throughput of the stereo conversion fed in 1024 frames chunks, error of the passband sine and level of the tone between the output and the input nyquist frequencies
+static void resampler_bench(const char *name, clunk::Resampler::Quality quality, unsigned src_rate, unsigned dst_rate, float seconds) {
+	clunk::Resampler resampler;
+	resampler.init(src_rate, dst_rate, 2, quality);
+	const size_t frames = (size_t)(seconds * src_rate);
+	const double freq = 0.2 * std::min(src_rate, dst_rate);
+	clunk::Buffer input, output;
+	sine(input, frames, freq, src_rate);
+	output.set_size(resampler.max_output(frames) * 2 * sizeof(float));
+	const float *src = static_cast<const float *>(input.get_ptr());
+	float *dst = static_cast<float *>(output.get_ptr());
+
+	auto start = std::chrono::steady_clock::now();
+	size_t n = 0;
+	for(size_t i = 0; i < frames; i += 1024)
+		n += resampler.process(dst + 2 * n, src + 2 * i, std::min<size_t>(1024, frames - i));
+	n += resampler.flush(dst + 2 * n);
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	float error = sine_error(dst, n, 2, freq, dst_rate);
+
+	float alias = 0;
+	if (src_rate > dst_rate) {
+		clunk::Buffer tone, result;
+		sine(tone, frames / 4, 0.25 * (src_rate + dst_rate), src_rate);
+		clunk::Resampler::resample(result, tone, 2, src_rate, dst_rate, quality);
+		alias = sine_error(static_cast<const float *>(result.get_ptr()), result.get_size() / 2 / sizeof(float), 2, 0, dst_rate);
+	}
+	printf("%-8s %-6s %5u -> %5u: %7.1f Mframes/s (%5.0fx realtime), %u taps, sine error %6.1f dB", name, 
+		quality == clunk::Resampler::Fast? "fast": quality == clunk::Resampler::Medium? "medium": "best", src_rate, dst_rate, 
+		n / elapsed / 1e6, n / elapsed / dst_rate, resampler.taps(), error);
+	if (src_rate > dst_rate)
+		printf(", alias %6.1f dB", alias);
+	printf("\n");
+}
+
+//per sample template mixer the kernels are compared against. op: 0 - add, 1 - sub, 2 - adjust volume
+template<int Format>
+static void generic_mix(int op, void *dst, const void *src, size_t size, int volume) {
+	typedef clunk::AudioFormat<Format> F;
+	if (op == 0)
+		clunk::impl::Mixer<F>::mix(dst, src, size, volume);
+	else if (op == 1)
+		clunk::impl::Mixer<F, false>::mix(dst, src, size, volume);
+	else
+		clunk::impl::Mixer<F>::adjust(dst, size, volume);
+}
+
+//throughput of the integer mixer on 4096 bytes periods, mismatches of the dispatched kernel against the per sample mixer
+static void mixer_bench(const char *name, clunk::AudioSpec::Format format, int op, int volume, bool generic) {
+	static const char *formats[] = { "s8", "u8", "s16", "u16" }, *ops[] = { "add", "sub", "adjust" };
+	const size_t size = 4096;
+	std::vector<unsigned char> src(size), dst(size), result(size), expected(size);
+	for(size_t i = 0; i < size; ++i) {
+		src[i] = (unsigned char)rand();
+		dst[i] = (unsigned char)rand();
+	}
+	void (*mix)(int, void *, const void *, size_t, int) = format == clunk::AudioSpec::S8? &generic_mix<clunk::AudioSpec::S8>: 
+		format == clunk::AudioSpec::U8? &generic_mix<clunk::AudioSpec::U8>: &generic_mix<clunk::AudioSpec::S16>;
+
+	expected = dst;
+	mix(op, expected.data(), src.data(), size, volume);
+	const int runs = 200000;
+	auto start = std::chrono::steady_clock::now();
+	for(int r = 0; r <= runs; ++r) {
+		if (r == 1)
+			start = std::chrono::steady_clock::now();
+		if (r == 0 || op == 2)
+			result = dst;
+		if (generic)
+			mix(op, result.data(), src.data(), size, volume);
+		else if (op == 0)
+			clunk::Mixer::mix(format, result.data(), src.data(), size, volume);
+		else if (op == 1)
+			clunk::Mixer::sub(format, result.data(), src.data(), size, volume);
+		else
+			clunk::Mixer::adjust_volume(format, result.data(), size, volume);
+		if (r == 0) {
+			size_t mismatches = 0;
+			for(size_t i = 0; i < size; ++i)
+				mismatches += result[i] != expected[i];
+			printf("%-8s %-3s %-6s volume %3d: ", name, formats[format], ops[op], volume);
+			if (mismatches)
+				printf("%u bytes differ from the per sample mixer, ", (unsigned)mismatches);
+		}
+		clunk::Buffer::unoptimize(result.data(), result.size());
+	}
+	float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	printf("%7.1f MB/s\n", runs * size / elapsed / 1e6);
+}
+
+//throughput of the float bus mixer and the output conversion of the context, mismatches against FloatMixer
+static void float_mixer_bench(const char *name, unsigned channels, bool generic) {
+	typedef clunk::impl::FloatMixer<clunk::AudioFormat<clunk::AudioSpec::S16> > scalar_type;
+	static const char *ops[] = { "mix", "convert" };
+	//odd length runs the tails of the kernels, bus goes beyond full scale to be clipped
+	const size_t n = 1023;
+	std::vector<clunk::s16> src(n * channels), result(n * channels), expected(n * channels);
+	std::vector<float> bus(n * channels), mixed(n * channels), reference(n * channels);
+	float *bus_ptr[2], *mixed_ptr[2], *reference_ptr[2];
+	for(size_t i = 0; i < n * channels; ++i) {
+		src[i] = (clunk::s16)rand();
+		bus[i] = 3.0f * rand() / RAND_MAX - 1.5f;
+	}
+	for(unsigned c = 0; c < channels; ++c) {
+		bus_ptr[c] = bus.data() + c * n;
+		mixed_ptr[c] = mixed.data() + c * n;
+		reference_ptr[c] = reference.data() + c * n;
+	}
+	reference = bus;
+	scalar_type::mix(reference_ptr, channels, src.data(), n, 0.7f);
+	scalar_type::convert(expected.data(), bus_ptr, channels, n);
+
+	for(int op = 0; op < 2; ++op) {
+		const int runs = 200000;
+		auto start = std::chrono::steady_clock::now();
+		for(int r = 0; r <= runs; ++r) {
+			if (r == 1)
+				start = std::chrono::steady_clock::now();
+			if (op == 0) {
+				if (r == 0)
+					mixed = bus;
+				if (generic)
+					scalar_type::mix(mixed_ptr, channels, src.data(), n, 0.7f);
+				else
+					clunk::Mixer::mix(clunk::AudioSpec::S16, mixed_ptr, channels, src.data(), n, 0.7f);
+				clunk::Buffer::unoptimize(mixed.data(), mixed.size() * sizeof(float));
+			} else {
+				if (generic)
+					scalar_type::convert(result.data(), bus_ptr, channels, n);
+				else
+					clunk::Mixer::convert(clunk::AudioSpec::S16, result.data(), bus_ptr, channels, n);
+				clunk::Buffer::unoptimize(result.data(), result.size() * sizeof(clunk::s16));
+			}
+			if (r > 0)
+				continue;
+			printf("%-8s float %-7s %u channels: ", name, ops[op], channels);
+			//fused multiply-add of avx2 may round the mix differently
+			float error = 0;
+			size_t mismatches = 0;
+			for(size_t i = 0; i < n * channels; ++i) {
+				error = std::max(error, std::abs(mixed[i] - reference[i]));
+				mismatches += result[i] != expected[i];
+			}
+			if (op == 0 && error > 1e-6f)
+				printf("differs from FloatMixer by %g, ", error);
+			if (op == 1 && mismatches)
+				printf("%u samples differ from FloatMixer, ", (unsigned)mismatches);
+		}
+		float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		printf("%7.1f Mframes/s\n", runs * n / elapsed / 1e6);
+	}
+}
+
+//mono sine of the given length, stands in for a music stream
+class ToneStream : public clunk::Stream {
+public:
+	ToneStream(unsigned frames): _frames(frames), _position(0) {
+		_spec.format = clunk::AudioSpec::S16;
+		_spec.sample_rate = 44100;
+		_spec.channels = 1;
+	}
+	void rewind() { _position = 0; }
+	bool read(clunk::Buffer &data, unsigned hint) {
+		const unsigned n = std::min(std::max(hint / 2, 256u), _frames - _position);
+		data.set_size(n * 2);
+		clunk::s16 *dst = static_cast<clunk::s16 *>(data.get_ptr());
+		for(unsigned i = 0; i < n; ++i, ++_position)
+			dst[i] = (clunk::s16)(8192 * sin(_position * 0.0627f));
+		return _position < _frames;
+	}
+
+private:
+	unsigned _frames, _position;
+};
+
+//renders moving sources started at different periods with the given hrtf batch, returns s16 stereo samples
+static void batch_render(std::vector<clunk::s16> &result, unsigned period, unsigned batch, unsigned window) {
+	static const int sources = 4, periods = 200;
+	clunk::offline::Backend backend(44100, 2, period);
+	clunk::Context &context = backend.get_context();
+	context.set_max_sources(sources);
+	context.set_hrtf_batch(batch);
+	clunk::Sample *sample = backend.load("helicopter.wav");
+	std::vector<clunk::Object *> objects;
+	result.clear();
+	for(int p = 0; p < periods; ++p) {
+		if (p % 7 == 0 && (int)objects.size() < sources) {
+			objects.push_back(context.create_object());
+			clunk::Source *source = new clunk::Source(sample, true);
+			if (objects.size() % 2 == 0)
+				source->set_hrtf_window(window);
+			objects.back()->play("h", source);
+		}
+		for(size_t i = 0; i < objects.size(); ++i) {
+			float a = float(2 * M_PI * (p / 50.0 + i / (double)sources));
+			objects[i]->set_position(clunk::v3f(cos(a) * 3, sin(a) * 6, 1));
+		}
+		const clunk::Buffer &data = backend.render();
+		const clunk::s16 *samples = static_cast<const clunk::s16 *>(data.get_ptr());
+		result.insert(result.end(), samples, samples + data.get_size() / sizeof(clunk::s16));
+	}
+}
+
+//sine played off axis, its tier is switched from first to second at period switch_at, returns s16 stereo samples
+static void tier_render(std::vector<clunk::s16> &result, unsigned partition, clunk::DistanceModel::Tier first, clunk::DistanceModel::Tier second, int switch_at) {
+	static const int periods = 24;
+	clunk::offline::Backend backend(44100, 2, 1024);
+	clunk::Context &context = backend.get_context();
+	if (partition > 0)
+		context.set_hrtf_engine(clunk::Hrtf::Convolution, partition);
+	//generateSine carries its phase over between the calls, every render needs the same samples
+	clunk::Buffer sine;
+	sine.resize(4 * 44100 * sizeof(clunk::s16));
+	clunk::s16 *wave = static_cast<clunk::s16 *>(sine.get_ptr());
+	for(int i = 0; i < 4 * 44100; ++i)
+		wave[i] = (clunk::s16)(16384 * sin(i * 110 * 2 * M_PI / 44100));
+	clunk::Sample *sample = context.create_sample();
+	sample->init(sine, clunk::AudioSpec(clunk::AudioSpec::S16, 44100, 1));
+	clunk::Object *object = context.create_object();
+	//2.24 away, hrtf and itd distances around it pick the tier
+	object->set_position(clunk::v3f(2, 1, 0));
+	object->play("sine", new clunk::Source(sample, true));
+	result.clear();
+	for(int p = 0; p < periods; ++p) {
+		const clunk::DistanceModel::Tier tier = p < switch_at? first: second;
+		clunk::DistanceModel dm(clunk::DistanceModel::Inverse, false);
+		dm.hrtf_distance = tier == clunk::DistanceModel::FullHrtf? 0: 1;
+		dm.itd_distance = tier == clunk::DistanceModel::GainPanning? 1.5f: 0;
+		context.set_distance_model(dm);
+		const clunk::Buffer &data = backend.render();
+		const clunk::s16 *samples = static_cast<const clunk::s16 *>(data.get_ptr());
+		result.insert(result.end(), samples, samples + data.get_size() / sizeof(clunk::s16));
+	}
+}
+
+//largest distance of the crossed render from the span between the single tier renders in the samples [from, to)
+static int crossing_error(const std::vector<clunk::s16> &crossed, const std::vector<clunk::s16> &first, const std::vector<clunk::s16> &second, size_t from, size_t to) {
+	int r = 0;
+	for(size_t i = from; i < to && i < crossed.size(); ++i) {
+		const int lo = std::min(first[i], second[i]), hi = std::max(first[i], second[i]);
+		r = std::max(r, std::max(lo - crossed[i], crossed[i] - hi));
+	}
+	return r;
+}
+
+//name=value arguments of the offline render
+typedef std::map<std::string, std::string> options_type;
+
+static bool parse_options(options_type &options, int argc, char *argv[], int first) {
+	for(int i = first; i < argc; ++i) {
+		const char *eq = strchr(argv[i], '=');
+		if (eq == NULL || eq == argv[i]) {
+			printf("invalid option %s, use name=value\n", argv[i]);
+			return false;
+		}
+		options[std::string(argv[i], eq - argv[i])] = eq + 1;
+	}
+	return true;
+}
+
+//takes option out of the map, so the ones left are unknown
+static std::string option(options_type &options, const char *name, const std::string &value) {
+	options_type::iterator i = options.find(name);
+	if (i == options.end())
+		return value;
+	const std::string r = i->second;
+	options.erase(i);
+	return r;
+}
+
+static double option(options_type &options, const char *name, double value) {
+	const std::string r = option(options, name, std::string());
+	return r.empty()? value: atof(r.c_str());
+}
+
+//value is one of the names or its index
+static int option(options_type &options, const char *name, const char * const *names, int count, int value) {
+	const std::string r = option(options, name, std::string());
+	if (r.empty())
+		return value;
+	for(int i = 0; i < count; ++i)
+		if (r == names[i])
+			return i;
+	return atoi(r.c_str());
+}
+
 int main(int argc, char *argv[]) {
 
 	if (argc > 1 && argv[1][0] == 'b' && argv[1][1] == 'm') {
@@ -116,6 +475,125 @@ int main(int argc, char *argv[]) {
 		}
 		return 0;
 	}
+	if (argc > 1 && argv[1][0] == 'b' && argv[1][1] == 's') {
+		//sample rate conversions of every preset on every kernel, then the old nearest neighbour conversion of s16 data
+		static const unsigned rates[][2] = { {22050, 44100}, {22050, 48000}, {44100, 48000}, {48000, 44100}, {44100, 22050}, {48000, 22050} };
+		const float seconds = argc > 2? (float)atof(argv[2]): 10;
+#ifdef CLUNK_USES_SIMD
+		const int levels = clunk::CpuFeatures::detect();
+		const bool dispatch = true;
+#else
+		const int levels = clunk::CpuFeatures::Scalar;
+		const bool dispatch = false;
+#endif
+		clunk::resampler_kernel_type previous = NULL;
+		for(int l = clunk::CpuFeatures::Scalar; l <= levels; ++l) {
+			clunk::CpuFeatures::set((clunk::CpuFeatures::Level)l);
+			if (clunk::CpuFeatures::get() != l || clunk::Resampler::kernel() == previous)
+				continue;
+			previous = clunk::Resampler::kernel();
+			for(int q = clunk::Resampler::Fast; q <= clunk::Resampler::Best; ++q)
+				for(size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r)
+					resampler_bench(dispatch? clunk::CpuFeatures::name((clunk::CpuFeatures::Level)l): "builtin", (clunk::Resampler::Quality)q, rates[r][0], rates[r][1], seconds);
+		}
+		for(size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+			const unsigned src_rate = rates[r][0], dst_rate = rates[r][1];
+			const size_t frames = (size_t)(seconds * src_rate);
+			const double freq = 0.2 * std::min(src_rate, dst_rate);
+			clunk::Buffer input, output;
+			input.set_size(frames * 2 * sizeof(clunk::s16));
+			clunk::s16 *src = static_cast<clunk::s16 *>(input.get_ptr());
+			for(size_t i = 0; i < frames; ++i)
+				src[2 * i] = src[2 * i + 1] = (clunk::s16)(32767 * sin(2 * M_PI * freq * i / src_rate));
+			auto start = std::chrono::steady_clock::now();
+			clunk::Resample::resample(clunk::AudioSpec(clunk::AudioSpec::S16, dst_rate, 2), output, clunk::AudioSpec(clunk::AudioSpec::S16, src_rate, 2), input);
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const size_t n = output.get_size() / 2 / sizeof(clunk::s16);
+			std::vector<float> result(2 * n);
+			for(size_t i = 0; i < 2 * n; ++i)
+				result[i] = static_cast<const clunk::s16 *>(output.get_ptr())[i] / 32768.0f;
+			printf("nearest         %5u -> %5u: %7.1f Mframes/s (%5.0fx realtime), sine error %6.1f dB\n", src_rate, dst_rate, 
+				n / elapsed / 1e6, n / elapsed / dst_rate, sine_error(result.data(), n, 2, freq, dst_rate));
+		}
+		return 0;
+	}
+	if (argc > 1 && argv[1][0] == 'b' && argv[1][1] == 'i') {
+		//integer mixer: the per sample templates, then every dispatched kernel at full and partial volume. Float bus mixer and conversion of the context after them
+		static const clunk::AudioSpec::Format formats[] = { clunk::AudioSpec::S8, clunk::AudioSpec::U8, clunk::AudioSpec::S16 };
+		static const int cases[][2] = { {0, 128}, {0, 77}, {1, 128}, {1, 77}, {2, 77} };
+#ifdef CLUNK_USES_SIMD
+		const int levels = clunk::CpuFeatures::detect();
+		const bool dispatch = true;
+#else
+		const int levels = clunk::CpuFeatures::Scalar;
+		const bool dispatch = false;
+#endif
+		for(int l = clunk::CpuFeatures::Scalar - 1; l <= levels; ++l) {
+			if (l >= clunk::CpuFeatures::Scalar) {
+				clunk::CpuFeatures::set((clunk::CpuFeatures::Level)l);
+				if (clunk::CpuFeatures::get() != l)
+					continue;
+			}
+			for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+				for(size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+					mixer_bench(l < clunk::CpuFeatures::Scalar? "generic": dispatch? clunk::CpuFeatures::name((clunk::CpuFeatures::Level)l): "builtin", formats[f], cases[c][0], cases[c][1], l < clunk::CpuFeatures::Scalar);
+			for(unsigned channels = 1; channels <= 2; ++channels)
+				float_mixer_bench(l < clunk::CpuFeatures::Scalar? "generic": dispatch? clunk::CpuFeatures::name((clunk::CpuFeatures::Level)l): "builtin", channels, l < clunk::CpuFeatures::Scalar);
+		}
+		return 0;
+	}
+	if (argc > 1 && argv[1][0] == 'b' && argv[1][1] == 'p') {
+		//source reading a looped sine at non integer steps with every interpolation and kernel: throughput and error of the first period
+		const float pitch = argc > 2? (float)atof(argv[2]): 1.37f;
+		const int freq = 3528, rate = 44100;
+		const unsigned period = 1024;
+		clunk::offline::Backend backend(rate, 2, period);
+		clunk::Context &context = backend.get_context();
+		clunk::Sample *sample = context.create_sample();
+		sample->generateSine(freq, 1.0f);
+		static const char *names[] = { "nearest", "linear", "cubic" };
+#ifdef CLUNK_USES_SIMD
+		const int levels = clunk::CpuFeatures::detect();
+		const bool dispatch = true;
+#else
+		const int levels = clunk::CpuFeatures::Scalar;
+		const bool dispatch = false;
+#endif
+		for(int l = clunk::CpuFeatures::Scalar; l <= levels; ++l) {
+			clunk::CpuFeatures::set((clunk::CpuFeatures::Level)l);
+			if (clunk::CpuFeatures::get() != l)
+				continue;
+			for(int i = clunk::Source::Nearest; i <= clunk::Source::Cubic; ++i) {
+				clunk::Source source(sample, true, clunk::v3f(), 1, pitch);
+				source.interpolation = (clunk::Source::Interpolation)i;
+				clunk::Buffer scratch;
+				float volume, volume_end, error = 0, norm = 0;
+				std::chrono::steady_clock::time_point start;
+				const int runs = 20000;
+				for(int r = 0; r <= runs; ++r) {
+					if (r == 1)
+						start = std::chrono::steady_clock::now();
+					float p = 1;
+					source._prepare(2, period, 1, p, scratch, volume, volume_end);
+					source._advance(period, p);
+					if (r > 0)
+						continue;
+					const float *data = static_cast<const float *>(scratch.get_ptr());
+					for(unsigned j = 0; j < period; ++j) {
+						const double v = 32767 / 32768.0 * sin(2 * M_PI * freq * pitch * j / rate);
+						error += (float)((data[j] - v) * (data[j] - v));
+						norm += (float)(v * v);
+					}
+				}
+				float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+				printf("%-8s %-8s pitch %.3f: %6.1f Msamples/s, error %6.1f dB\n", dispatch? clunk::CpuFeatures::name((clunk::CpuFeatures::Level)l): "builtin", 
+					names[i], pitch, runs * (period + source._get_hrtf().window_size()) / elapsed / 1e6, 10 * log10(error / norm));
+			}
+			if (!dispatch)
+				break;
+		}
+		return 0;
+	}
 	if (argc > 1 && argv[1][0] == 't') {
 		fft_type fft;
 		for(int i = 0; i < fft_type::N; ++i) {
@@ -134,6 +612,152 @@ int main(int argc, char *argv[]) {
 		
 		return 0;
 	}
+	if (argc > 1 && argv[1][0] == 'k') {
+		//same numerical checks and timings for every fft kernel available on this cpu
+		int errors = 0;
+		float reference[mdct_type::M + mdct_type::N];
+		clunk::CpuFeatures::set(clunk::CpuFeatures::Scalar);
+		mdct_run(reference);
+#ifdef CLUNK_USES_SIMD
+		const int levels = clunk::CpuFeatures::detect();
+		const bool dispatch = true;
+		clunk::fft_kernel_type previous = NULL;
+#else
+		//kernel is chosen at compile time
+		const int levels = clunk::CpuFeatures::Scalar;
+		const bool dispatch = false;
+#endif
+		for(int l = clunk::CpuFeatures::Scalar; l <= levels; ++l) {
+			clunk::CpuFeatures::set((clunk::CpuFeatures::Level)l);
+			if (clunk::CpuFeatures::get() != l)
+				continue;
+#ifdef CLUNK_USES_SIMD
+			//level without its own kernel
+			if (l > clunk::CpuFeatures::Scalar && clunk::FftKernels::get() == previous)
+				continue;
+			previous = clunk::FftKernels::get();
+#endif
+			float fft_error = fft_check<1>() + fft_check<2>() + fft_check<3>() + fft_check<4>() + fft_check<5>() + 
+				fft_check<6>() + fft_check<7>() + fft_check<8>() + fft_check<9>() + fft_check<10>();
+			float result[mdct_type::M + mdct_type::N], mdct_error = 0, norm = 0;
+			mdct_run(result);
+			for(int i = 0; i < mdct_type::M + mdct_type::N; ++i) {
+				mdct_error = std::max(mdct_error, std::abs(result[i] - reference[i]));
+				norm = std::max(norm, std::abs(reference[i]));
+			}
+			mdct_error /= norm;
+
+			mdct_type mdct;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for(int i = 0; i < 100000; ++i) {
+				mdct.mdct();
+				clunk::Buffer::unoptimize(mdct.data, mdct.N);
+			}
+			float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+			bool ok = fft_error < 1e-4f && mdct_error < 1e-4f;
+			printf("%-8s fft error %g, mdct difference %g, %.2f us per mdct: %s\n", dispatch? clunk::CpuFeatures::name((clunk::CpuFeatures::Level)l): "builtin", 
+				fft_error, mdct_error, elapsed * 10, ok? "ok": "FAILED");
+			if (!ok)
+				++errors;
+		}
+		return errors;
+	}
+	if (argc > 1 && argv[1][0] == 'c') {
+		//batched hrtf must render the same as the voices processed one by one, also for periods which are not multiple of the half window
+		static const unsigned periods[][2] = { {1024, 0}, {441, 0}, {300, 0}, {512, 2048} };
+		int errors = 0;
+		for(size_t i = 0; i < sizeof(periods) / sizeof(periods[0]); ++i) {
+			std::vector<clunk::s16> single, batched;
+			batch_render(single, periods[i][0], 0, periods[i][1]);
+			batch_render(batched, periods[i][0], 4, periods[i][1]);
+			double error = 0, norm = 0;
+			int max_diff = 0;
+			for(size_t j = 0; j < single.size() && j < batched.size(); ++j) {
+				const int diff = batched[j] - single[j];
+				max_diff = std::max(max_diff, std::abs(diff));
+				error += (double)diff * diff;
+				norm += (double)single[j] * single[j];
+			}
+			const double db = 10 * log10((error + 1e-9) / (norm + 1e-9));
+			const bool ok = single.size() == batched.size() && db < -80;
+			printf("period %4u, odd window %4u: max difference %5d, error %6.1f dB: %s\n", periods[i][0], periods[i][1], max_diff, db, ok? "ok": "FAILED");
+			if (!ok)
+				++errors;
+		}
+		return errors;
+	}
+	if (argc > 1 && argv[1][0] == 'd') {
+		//crossfade between the tiers must stay between the single tier renders
+		static const clunk::DistanceModel::Tier F = clunk::DistanceModel::FullHrtf, I = clunk::DistanceModel::ItdIld, G = clunk::DistanceModel::GainPanning;
+		static const struct { clunk::DistanceModel::Tier first, second; unsigned partition; } cases[] = {
+			{ G, I, 0 }, { I, G, 0 }, { I, F, 0 }, { F, I, 0 }, { F, G, 0 }, { G, F, 128 }, { F, I, 128 }, 
+		};
+		static const char *names[] = { "hrtf", "itd", "gain" };
+		static const int switch_at = 12;
+		int errors = 0;
+		for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+			std::vector<clunk::s16> crossed, first, second;
+			tier_render(crossed, cases[i].partition, cases[i].first, cases[i].second, switch_at);
+			tier_render(first, cases[i].partition, cases[i].first, cases[i].first, switch_at);
+			tier_render(second, cases[i].partition, cases[i].second, cases[i].second, switch_at);
+			//before the switch it is the first tier, then a crossfade within a window, then the second tier once its filter history refills
+			const size_t start = 2 * 1024 * switch_at, settled = start + 2 * 2 * 1024;
+			int error = std::max(crossing_error(crossed, first, first, 0, start), crossing_error(crossed, first, second, start, settled));
+			error = std::max(error, crossing_error(crossed, second, second, settled, crossed.size()));
+			int peak = 1;
+			for(size_t j = 0; j < second.size(); ++j)
+				peak = std::max(peak, std::max<int>(std::abs(first[j]), std::abs(second[j])));
+			const double db = error > 0? 20 * log10((double)error / peak): -999;
+			const bool ok = crossed.size() == first.size() && crossed.size() == second.size() && db < -60;
+			printf("%-4s -> %-4s %-11s max error %5d, %6.1f dB: %s\n", names[cases[i].first], names[cases[i].second], 
+				cases[i].partition? "convolution": "mdct", error, db, ok? "ok": "FAILED");
+			if (!ok)
+				++errors;
+		}
+		return errors;
+	}
+	if (argc > 1 && argv[1][0] == 'a') {
+		//steady state of a game: objects roam the grid, sources and streams are played and stopped after the warm up, must not allocate inside process.
+		//Stream decoding threads are switched on the way
+		clunk::offline::Backend backend(44100, 2, 1024);
+		clunk::Context &context = backend.get_context();
+		context.set_stream_threads(1);
+		clunk::Sample *h = backend.load("helicopter.wav");
+		std::vector<clunk::Object *> o;
+		for(int i = 0; i < 8; ++i) {
+			o.push_back(context.create_object());
+			o.back()->set_position(clunk::v3f((float)i, 2, 0));
+			o.back()->play("warm up", new clunk::Source(h, false));
+		}
+		backend.render();
+		clunk::AllocationHook::reset();
+		for(int p = 0; p < 200; ++p) {
+			clunk::Object *object = o[p % o.size()];
+			object->set_position(clunk::v3f(200 * sin(p * 0.37f), 2, 200 * cos(p * 0.23f)));
+			if (p % 3 == 0)
+				object->play("shot", new clunk::Source(h, false));
+			else if (p % 3 == 1)
+				object->play(p, new clunk::Source(h, false));
+			else
+				object->cancel_all(true);
+			if (p % 5 == 0)
+				context.play(p % 3, new ToneStream(44100), false);
+			else if (p % 5 == 3)
+				context.stop(p % 3);
+			//playing streams move between the decoders and the callback
+			if (p % 50 == 49)
+				context.set_stream_threads(p / 50 % 3);
+			backend.render();
+		}
+		if (!clunk::AllocationHook::enabled()) {
+			printf("built without allocation hook, nothing to check\n");
+			return 0;
+		}
+		const unsigned count = (unsigned)clunk::AllocationHook::count();
+		printf("heap allocations inside process after the warm up: %u: %s\n", count, count == 0? "ok": "FAILED");
+		return count == 0? 0: 1;
+	}
 	if (argc > 1 && argv[1][0] == 'f')
 	{
 		printf("reference: \n");
@@ -151,6 +775,129 @@ int main(int argc, char *argv[]) {
 		return 0;
 	}
 
+	static const int d = 3, n = 72;
+
+	if (argc > 1 && argv[1][0] == 'o') {
+		/*
+			offline render: o [output.wav] [name=value ...]
+				seconds=N			length of the render, 7.2 by default
+				threads=N			mixing threads, 1 by default
+				objects=N			moving objects, each plays the helicopter loop, 1 by default
+				sources=N			maximum number of the mixed sources, number of the objects by default
+				partition=N			convolution partition: 64, 128 or 256, 0 (default) keeps the mdct engine
+				batch=N				hrtf batch lanes, 4 by default
+				hrtf-distance=D		distance model hrtf_distance, 0 by default
+				itd-distance=D		distance model itd_distance, 0 by default
+				window=N			hrtf window of the context, 0 keeps the default one
+				odd-window=N		hrtf window of the sources of the odd objects, 0 (default) follows the context
+				dataset=FILE		hrtf dataset, builtin one by default
+				precision=N			hrtf bank precision: 32, 16 (default) or 8
+				storage=N			sample storage: 16 (default) or 32
+				quality=Q			stream and sample resampler quality: fast, medium (default) or best
+				interpolation=I		interpolation of the sources played at a different pitch or sample rate: nearest, linear (default) or cubic
+		*/
+		const char *fname = argc > 2? argv[2]: "test_out.wav";
+		options_type options;
+		if (!parse_options(options, argc, argv, 3))
+			return 1;
+		static const char * const qualities[] = { "fast", "medium", "best" };
+		static const char * const interpolations[] = { "nearest", "linear", "cubic" };
+		float seconds = (float)option(options, "seconds", n / 10.0f);
+		unsigned threads = (unsigned)option(options, "threads", 1);
+		int objects = (int)option(options, "objects", 1);
+		int sources = (int)option(options, "sources", objects);
+		unsigned partition = (unsigned)option(options, "partition", 0);
+		unsigned batch = (unsigned)option(options, "batch", 4);
+		float hrtf_distance = (float)option(options, "hrtf-distance", 0);
+		float itd_distance = (float)option(options, "itd-distance", 0);
+		unsigned window = (unsigned)option(options, "window", 0);
+		unsigned odd_window = (unsigned)option(options, "odd-window", 0);
+		const std::string dataset = option(options, "dataset", std::string());
+		int precision = (int)option(options, "precision", 16);
+		int storage = (int)option(options, "storage", 16);
+		int resample_quality = option(options, "quality", qualities, 3, clunk::Resampler::Medium);
+		int interpolation = option(options, "interpolation", interpolations, 3, clunk::Source::Linear);
+		if (!options.empty()) {
+			printf("unknown option %s\n", options.begin()->first.c_str());
+			return 1;
+		}
+
+		clunk::offline::Backend backend(44100, 2, 1024);
+		clunk::Context &context = backend.get_context();
+		context.set_threads(threads);
+		context.set_max_sources(sources);
+		context.set_profiling(true);
+		if (partition > 0)
+			context.set_hrtf_engine(clunk::Hrtf::Convolution, partition);
+		context.set_hrtf_batch(batch);
+		if (window > 0)
+			context.set_hrtf_window(window);
+		if (precision != 16) {
+			auto bank_start = std::chrono::steady_clock::now();
+			context.set_hrtf_precision(precision == 32? clunk::HrtfBank::Float32: clunk::HrtfBank::Log8);
+			printf("hrtf bank rebuilt in %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bank_start).count());
+		}
+		if (!dataset.empty()) {
+			auto load_start = std::chrono::steady_clock::now();
+			context.set_hrtf_dataset(dataset);
+			printf("hrtf dataset %s loaded in %.1f ms\n", dataset.c_str(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count());
+		}
+		printf("hrtf bank uses %u KiB\n", (unsigned)(context.get_hrtf_bank().memory() / 1024));
+		clunk::ProfileStats stats;
+
+		context.set_resample_quality((clunk::Resampler::Quality)resample_quality);
+		auto sample_start = std::chrono::steady_clock::now();
+		clunk::Sample * h = backend.load("helicopter.wav", storage == 32? clunk::Sample::Float32: clunk::Sample::Int16);
+		printf("sample loaded in %.1f ms, uses %u KiB, %u KiB above s16\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sample_start).count(), 
+			(unsigned)(h->memory() / 1024), (unsigned)(h->memory_overhead() / 1024));
+
+		clunk::DistanceModel dm(clunk::DistanceModel::Exponent, false);
+		dm.rolloff_factor = 0.7f;
+		dm.hrtf_distance = hrtf_distance;
+		dm.itd_distance = itd_distance;
+		context.set_distance_model(dm);
+
+		std::vector<clunk::Object *> o;
+		for(int i = 0; i < objects; ++i) {
+			o.push_back(context.create_object());
+			clunk::Source *source = new clunk::Source(h, true);
+			source->interpolation = (clunk::Source::Interpolation)interpolation;
+			if (i % 2 == 1)
+				source->set_hrtf_window(odd_window);
+			o.back()->play("h", source);
+		}
+
+		clunk::Buffer data;
+		auto start = std::chrono::steady_clock::now();
+		while(backend.get_time() < seconds) {
+			for(int i = 0; i < objects; ++i) {
+				float a = float(2 * M_PI * (backend.get_time() * 10 + i * n / objects) / n);
+				o[i]->set_position(clunk::v3f(cos(a) * d, sin(a) * d * 2, 1));
+			}
+			const clunk::Buffer &period = backend.render();
+			data.append(period);
+			stats.add(context.get_profiler());
+			if (backend.get_frames() == backend.get_period())
+				clunk::AllocationHook::reset(); //first period warms up scratch memory
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("rendered %g seconds in %g seconds (%gx realtime)\n", backend.get_time(), elapsed, elapsed > 0? backend.get_time() / elapsed: 0);
+		static const char *stages[] = { "selection", "streams", "sources", "mixing", "total" };
+		for(int i = 0; i < clunk::ProfileRecord::Stages; ++i) {
+			clunk::ProfileStats::Aggregate a = stats.get((clunk::ProfileRecord::Stage)i);
+			printf("%-10s min %7.1fus avg %7.1fus p99 %7.1fus\n", stages[i], a.min * 1e6, a.avg * 1e6, a.p99 * 1e6);
+		}
+		std::map<std::string, clunk::ProfileStats::Aggregate> samples = stats.get_samples();
+		for(std::map<std::string, clunk::ProfileStats::Aggregate>::const_iterator i = samples.begin(); i != samples.end(); ++i)
+			printf("sample %-10s avg %7.1fus p99 %7.1fus per period\n", i->first.c_str(), i->second.avg * 1e6, i->second.p99 * 1e6);
+		if (clunk::AllocationHook::enabled())
+			printf("heap allocations inside process after the first period: %u\n", (unsigned)clunk::AllocationHook::count());
+
+		clunk::WavFile(context.get_spec(), data).save(fname);
+		return 0;
+	}
+
+#ifdef CLUNK_BACKEND_SDL
 	clunk::sdl::Backend backend(44100, 2, 1024);
 	clunk::Context &context = backend.get_context();
 	
@@ -158,7 +905,6 @@ int main(int argc, char *argv[]) {
 	clunk::Sample * s = clunk::WavFile::load(context, "scissors.wav");
 	clunk::Sample * h = clunk::WavFile::load(context, "helicopter.wav");
 
-	static const int d = 3, n = 72;
 	clunk::DistanceModel dm(clunk::DistanceModel::Exponent, false);
 	dm.rolloff_factor = 0.7f;
 	context.set_distance_model(dm);
@@ -194,5 +940,8 @@ int main(int argc, char *argv[]) {
 		usleep(500000);
 	}
 */	backend.stop();
+#else
+	printf("built without SDL backend, use 'o' mode to render offline\n");
+#endif
 	return 0;
 }